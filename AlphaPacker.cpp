@@ -0,0 +1,123 @@
+#include "AlphaPacker.h"
+#include "SimdOps.h"
+
+
+using namespace zs::simd;
+
+
+namespace {
+
+	/// Key luma to alpha
+	inline uint8_t KeyToAlpha(uint8_t y, bool limited) {
+		if (!limited)
+			return y;
+		int a = ((y - 16) * 149 + 64) >> 7;
+		return (uint8_t)(a < 0 ? 0 : a > 255 ? 255 : a);
+	}
+
+}
+
+
+zs::AlphaPacker::AlphaPacker(StripeWorkers& workers) : workers(workers), limitedRange(true) {
+
+
+}
+
+
+zs::AlphaPacker::~AlphaPacker() {
+
+
+}
+
+
+void zs::AlphaPacker::SetLimitedRange(bool limited) {
+
+	limitedRange = limited;
+
+}
+
+
+bool zs::AlphaPacker::Pack(const uint8_t* fill, uint32_t fillStride, bool fillYUY2,
+	const uint8_t* key, uint32_t keyStride, bool keyYUY2,
+	uint32_t width, uint32_t height, uint8_t* dst) {
+
+	if (fill == nullptr || key == nullptr || dst == nullptr || width % 2 != 0 || width < 4 || height < 2)
+		return false;
+
+	const uint32_t rowBytes = width * 2;
+	if (fillStride == 0)
+		fillStride = rowBytes;
+	if (keyStride == 0)
+		keyStride = rowBytes;
+
+	uint8_t* alphaPlane = dst + (size_t)rowBytes * height;
+	const bool limited = limitedRange;
+	const uint32_t lumaOffset = keyYUY2 ? 0 : 1;
+	const v16u8 swapMask = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+	const v16u8 lumaMask = keyYUY2
+		? (v16u8){ 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 }
+		: (v16u8){ 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 };
+	const v8u16 black = Splat16(16);
+	const v8u16 gain = Splat16(149);
+	const v8u16 round = Splat16(64);
+	const v8u16 white = Splat16(255);
+
+	workers.Run(height, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t y = first; y < last; y++) {
+
+			const uint8_t* f = fill + y * fillStride;
+			const uint8_t* k = key + y * keyStride;
+			uint8_t* out = dst + y * rowBytes;
+			uint8_t* alpha = alphaPlane + y * width;
+
+			// 16 pixels per step: 32 bytes of fill and key, 16 bytes of alpha
+			uint32_t x = 0;
+			for (; x + 16 <= width; x += 16) {
+
+				v16u8 f0 = Load(f + x * 2);
+				v16u8 f1 = Load(f + x * 2 + kBytes);
+				if (fillYUY2) {
+					f0 = __builtin_shuffle(f0, swapMask);
+					f1 = __builtin_shuffle(f1, swapMask);
+				}
+				Store(out + x * 2, f0);
+				Store(out + x * 2 + kBytes, f1);
+
+				v16u8 luma = __builtin_shuffle(Load(k + x * 2), Load(k + x * 2 + kBytes), lumaMask);
+				if (limited) {
+					uint8_t bytes[kBytes];
+					Store(bytes, luma);
+					for (uint32_t h = 0; h < kBytes; h += 8) {
+						v8u16 l = LoadWide(bytes + h);
+						l = (v8u16)(l > black) & (l - black);
+						// 255 / 219 as 149 / 128, which keeps the product within 16 bits
+						l = Min16((l * gain + round) >> 7, white);
+						StoreNarrow(alpha + x + h, l);
+					}
+				}
+				else {
+					Store(alpha + x, luma);
+				}
+
+			}
+			for (; x < width; x += 2) {
+				const uint8_t* fp = f + x * 2;
+				uint8_t* op = out + x * 2;
+				if (fillYUY2) {
+					op[0] = fp[1]; op[1] = fp[0]; op[2] = fp[3]; op[3] = fp[2];
+				}
+				else {
+					memcpy(op, fp, 4);
+				}
+				alpha[x] = KeyToAlpha(k[x * 2 + lumaOffset], limited);
+				alpha[x + 1] = KeyToAlpha(k[x * 2 + 2 + lumaOffset], limited);
+			}
+
+		}
+
+	});
+
+	return true;
+
+}
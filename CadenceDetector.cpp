@@ -0,0 +1,118 @@
+#include "CadenceDetector.h"
+#include "SimdOps.h"
+
+
+// Frames of history needed to lock to a cadence (two 3:2 periods)
+#define LOCK_FRAMES 10
+#define LOCK_MASK ((1u << LOCK_FRAMES) - 1)
+
+
+using namespace zs::simd;
+
+
+namespace {
+
+	/// Lane multipliers, odd constants from the golden ratio and xxHash
+	const uint32_t kPrime1 = 0x9E3779B1u;
+	const uint32_t kPrime2 = 0x85EBCA77u;
+
+	/// TRUE if the 5-bit pattern is a rotation of new, repeat, new, repeat, repeat
+	bool Is32Pattern(uint32_t bits) {
+		uint32_t rotated = 0x0B; // 01011
+		for (int i = 0; i < 5; i++) {
+			if (bits == rotated)
+				return true;
+			rotated = ((rotated << 1) | (rotated >> 4)) & 0x1F;
+		}
+		return false;
+	}
+
+}
+
+
+zs::CadenceDetector::CadenceDetector(uint32_t rowStep) : rowStep(rowStep ? rowStep : 1) {
+
+	Reset();
+
+}
+
+
+zs::CadenceDetector::~CadenceDetector() {
+
+
+}
+
+
+void zs::CadenceDetector::Reset() {
+
+	last = 0;
+	haveLast = false;
+	history = 0;
+	frames = 0;
+	cadence = Cadence::None;
+	repeats = 0;
+
+}
+
+
+uint64_t zs::CadenceDetector::Signature(const uint8_t* data, uint32_t rowBytes, uint32_t height, uint32_t stride, uint32_t rowStep) {
+
+	const v4u32 prime1 = { kPrime1, kPrime1, kPrime1, kPrime1 };
+	const v4u32 prime2 = { kPrime2, kPrime2, kPrime2, kPrime2 };
+	v4u32 a = { 1, 2, 3, 4 }, b = { 5, 6, 7, 8 };
+	uint32_t tail = 0;
+
+	// Start in the middle of the first step, the top rows are often blanking
+	for (uint32_t y = rowStep / 2; y < height; y += rowStep) {
+
+		const uint8_t* row = data + (size_t)y * stride;
+		uint32_t x = 0;
+		for (; x + 2 * kBytes <= rowBytes; x += 2 * kBytes) {
+			a = (a ^ (v4u32)Load(row + x)) * prime1;
+			b = (b ^ (v4u32)Load(row + x + kBytes)) * prime2;
+		}
+		for (; x < rowBytes; x++)
+			tail = (tail ^ row[x]) * kPrime1;
+		a += (v4u32){ y, y, y, y };
+
+	}
+
+	uint64_t h = tail;
+	for (int i = 0; i < 4; i++) {
+		h = (h ^ a[i]) * 0x100000001B3ull;
+		h = (h ^ b[i]) * 0x100000001B3ull;
+	}
+	return h ^ (h >> 29);
+
+}
+
+
+bool zs::CadenceDetector::IsRepeat(const uint8_t* data, uint32_t rowBytes, uint32_t height, uint32_t stride) {
+
+	if (data == nullptr || rowBytes == 0 || height == 0)
+		return false;
+
+	const uint64_t signature = Signature(data, rowBytes, height, stride, rowStep);
+	const bool repeat = haveLast && signature == last;
+	last = signature;
+	haveLast = true;
+
+	history = (history << 1) | (repeat ? 1 : 0);
+	if (frames < LOCK_FRAMES)
+		frames++;
+	if (repeat)
+		repeats++;
+
+	const uint32_t recent = history & LOCK_MASK;
+	if (frames < LOCK_FRAMES)
+		cadence = Cadence::None;
+	else if (recent == 0x155 || recent == 0x2AA)
+		cadence = Cadence::Pulldown22;
+	else if ((recent & 0x1F) == (recent >> 5) && Is32Pattern(recent & 0x1F))
+		cadence = Cadence::Pulldown32;
+	else
+		cadence = Cadence::None;
+
+	return repeat;
+
+}
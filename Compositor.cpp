@@ -0,0 +1,98 @@
+#include <cmath>
+#include "Compositor.h"
+
+
+zs::Compositor::Compositor(StripeWorkers& workers, ScaleFilter filter) :
+	scaler(workers, filter), width(0), height(0) {
+
+
+}
+
+
+zs::Compositor::~Compositor() {
+
+
+}
+
+
+bool zs::Compositor::SetLayout(uint32_t width, uint32_t height, uint32_t tiles) {
+
+	if (tiles == 0 || width % 2 != 0)
+		return false;
+
+	uint32_t columns = (uint32_t)std::ceil(std::sqrt((double)tiles));
+	uint32_t rows = (tiles + columns - 1) / columns;
+	uint32_t tileWidth = (width / columns) & ~1u;
+	uint32_t tileHeight = height / rows;
+	if (tileWidth < 4 || tileHeight < 2)
+		return false;
+
+	this->width = width;
+	this->height = height;
+	this->tiles.clear();
+	for (uint32_t i = 0; i < tiles; i++)
+		this->tiles.push_back(Tile{ (i % columns) * tileWidth, (i / columns) * tileHeight, tileWidth, tileHeight });
+
+	return true;
+
+}
+
+
+void zs::Compositor::Fill(uint8_t* canvas, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+
+	// Black is Y = 16, U = V = 128
+	const uint32_t black = 0x10801080;
+	for (uint32_t row = y; row < y + h; row++) {
+		uint32_t* p = (uint32_t*)(canvas + row * width * 2 + x * 2);
+		for (uint32_t i = 0; i < w / 2; i++)
+			p[i] = black;
+	}
+
+}
+
+
+bool zs::Compositor::Draw(uint32_t tile, const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcStride, uint8_t* canvas) {
+
+	if (tile >= tiles.size() || canvas == nullptr)
+		return false;
+
+	const Tile& t = tiles[tile];
+	return scaler.Scale(src, srcWidth, srcHeight, srcStride,
+		canvas + t.y * width * 2 + t.x * 2, t.width, t.height, width * 2);
+
+}
+
+
+void zs::Compositor::Clear(uint32_t tile, uint8_t* canvas) {
+
+	if (tile >= tiles.size() || canvas == nullptr)
+		return;
+
+	const Tile& t = tiles[tile];
+	Fill(canvas, t.x, t.y, t.width, t.height);
+
+}
+
+
+void zs::Compositor::ClearBorders(uint8_t* canvas) {
+
+	if (tiles.empty() || canvas == nullptr)
+		return;
+
+	// Tiles are a grid anchored at the top left; fill right and bottom remainders
+	uint32_t right = 0, bottom = 0;
+	for (const Tile& t : tiles) {
+		right = t.x + t.width > right ? t.x + t.width : right;
+		bottom = t.y + t.height > bottom ? t.y + t.height : bottom;
+	}
+	if (right < width)
+		Fill(canvas, right, 0, width - right, height);
+	if (bottom < height)
+		Fill(canvas, 0, bottom, right, height - bottom);
+
+	// Empty cells of an incomplete last row
+	const Tile& last = tiles.back();
+	if (last.x + last.width < right)
+		Fill(canvas, last.x + last.width, last.y, right - last.x - last.width, last.height);
+
+}
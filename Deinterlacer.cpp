@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstdlib>
+#include "Deinterlacer.h"
+#include "SimdOps.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 4
+
+
+using namespace zs::simd;
+
+
+zs::Deinterlacer::Deinterlacer(StripeWorkers& workers) : workers(workers), motionThreshold(12) {
+
+
+}
+
+
+zs::Deinterlacer::~Deinterlacer() {
+
+
+}
+
+
+void zs::Deinterlacer::SetMotionThreshold(uint8_t threshold) {
+
+	motionThreshold = threshold;
+
+}
+
+
+bool zs::Deinterlacer::Prepare(Frame& src, uint32_t& stride, Frame& dst, uint32_t dstHeight) {
+
+	if (stride == 0)
+		stride = src.width * 2;
+
+	if (src.data == nullptr ||
+		src.fourcc != (uint32_t)ValidFourccCodes::UYVY ||
+		stride < src.width * 2 ||
+		src.width < MIN_FRAME_WIDTH ||
+		src.height < MIN_FRAME_HEIGHT / 2)
+		return false;
+
+	const uint32_t size = src.width * dstHeight * 2;
+	if (dst.data == nullptr || dst.size != size) {
+
+		delete[] dst.data;
+		dst.size = size;
+		dst.data = new uint8_t[size];
+
+	}
+
+	dst.width = src.width;
+	dst.height = dstHeight;
+	dst.fourcc = src.fourcc;
+	dst.sourceID = src.sourceID;
+	dst.frameID = src.frameID;
+
+	return true;
+
+}
+
+
+bool zs::Deinterlacer::Bob(Frame& src, uint32_t stride, bool bottomField, Frame& dst) {
+
+	if (src.height % 2 != 0 || !Prepare(src, stride, dst, src.height))
+		return false;
+
+	const uint32_t rowBytes = src.width * 2;
+	const uint32_t last = src.height - 1;
+	const uint32_t parity = bottomField ? 1 : 0;
+
+	workers.Run(src.height, [&](uint32_t first, uint32_t end) {
+
+		for (uint32_t y = first; y < end; y++) {
+
+			uint8_t* out = dst.data + y * rowBytes;
+			if ((y & 1) == parity) {
+				memcpy(out, src.data + y * stride, rowBytes);
+				continue;
+			}
+			// Missing line: average the field lines above and below, clamped to the field
+			const uint32_t above = y == 0 ? 1 : y - 1;
+			const uint32_t below = y == last ? last - 1 : y + 1;
+			AverageRows(src.data + above * stride, src.data + below * stride, out, rowBytes);
+
+		}
+
+	}, 2);
+
+	return true;
+
+}
+
+
+bool zs::Deinterlacer::BobField(Frame& src, uint32_t stride, bool bottomField, Frame& dst) {
+
+	if (!Prepare(src, stride, dst, src.height * 2))
+		return false;
+
+	const uint32_t rowBytes = src.width * 2;
+	const uint32_t fieldLast = src.height - 1;
+
+	workers.Run(dst.height, [&](uint32_t first, uint32_t end) {
+
+		for (uint32_t y = first; y < end; y++) {
+
+			uint8_t* out = dst.data + y * rowBytes;
+			// Frame line y sits at field line (y - parity) / 2 when it belongs to this field
+			if ((y & 1) == (bottomField ? 1u : 0u)) {
+				memcpy(out, src.data + (y >> 1) * stride, rowBytes);
+				continue;
+			}
+			uint32_t above = bottomField ? (y >> 1) - 1 : y >> 1;
+			uint32_t below = above + 1;
+			if (bottomField && y == 0)
+				above = below = 0;
+			if (below > fieldLast)
+				below = fieldLast;
+			AverageRows(src.data + above * stride, src.data + below * stride, out, rowBytes);
+
+		}
+
+	}, 2);
+
+	return true;
+
+}
+
+
+bool zs::Deinterlacer::Blend(Frame& src, uint32_t stride, Frame& dst) {
+
+	if (src.height % 2 != 0 || !Prepare(src, stride, dst, src.height))
+		return false;
+
+	const uint32_t rowBytes = src.width * 2;
+	const uint32_t last = src.height - 1;
+
+	workers.Run(src.height, [&](uint32_t first, uint32_t end) {
+
+		for (uint32_t y = first; y < end; y++) {
+
+			const uint8_t* above = src.data + (y == 0 ? 1 : y - 1) * stride;
+			const uint8_t* line = src.data + y * stride;
+			const uint8_t* below = src.data + (y == last ? last - 1 : y + 1) * stride;
+			uint8_t* out = dst.data + y * rowBytes;
+
+			// (above + 2 * line + below) / 4 as two rounding averages
+			uint32_t i = 0;
+			for (; i + kBytes <= rowBytes; i += kBytes)
+				Store(out + i, Avg(Avg(Load(above + i), Load(below + i)), Load(line + i)));
+			for (; i < rowBytes; i++)
+				out[i] = (uint8_t)((above[i] + 2 * line[i] + below[i] + 2) >> 2);
+
+		}
+
+	}, 2);
+
+	return true;
+
+}
+
+
+bool zs::Deinterlacer::MotionAdaptive(Frame& src, uint32_t stride, bool bottomFirst, Frame& dst) {
+
+	if (src.height % 2 != 0 || !Prepare(src, stride, dst, src.height))
+		return false;
+
+	// Without history every pixel counts as moving
+	const bool havePrevious = previous.data != nullptr && previous.size == src.width * src.height * 2;
+	if (!havePrevious) {
+		delete[] previous.data;
+		previous.size = src.width * src.height * 2;
+		previous.data = new uint8_t[previous.size];
+	}
+
+	const uint32_t rowBytes = src.width * 2;
+	const uint32_t last = src.height - 1;
+	// The newer field is kept, lines of the older field are woven or interpolated
+	const uint32_t keep = bottomFirst ? 0 : 1;
+	const v16u8 threshold = Splat(motionThreshold);
+
+	workers.Run(src.height, [&](uint32_t first, uint32_t end) {
+
+		for (uint32_t y = first; y < end; y++) {
+
+			const uint8_t* line = src.data + y * stride;
+			uint8_t* out = dst.data + y * rowBytes;
+			if ((y & 1) == keep) {
+				memcpy(out, line, rowBytes);
+				continue;
+			}
+
+			const uint8_t* above = src.data + (y == 0 ? 1 : y - 1) * stride;
+			const uint8_t* below = src.data + (y == last ? last - 1 : y + 1) * stride;
+			const uint8_t* prevLine = previous.data + y * rowBytes;
+			const uint8_t* prevAbove = previous.data + (y == 0 ? 1 : y - 1) * rowBytes;
+
+			uint32_t i = 0;
+			if (havePrevious) {
+				for (; i + kBytes <= rowBytes; i += kBytes) {
+					v16u8 cur = Load(line + i);
+					v16u8 a = Load(above + i);
+					// Motion if either field changed since the previous frame
+					v16u8 motion = Max(AbsDiff(cur, Load(prevLine + i)), AbsDiff(a, Load(prevAbove + i)));
+					v16u8 moving = (v16u8)(motion > threshold);
+					Store(out + i, Select(moving, Avg(a, Load(below + i)), cur));
+				}
+			}
+			for (; i < rowBytes; i++) {
+				uint8_t m = havePrevious ? (uint8_t)std::max(abs(line[i] - prevLine[i]), abs(above[i] - prevAbove[i])) : 255;
+				out[i] = m > motionThreshold ? (uint8_t)((above[i] + below[i] + 1) >> 1) : line[i];
+			}
+
+		}
+
+	}, 2);
+
+	for (uint32_t y = 0; y < src.height; y++)
+		memcpy(previous.data + y * rowBytes, src.data + y * stride, rowBytes);
+	previous.width = src.width;
+	previous.height = src.height;
+	previous.fourcc = src.fourcc;
+
+	return true;
+
+}
@@ -0,0 +1,106 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "DmabufPublisher.h"
+
+
+zs::DmabufPublisher::DmabufPublisher() : listener(-1) {
+
+
+}
+
+
+zs::DmabufPublisher::~DmabufPublisher() {
+
+	for (int client : clients)
+		close(client);
+	if (listener >= 0) {
+		close(listener);
+		unlink(path.c_str());
+	}
+
+}
+
+
+bool zs::DmabufPublisher::Open(const char* path) {
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	strcpy(addr.sun_path, path);
+
+	listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0)
+		return false;
+
+	unlink(path);
+	if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 4) < 0) {
+		close(listener);
+		listener = -1;
+		return false;
+	}
+
+	this->path = path;
+	return true;
+
+}
+
+
+void zs::DmabufPublisher::Publish(int dmabuf, const DmabufFrame& frame) {
+
+	if (listener < 0)
+		return;
+
+	for (;;) {
+		int client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (client < 0)
+			break;
+		clients.push_back(client);
+	}
+
+	if (dmabuf < 0 || clients.empty())
+		return;
+
+	struct iovec iov;
+	iov.iov_base = (void*)&frame;
+	iov.iov_len = sizeof(frame);
+
+	union {
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &dmabuf, sizeof(int));
+
+	for (size_t i = 0; i < clients.size();) {
+
+		if (sendmsg(clients[i], &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			// Gone
+			close(clients[i]);
+			clients.erase(clients.begin() + i);
+			continue;
+		}
+		i++;
+
+	}
+
+}
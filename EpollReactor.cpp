@@ -0,0 +1,111 @@
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "EpollReactor.h"
+
+
+#define MAX_EVENTS 16
+
+
+zs::EpollReactor::EpollReactor() : epfd(-1), stopfd(-1) {
+
+
+}
+
+
+zs::EpollReactor::~EpollReactor() {
+
+	if (stopfd >= 0)
+		close(stopfd);
+	if (epfd >= 0)
+		close(epfd);
+
+}
+
+
+bool zs::EpollReactor::Open() {
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0)
+		return false;
+
+	stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (stopfd < 0)
+		return false;
+
+	// Level triggered and never re-armed, so every thread sees it once stopped
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	return epoll_ctl(epfd, EPOLL_CTL_ADD, stopfd, &ev) == 0;
+
+}
+
+
+bool zs::EpollReactor::Add(int fd, uint32_t events, const Handler& handler) {
+
+	if (epfd < 0) {
+		errno = EBADF;
+		return false;
+	}
+
+	std::unique_ptr<Entry> entry(new Entry());
+	entry->fd = fd;
+	entry->events = events | EPOLLONESHOT;
+	entry->handler = handler;
+
+	struct epoll_event ev;
+	ev.events = entry->events;
+	ev.data.ptr = entry.get();
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+		return false;
+	entries.push_back(std::move(entry));
+	return true;
+
+}
+
+
+void zs::EpollReactor::Run(int timeoutMs, const std::function<void()>& idle) {
+
+	struct epoll_event events[MAX_EVENTS];
+	while (true) {
+
+		const int n = epoll_wait(epfd, events, MAX_EVENTS, timeoutMs);
+		if (n < 0 && errno != EINTR)
+			return;
+
+		for (int i = 0; i < n; i++) {
+
+			Entry* entry = (Entry*)events[i].data.ptr;
+			if (entry == nullptr)
+				return;
+			entry->handler(events[i].events);
+
+			// Hand the descriptor back to the set for the next thread that waits
+			struct epoll_event ev;
+			ev.events = entry->events;
+			ev.data.ptr = entry;
+			epoll_ctl(epfd, EPOLL_CTL_MOD, entry->fd, &ev);
+
+		}
+
+		if (idle)
+			idle();
+
+	}
+
+}
+
+
+void zs::EpollReactor::Stop() {
+
+	const uint64_t one = 1;
+	if (stopfd >= 0) {
+		const ssize_t written = write(stopfd, &one, sizeof(one));
+		(void)written;
+	}
+
+}
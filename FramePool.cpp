@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <unistd.h>
+#include "FramePool.h"
+
+
+zs::FramePool::FramePool() : state(std::make_shared<State>()) {
+
+
+}
+
+
+zs::FramePool::~FramePool() {
+
+	Trim();
+	std::lock_guard<std::mutex> guard(state->lock);
+	state->closed = true;
+
+}
+
+
+std::shared_ptr<uint8_t> zs::FramePool::Acquire(size_t size) {
+
+	uint8_t* data = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(state->lock);
+		for (size_t i = 0; i < state->idle.size(); i++) {
+			if (state->idle[i].size == size) {
+				data = state->idle[i].data;
+				state->idle.erase(state->idle.begin() + i);
+				break;
+			}
+		}
+	}
+
+	if (data == nullptr) {
+
+		void* p = nullptr;
+		if (posix_memalign(&p, (size_t)sysconf(_SC_PAGESIZE), size) != 0)
+			return std::shared_ptr<uint8_t>();
+		data = (uint8_t*)p;
+		std::lock_guard<std::mutex> guard(state->lock);
+		state->count++;
+		state->bytes += size;
+
+	}
+
+	std::shared_ptr<State> owner = state;
+	return std::shared_ptr<uint8_t>(data, [owner, size](uint8_t* p) {
+
+		std::lock_guard<std::mutex> guard(owner->lock);
+		if (owner->closed) {
+			owner->count--;
+			owner->bytes -= size;
+			free(p);
+			return;
+		}
+		owner->idle.push_back(Block{ size, p });
+
+	});
+
+}
+
+
+void zs::FramePool::Trim() {
+
+	std::lock_guard<std::mutex> guard(state->lock);
+	for (auto& block : state->idle) {
+		state->count--;
+		state->bytes -= block.size;
+		free(block.data);
+	}
+	state->idle.clear();
+
+}
+
+
+size_t zs::FramePool::GetAllocatedCount() {
+
+	std::lock_guard<std::mutex> guard(state->lock);
+	return state->count;
+
+}
+
+
+size_t zs::FramePool::GetAllocatedBytes() {
+
+	std::lock_guard<std::mutex> guard(state->lock);
+	return state->bytes;
+
+}
@@ -0,0 +1,227 @@
+#include "FrameRotator.h"
+#include "SimdOps.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 4
+// Block edge transposed in registers (pixels)
+#define BLOCK 8
+// Input columns walked together so whole cache lines are consumed
+#define TILE_COLUMNS 32
+
+
+using namespace zs::simd;
+
+
+namespace {
+
+	/// Reverse the order of the 4 pixel pairs of a 16-byte vector, swapping Y0/Y1 of every pair
+	inline v16u8 MirrorPairs(v16u8 v) {
+		return __builtin_shuffle(v, (v16u8){ 12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1 });
+	}
+
+	/// Mirror one pixel pair
+	inline void MirrorPair(const uint8_t* s, uint8_t* d) {
+		d[0] = s[0];
+		d[1] = s[3];
+		d[2] = s[2];
+		d[3] = s[1];
+	}
+
+}
+
+
+zs::FrameRotator::FrameRotator(StripeWorkers& workers) : workers(workers) {
+
+
+}
+
+
+zs::FrameRotator::~FrameRotator() {
+
+
+}
+
+
+bool zs::FrameRotator::Transform(Frame& src, uint32_t stride, uint32_t rotation, bool hflip, Frame& dst) {
+
+	if (stride == 0)
+		stride = src.width * 2;
+
+	if (src.data == nullptr ||
+		src.fourcc != (uint32_t)ValidFourccCodes::UYVY ||
+		src.width % 2 != 0 || src.height % 2 != 0 ||
+		src.width < MIN_FRAME_WIDTH ||
+		src.height < MIN_FRAME_HEIGHT ||
+		stride < src.width * 2)
+		return false;
+
+	const bool quarter = rotation == 90 || rotation == 270;
+	if (!quarter && rotation != 0 && rotation != 180)
+		return false;
+
+	const uint32_t size = src.width * src.height * 2;
+	if (dst.data == nullptr || dst.size != size) {
+
+		delete[] dst.data;
+		dst.size = size;
+		dst.data = new uint8_t[size];
+
+	}
+
+	dst.width = quarter ? src.height : src.width;
+	dst.height = quarter ? src.width : src.height;
+	dst.fourcc = src.fourcc;
+	dst.sourceID = src.sourceID;
+	dst.frameID = src.frameID;
+
+	switch (rotation) {
+	case 0:
+		FlipRows(src, stride, hflip, false, dst);
+		break;
+	case 180: // A half turn of a mirrored frame is a vertical flip
+		FlipRows(src, stride, !hflip, true, dst);
+		break;
+	case 90:
+		Transpose(src, stride, true, hflip, dst);
+		break;
+	case 270:
+		Transpose(src, stride, false, !hflip, dst);
+		break;
+	}
+
+	return true;
+
+}
+
+
+void zs::FrameRotator::FlipRows(Frame& src, uint32_t stride, bool mirror, bool upsideDown, Frame& dst) {
+
+	const uint32_t rowBytes = src.width * 2;
+
+	workers.Run(src.height, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t y = first; y < last; y++) {
+
+			const uint8_t* in = src.data + (upsideDown ? src.height - 1 - y : y) * stride;
+			uint8_t* out = dst.data + y * rowBytes;
+			if (!mirror) {
+				memcpy(out, in, rowBytes);
+				continue;
+			}
+			uint32_t i = 0;
+			for (; i + kBytes <= rowBytes; i += kBytes)
+				Store(out + i, MirrorPairs(Load(in + rowBytes - kBytes - i)));
+			for (; i < rowBytes; i += 4)
+				MirrorPair(in + rowBytes - 4 - i, out + i);
+
+		}
+
+	});
+
+}
+
+
+void zs::FrameRotator::Transpose(Frame& src, uint32_t stride, bool reverseRows, bool reverseColumns, Frame& dst) {
+
+	// Output row oy is input column x (reversed when reverseColumns), output
+	// column ox is input row y (reversed when reverseRows)
+	const uint32_t W = src.width;
+	const uint32_t H = src.height;
+	const uint32_t outStride = H * 2;
+	const bool blocks = W % BLOCK == 0 && H % BLOCK == 0;
+
+	workers.Run(W, [&](uint32_t first, uint32_t last) {
+
+		if (!blocks) {
+
+			// Odd sizes: one output pixel pair at a time
+			for (uint32_t oy = first; oy < last; oy++) {
+				const uint32_t x = reverseColumns ? W - 1 - oy : oy;
+				uint8_t* out = dst.data + oy * outStride;
+				for (uint32_t ox = 0; ox < H; ox += 2) {
+					const uint32_t y0 = reverseRows ? H - 1 - ox : ox;
+					const uint32_t y1 = reverseRows ? H - 2 - ox : ox + 1;
+					const uint8_t* p0 = src.data + y0 * stride + (x & ~1u) * 2;
+					const uint8_t* p1 = src.data + y1 * stride + (x & ~1u) * 2;
+					out[ox * 2] = (uint8_t)((p0[0] + p1[0] + 1) >> 1);
+					out[ox * 2 + 1] = p0[1 + (x & 1) * 2];
+					out[ox * 2 + 2] = (uint8_t)((p0[2] + p1[2] + 1) >> 1);
+					out[ox * 2 + 3] = p1[1 + (x & 1) * 2];
+				}
+			}
+			return;
+
+		}
+
+		// Stripes are whole blocks of output rows
+		for (uint32_t tile = first; tile < last; tile += TILE_COLUMNS) {
+
+			const uint32_t tileEnd = tile + TILE_COLUMNS < last ? tile + TILE_COLUMNS : last;
+
+			for (uint32_t by = 0; by < H; by += BLOCK) {
+
+				for (uint32_t bo = tile; bo < tileEnd; bo += BLOCK) {
+
+					// Input block: columns x0..x0+7, rows by..by+7
+					const uint32_t x0 = reverseColumns ? W - BLOCK - bo : bo;
+					const uint32_t ox0 = reverseRows ? H - BLOCK - by : by;
+
+					// Rows in output order
+					v16u8 r[BLOCK];
+					for (uint32_t k = 0; k < BLOCK; k++)
+						r[k] = Load(src.data + (reverseRows ? by + BLOCK - 1 - k : by + k) * stride + x0 * 2);
+
+					// Luma of every row in the low half, then an 8x8 byte transpose
+					v16u8 l[BLOCK];
+					for (uint32_t k = 0; k < BLOCK; k++)
+						l[k] = __builtin_shuffle(r[k], (v16u8){ 1, 3, 5, 7, 9, 11, 13, 15, 1, 3, 5, 7, 9, 11, 13, 15 });
+
+					v16u8 a[4];
+					for (uint32_t k = 0; k < 4; k++)
+						a[k] = __builtin_shuffle(l[2 * k], l[2 * k + 1], (v16u8){ 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23 });
+					v8u16 b0 = __builtin_shuffle((v8u16)a[0], (v8u16)a[1], (v8u16){ 0, 8, 1, 9, 2, 10, 3, 11 });
+					v8u16 b1 = __builtin_shuffle((v8u16)a[0], (v8u16)a[1], (v8u16){ 4, 12, 5, 13, 6, 14, 7, 15 });
+					v8u16 b2 = __builtin_shuffle((v8u16)a[2], (v8u16)a[3], (v8u16){ 0, 8, 1, 9, 2, 10, 3, 11 });
+					v8u16 b3 = __builtin_shuffle((v8u16)a[2], (v8u16)a[3], (v8u16){ 4, 12, 5, 13, 6, 14, 7, 15 });
+					// columns[c] holds luma of input columns 2c and 2c + 1, rows in output order
+					v16u8 columns[4];
+					columns[0] = (v16u8)__builtin_shuffle((v4u32)b0, (v4u32)b2, (v4u32){ 0, 4, 1, 5 });
+					columns[1] = (v16u8)__builtin_shuffle((v4u32)b0, (v4u32)b2, (v4u32){ 2, 6, 3, 7 });
+					columns[2] = (v16u8)__builtin_shuffle((v4u32)b1, (v4u32)b3, (v4u32){ 0, 4, 1, 5 });
+					columns[3] = (v16u8)__builtin_shuffle((v4u32)b1, (v4u32)b3, (v4u32){ 2, 6, 3, 7 });
+
+					// Chroma of output pair j is the average of rows 2j and 2j + 1,
+					// then a 4x4 transpose of the (U Y V Y) words gives one vector per input pair
+					v4u32 c[4];
+					for (uint32_t j = 0; j < 4; j++)
+						c[j] = (v4u32)Avg(r[2 * j], r[2 * j + 1]);
+					v4u32 t0 = __builtin_shuffle(c[0], c[1], (v4u32){ 0, 4, 1, 5 });
+					v4u32 t1 = __builtin_shuffle(c[0], c[1], (v4u32){ 2, 6, 3, 7 });
+					v4u32 t2 = __builtin_shuffle(c[2], c[3], (v4u32){ 0, 4, 1, 5 });
+					v4u32 t3 = __builtin_shuffle(c[2], c[3], (v4u32){ 2, 6, 3, 7 });
+					v16u8 chroma[4];
+					chroma[0] = (v16u8)__builtin_shuffle(t0, t2, (v4u32){ 0, 1, 4, 5 });
+					chroma[1] = (v16u8)__builtin_shuffle(t0, t2, (v4u32){ 2, 3, 6, 7 });
+					chroma[2] = (v16u8)__builtin_shuffle(t1, t3, (v4u32){ 0, 1, 4, 5 });
+					chroma[3] = (v16u8)__builtin_shuffle(t1, t3, (v4u32){ 2, 3, 6, 7 });
+
+					for (uint32_t k = 0; k < BLOCK; k++) {
+						// Input column x0 + k lands on output row bo + (reversed) k
+						const uint32_t col = reverseColumns ? BLOCK - 1 - k : k;
+						const v16u8 luma = columns[col >> 1];
+						const v16u8 out = (col & 1)
+							? __builtin_shuffle(chroma[col >> 1], luma, (v16u8){ 0, 24, 2, 25, 4, 26, 6, 27, 8, 28, 10, 29, 12, 30, 14, 31 })
+							: __builtin_shuffle(chroma[col >> 1], luma, (v16u8){ 0, 16, 2, 17, 4, 18, 6, 19, 8, 20, 10, 21, 12, 22, 14, 23 });
+						Store(dst.data + (bo + k) * outStride + ox0 * 2, out);
+					}
+
+				}
+
+			}
+
+		}
+
+	}, BLOCK);
+
+}
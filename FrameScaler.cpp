@@ -0,0 +1,186 @@
+#include "FrameScaler.h"
+#include "SimdOps.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 4
+// Rows of 255 a 16-bit lane can sum without overflow
+#define MAX_WIDE_ROWS 257
+
+
+using namespace zs::simd;
+
+
+zs::FrameScaler::FrameScaler(StripeWorkers& workers, ScaleFilter filter) :
+	workers(workers), filter(filter), tableSrcWidth(0), tableDstWidth(0), rowSrcHeight(0), rowDstHeight(0) {
+
+
+}
+
+
+zs::FrameScaler::~FrameScaler() {
+
+
+}
+
+
+void zs::FrameScaler::BuildTaps(uint32_t srcCount, uint32_t dstCount, std::vector<Tap>& taps) {
+
+	taps.resize(dstCount);
+	for (uint32_t i = 0; i < dstCount; i++) {
+
+		if (filter == ScaleFilter::Box) {
+			uint32_t first = (uint32_t)((uint64_t)i * srcCount / dstCount);
+			uint32_t last = (uint32_t)((uint64_t)(i + 1) * srcCount / dstCount);
+			taps[i].first = first;
+			taps[i].count = last > first ? last - first : 1;
+		}
+		else {
+			// Sample centres: (i + 0.5) * src / dst - 0.5, in 1/256
+			int64_t pos = (((int64_t)i * 2 + 1) * srcCount * 256) / ((int64_t)dstCount * 2) - 128;
+			if (pos < 0)
+				pos = 0;
+			taps[i].first = (uint32_t)(pos >> 8);
+			taps[i].count = (uint32_t)(pos & 255);
+			if (taps[i].first >= srcCount - 1) {
+				taps[i].first = srcCount - 1;
+				taps[i].count = 0;
+			}
+		}
+
+	}
+
+}
+
+
+void zs::FrameScaler::BuildTables(uint32_t srcWidth, uint32_t dstWidth) {
+
+	if (tableSrcWidth == srcWidth && tableDstWidth == dstWidth)
+		return;
+	BuildTaps(srcWidth, dstWidth, lumaTaps);
+	BuildTaps(srcWidth / 2, dstWidth / 2, chromaTaps);
+	tableSrcWidth = srcWidth;
+	tableDstWidth = dstWidth;
+
+}
+
+
+bool zs::FrameScaler::Scale(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcStride,
+	uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstStride) {
+
+	if (srcStride == 0)
+		srcStride = srcWidth * 2;
+	if (dstStride == 0)
+		dstStride = dstWidth * 2;
+
+	if (src == nullptr || dst == nullptr ||
+		srcWidth % 2 != 0 || dstWidth % 2 != 0 ||
+		srcWidth < MIN_FRAME_WIDTH || srcHeight < MIN_FRAME_HEIGHT / 2 ||
+		dstWidth < MIN_FRAME_WIDTH || dstHeight < MIN_FRAME_HEIGHT / 2)
+		return false;
+
+	BuildTables(srcWidth, dstWidth);
+	if (rowSrcHeight != srcHeight || rowDstHeight != dstHeight) {
+		BuildTaps(srcHeight, dstHeight, rowTaps);
+		rowSrcHeight = srcHeight;
+		rowDstHeight = dstHeight;
+	}
+
+	const uint32_t rowBytes = srcWidth * 2;
+	const bool box = filter == ScaleFilter::Box;
+
+	workers.Run(dstHeight, [&](uint32_t first, uint32_t last) {
+
+		// Vertically filtered source row, 32 bits per byte of UYVY, kept by each thread across frames
+		static thread_local std::vector<uint32_t> acc;
+		if (acc.size() < rowBytes + kBytes)
+			acc.resize(rowBytes + kBytes);
+
+		for (uint32_t oy = first; oy < last; oy++) {
+
+			const Tap& rt = rowTaps[oy];
+			const uint8_t* r0 = src + rt.first * srcStride;
+			uint32_t i = 0;
+
+			if (box) {
+				// Sum of rt.count rows, in 16-bit lanes for up to 257 rows at a time
+				for (; i + 8 <= rowBytes; i += 8) {
+					for (uint32_t l = 0; l < 8; l++)
+						acc[i + l] = 0;
+					for (uint32_t k = 0; k < rt.count; ) {
+						const uint32_t end = rt.count - k > MAX_WIDE_ROWS ? k + MAX_WIDE_ROWS : rt.count;
+						v8u16 sum = LoadWide(r0 + k * srcStride + i);
+						for (k++; k < end; k++)
+							sum += LoadWide(r0 + k * srcStride + i);
+						for (uint32_t l = 0; l < 8; l++)
+							acc[i + l] += sum[l];
+					}
+				}
+				for (; i < rowBytes; i++) {
+					uint32_t sum = 0;
+					for (uint32_t k = 0; k < rt.count; k++)
+						sum += r0[k * srcStride + i];
+					acc[i] = sum;
+				}
+			}
+			else {
+				// Blend of two rows in 1/256, stays below 65536
+				const uint8_t* r1 = rt.count ? r0 + srcStride : r0;
+				const v8u16 w1 = Splat16((uint16_t)rt.count);
+				const v8u16 w0 = Splat16((uint16_t)(256 - rt.count));
+				for (; i + 8 <= rowBytes; i += 8) {
+					v8u16 v = LoadWide(r0 + i) * w0 + LoadWide(r1 + i) * w1;
+					for (uint32_t l = 0; l < 8; l++)
+						acc[i + l] = v[l];
+				}
+				for (; i < rowBytes; i++)
+					acc[i] = r0[i] * (256 - rt.count) + r1[i] * rt.count;
+			}
+
+			// Horizontal pass: luma at odd bytes, U/V at bytes 0/2 of each pair
+			uint8_t* out = dst + oy * dstStride;
+			const uint64_t vcount = box ? rt.count : 256;
+			for (uint32_t ox = 0; ox < dstWidth; ox++) {
+				const Tap& t = lumaTaps[ox];
+				uint32_t v;
+				if (box) {
+					uint64_t sum = 0;
+					for (uint32_t k = 0; k < t.count; k++)
+						sum += acc[(t.first + k) * 2 + 1];
+					const uint64_t n = vcount * t.count;
+					v = (uint32_t)((sum + n / 2) / n);
+				}
+				else {
+					const uint32_t a = acc[t.first * 2 + 1];
+					const uint32_t b = t.count ? acc[(t.first + 1) * 2 + 1] : a;
+					v = (a * (256 - t.count) + b * t.count + 32768) >> 16;
+				}
+				out[ox * 2 + 1] = (uint8_t)v;
+			}
+			for (uint32_t op = 0; op < dstWidth / 2; op++) {
+				const Tap& t = chromaTaps[op];
+				for (uint32_t c = 0; c < 4; c += 2) {
+					uint32_t v;
+					if (box) {
+						uint64_t sum = 0;
+						for (uint32_t k = 0; k < t.count; k++)
+							sum += acc[(t.first + k) * 4 + c];
+						const uint64_t n = vcount * t.count;
+						v = (uint32_t)((sum + n / 2) / n);
+					}
+					else {
+						const uint32_t a = acc[t.first * 4 + c];
+						const uint32_t b = t.count ? acc[(t.first + 1) * 4 + c] : a;
+						v = (a * (256 - t.count) + b * t.count + 32768) >> 16;
+					}
+					out[op * 4 + c] = (uint8_t)v;
+				}
+			}
+
+		}
+
+	});
+
+	return true;
+
+}
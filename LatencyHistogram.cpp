@@ -0,0 +1,136 @@
+#include <cstdio>
+#include "LatencyHistogram.h"
+
+
+zs::LatencyHistogram::LatencyHistogram() {
+
+	Reset();
+
+}
+
+
+zs::LatencyHistogram::~LatencyHistogram() {
+
+
+}
+
+
+int zs::LatencyHistogram::Bucket(uint64_t micros) {
+
+	if (micros < 2 * Steps)
+		return (int)micros;
+
+	// Octave above 16 us, and the step within it
+	int octave = 0;
+	while ((micros >> (octave + 1)) >= 2 * Steps)
+		octave++;
+	if (octave >= Octaves)
+		return Buckets - 1;
+	return 2 * Steps + octave * Steps + (int)(micros >> (octave + 1)) - Steps;
+
+}
+
+
+uint64_t zs::LatencyHistogram::Lower(int bucket) {
+
+	if (bucket < 2 * Steps)
+		return (uint64_t)bucket;
+	const int octave = (bucket - 2 * Steps) / Steps;
+	const int step = (bucket - 2 * Steps) % Steps;
+	return (uint64_t)(Steps + step) << (octave + 1);
+
+}
+
+
+uint64_t zs::LatencyHistogram::Width(int bucket) {
+
+	if (bucket < 2 * Steps)
+		return 1;
+	return (uint64_t)2 << ((bucket - 2 * Steps) / Steps);
+
+}
+
+
+void zs::LatencyHistogram::Add(int64_t micros) {
+
+	counts[Bucket(micros > 0 ? (uint64_t)micros : 0)].fetch_add(1, std::memory_order_relaxed);
+
+}
+
+
+void zs::LatencyHistogram::Merge(const LatencyHistogram& other) {
+
+	for (int i = 0; i < Buckets; i++)
+		counts[i].fetch_add(other.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+}
+
+
+uint64_t zs::LatencyHistogram::Count() const {
+
+	uint64_t total = 0;
+	for (int i = 0; i < Buckets; i++)
+		total += counts[i].load(std::memory_order_relaxed);
+	return total;
+
+}
+
+
+uint64_t zs::LatencyHistogram::Percentile(double fraction) const {
+
+	const uint64_t total = Count();
+	if (total == 0)
+		return 0;
+
+	// Rank of the sample wanted, counted from 1
+	uint64_t rank = (uint64_t)(fraction * total + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	// Samples are taken as spread evenly over the bucket that holds the rank
+	uint64_t seen = 0;
+	for (int i = 0; i < Buckets - 1; i++) {
+		const uint64_t n = counts[i].load(std::memory_order_relaxed);
+		if (seen + n >= rank)
+			return Lower(i) + (uint64_t)(Width(i) * (rank - seen - 0.5) / n);
+		seen += n;
+	}
+	return Lower(Buckets - 1);
+
+}
+
+
+std::string zs::LatencyHistogram::Format() const {
+
+	std::string out;
+	char item[48];
+	uint64_t n = 0;
+	for (int i = 0; i < Buckets; i++) {
+		n += counts[i].load(std::memory_order_relaxed);
+
+		// Power of two above the bucket, the steps up to it are summed
+		uint64_t bound = 2;
+		while (bound <= Lower(i))
+			bound <<= 1;
+		if ((i < Buckets - 1) && (Lower(i + 1) < bound))
+			continue;
+		if (n == 0)
+			continue;
+		if (bound >= 10000)
+			snprintf(item, sizeof(item), "%s<%llums:%llu", out.empty() ? "" : " ", (unsigned long long)(bound / 1000), (unsigned long long)n);
+		else
+			snprintf(item, sizeof(item), "%s<%lluus:%llu", out.empty() ? "" : " ", (unsigned long long)bound, (unsigned long long)n);
+		out += item;
+		n = 0;
+	}
+	return out;
+
+}
+
+
+void zs::LatencyHistogram::Reset() {
+
+	for (int i = 0; i < Buckets; i++)
+		counts[i].store(0, std::memory_order_relaxed);
+
+}
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include "LensCorrector.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 2
+// Coordinates are 12.4 fixed point
+#define MAX_FRAME_SIZE 4096
+#define FRACTION_BITS 4
+#define ONE (1 << FRACTION_BITS)
+// Output tile (pixels), 4 KB of table
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 16
+// Entry of a pixel that maps outside the source
+#define OUTSIDE 0xFFFFFFFFu
+
+
+zs::LensCorrector::LensCorrector(StripeWorkers& workers) : workers(workers), mapWidth(0), mapHeight(0) {
+
+	parameters = LensParameters{ 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+}
+
+
+zs::LensCorrector::~LensCorrector() {
+
+
+}
+
+
+void zs::LensCorrector::SetParameters(const LensParameters& parameters) {
+
+	this->parameters = parameters;
+	if (this->parameters.zoom <= 0.0f)
+		this->parameters.zoom = 1.0f;
+	map.clear();
+	mapWidth = mapHeight = 0;
+
+}
+
+
+void zs::LensCorrector::Build(uint32_t width, uint32_t height) {
+
+	const LensParameters& p = parameters;
+	// Keep x + 1 and y + 1 of the bilinear footprint inside the frame
+	const float maxX = (float)(width - 1) - 1.0f / ONE;
+	const float maxY = (float)(height - 1) - 1.0f / ONE;
+
+	map.assign((size_t)width * height, OUTSIDE);
+	mapWidth = width;
+	mapHeight = height;
+
+	uint32_t* entry = map.data();
+	for (uint32_t ty = 0; ty < height; ty += TILE_HEIGHT) {
+
+		const uint32_t rows = std::min<uint32_t>(TILE_HEIGHT, height - ty);
+		for (uint32_t tx = 0; tx < width; tx += TILE_WIDTH) {
+
+			const uint32_t columns = std::min<uint32_t>(TILE_WIDTH, width - tx);
+			for (uint32_t y = ty; y < ty + rows; y++) {
+
+				for (uint32_t x = tx; x < tx + columns; x++, entry++) {
+
+					// Normalized undistorted position, then the distortion model gives the source position
+					const float u = (x - p.cx) / (p.fx * p.zoom);
+					const float v = (y - p.cy) / (p.fy * p.zoom);
+					const float r2 = u * u + v * v;
+					const float radial = 1.0f + r2 * (p.k1 + r2 * (p.k2 + r2 * p.k3));
+					const float du = u * radial + 2.0f * p.p1 * u * v + p.p2 * (r2 + 2.0f * u * u);
+					const float dv = v * radial + p.p1 * (r2 + 2.0f * v * v) + 2.0f * p.p2 * u * v;
+					float sx = du * p.fx + p.cx;
+					float sy = dv * p.fy + p.cy;
+
+					if (sx < -0.5f || sy < -0.5f || sx > width - 0.5f || sy > height - 0.5f)
+						continue;
+					sx = sx < 0.0f ? 0.0f : sx > maxX ? maxX : sx;
+					sy = sy < 0.0f ? 0.0f : sy > maxY ? maxY : sy;
+					*entry = (uint32_t)(sy * ONE + 0.5f) << 16 | (uint32_t)(sx * ONE + 0.5f);
+
+				}
+
+			}
+
+		}
+
+	}
+
+}
+
+
+bool zs::LensCorrector::Remap(Frame& src, uint32_t stride, Frame& dst) {
+
+	if (stride == 0)
+		stride = src.width * 2;
+
+	if (src.data == nullptr ||
+		src.fourcc != (uint32_t)ValidFourccCodes::UYVY ||
+		src.width % 2 != 0 ||
+		src.width < MIN_FRAME_WIDTH || src.width > MAX_FRAME_SIZE ||
+		src.height < MIN_FRAME_HEIGHT || src.height > MAX_FRAME_SIZE ||
+		stride < src.width * 2)
+		return false;
+
+	if (src.width != mapWidth || src.height != mapHeight)
+		Build(src.width, src.height);
+
+	const uint32_t size = src.width * src.height * 2;
+	if (dst.data == nullptr || dst.size != size) {
+
+		delete[] dst.data;
+		dst.size = size;
+		dst.data = new uint8_t[size];
+
+	}
+
+	dst.width = src.width;
+	dst.height = src.height;
+	dst.fourcc = src.fourcc;
+	dst.sourceID = src.sourceID;
+	dst.frameID = src.frameID;
+
+	const uint32_t width = src.width;
+	const uint32_t height = src.height;
+	const uint32_t lastPair = width / 2 - 1;
+	const uint8_t* in = src.data;
+	uint8_t* out = dst.data;
+	const uint32_t* table = map.data();
+
+	// Bilinear blend of 4 samples, weights in 1/16
+	auto blend = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t fx, uint32_t fy) -> uint8_t {
+		const uint32_t top = a * (ONE - fx) + b * fx;
+		const uint32_t bottom = c * (ONE - fx) + d * fx;
+		return (uint8_t)((top * (ONE - fy) + bottom * fy + ONE * ONE / 2) >> (2 * FRACTION_BITS));
+	};
+
+	// Stripes are rows of tiles
+	const uint32_t tileRows = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	workers.Run(tileRows, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t t = first; t < last; t++) {
+
+			const uint32_t ty = t * TILE_HEIGHT;
+			const uint32_t rows = std::min<uint32_t>(TILE_HEIGHT, height - ty);
+			const uint32_t* entry = table + (size_t)ty * width;
+			for (uint32_t tx = 0; tx < width; tx += TILE_WIDTH) {
+
+				const uint32_t columns = std::min<uint32_t>(TILE_WIDTH, width - tx);
+				for (uint32_t y = ty; y < ty + rows; y++) {
+
+					uint8_t* o = out + (y * width + tx) * 2;
+					for (uint32_t x = 0; x < columns; x += 2, entry += 2, o += 4) {
+
+						for (uint32_t i = 0; i < 2; i++) {
+
+							const uint32_t e = entry[i];
+							if (e == OUTSIDE) {
+								o[i * 2 + 1] = 16;
+								if (i == 0)
+									o[0] = o[2] = 128;
+								continue;
+							}
+
+							const uint32_t sx = e & 0xFFFF, sy = e >> 16;
+							const uint32_t fx = sx & (ONE - 1), fy = sy & (ONE - 1);
+							const uint8_t* row = in + (sy >> FRACTION_BITS) * stride;
+							const uint8_t* p = row + (sx >> FRACTION_BITS) * 2 + 1;
+							o[i * 2 + 1] = blend(p[0], p[2], p[stride], p[stride + 2], fx, fy);
+
+							if (i == 0) {
+
+								// Chroma of the pair, positioned at the even pixel
+								const uint32_t cx = sx >> 1;
+								const uint32_t pair = cx >> FRACTION_BITS;
+								const uint32_t cfx = cx & (ONE - 1);
+								const uint8_t* c0 = row + pair * 4;
+								const uint8_t* c1 = row + std::min(pair + 1, lastPair) * 4;
+								o[0] = blend(c0[0], c1[0], c0[stride], c1[stride], cfx, fy);
+								o[2] = blend(c0[2], c1[2], c0[stride + 2], c1[stride + 2], cfx, fy);
+
+							}
+
+						}
+
+					}
+
+				}
+
+			}
+
+		}
+
+	});
+
+	return true;
+
+}
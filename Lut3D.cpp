@@ -0,0 +1,305 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "Lut3D.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 2
+#define MAX_LUT_SIZE 65
+
+
+namespace {
+
+	typedef int32_t v4i32 __attribute__((vector_size(16)));
+	typedef int16_t v4i16 __attribute__((vector_size(8)));
+
+	/// Load a node widened to 32-bit lanes
+	inline v4i32 Node(const int16_t* p) { v4i16 v; memcpy(&v, p, sizeof(v)); return __builtin_convertvector(v, v4i32); }
+
+	/// Clamp to 0..255
+	inline uint8_t Clamp(int32_t v) { return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v); }
+
+	/// Luma weights of a matrix
+	void Weights(zs::ColorMatrix m, float& kr, float& kb) {
+		if (m == zs::ColorMatrix::BT601) { kr = 0.299f; kb = 0.114f; }
+		else { kr = 0.2126f; kb = 0.0722f; }
+	}
+
+}
+
+
+zs::Lut3D::Lut3D(StripeWorkers& workers) : workers(workers), size(0), matrix(ColorMatrix::BT709) {
+
+	for (int c = 0; c < 3; c++) {
+		domainMin[c] = 0.0f;
+		domainMax[c] = 1.0f;
+	}
+
+}
+
+
+zs::Lut3D::~Lut3D() {
+
+
+}
+
+
+bool zs::Lut3D::LoadCube(const char* path) {
+
+	FILE* f = fopen(path, "r");
+	if (f == nullptr) {
+		error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	uint32_t n = 0;
+	float dmin[3] = { 0.0f, 0.0f, 0.0f }, dmax[3] = { 1.0f, 1.0f, 1.0f };
+	std::vector<float> values;
+	char line[512];
+	uint32_t lineNumber = 0;
+	error.clear();
+
+	while (fgets(line, sizeof(line), f) != nullptr) {
+
+		lineNumber++;
+		char* p = line;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+			continue;
+
+		float r, g, b;
+		if (strncmp(p, "LUT_3D_SIZE", 11) == 0) {
+			n = (uint32_t)atoi(p + 11);
+		}
+		else if (strncmp(p, "DOMAIN_MIN", 10) == 0) {
+			sscanf(p + 10, "%f %f %f", &dmin[0], &dmin[1], &dmin[2]);
+		}
+		else if (strncmp(p, "DOMAIN_MAX", 10) == 0) {
+			sscanf(p + 10, "%f %f %f", &dmax[0], &dmax[1], &dmax[2]);
+		}
+		else if (strncmp(p, "LUT_1D_SIZE", 11) == 0) {
+			error = "1D LUTs are not supported";
+			break;
+		}
+		else if (sscanf(p, "%f %f %f", &r, &g, &b) == 3) {
+			values.push_back(r);
+			values.push_back(g);
+			values.push_back(b);
+		}
+		else if ((*p < 'A' || *p > 'Z')) {
+			error = "unexpected data on line " + std::to_string(lineNumber);
+			break;
+		}
+		// Other keywords (TITLE, ...) are ignored
+
+	}
+	fclose(f);
+
+	if (error.empty() && (n < 2 || n > MAX_LUT_SIZE))
+		error = "missing or invalid LUT_3D_SIZE";
+	if (error.empty() && values.size() != (size_t)n * n * n * 3)
+		error = "expected " + std::to_string(n * n * n) + " entries, found " + std::to_string(values.size() / 3);
+	for (int c = 0; error.empty() && c < 3; c++)
+		if (dmax[c] <= dmin[c])
+			error = "invalid domain";
+	if (!error.empty())
+		return false;
+
+	size = n;
+	rgb.swap(values);
+	for (int c = 0; c < 3; c++) {
+		domainMin[c] = dmin[c];
+		domainMax[c] = dmax[c];
+	}
+	Build();
+	return true;
+
+}
+
+
+void zs::Lut3D::SetMatrix(ColorMatrix matrix) {
+
+	this->matrix = matrix;
+	if (size > 0)
+		Build();
+
+}
+
+
+void zs::Lut3D::Build() {
+
+	float kr, kb;
+	Weights(matrix, kr, kb);
+	const float kg = 1.0f - kr - kb;
+
+	// YCbCr (limited range) to LUT coordinates in 1/256 of a node
+	float scale[3];
+	for (int c = 0; c < 3; c++)
+		scale[c] = (size - 1) * 256.0f / (domainMax[c] - domainMin[c]);
+	for (int i = 0; i < 256; i++) {
+		const float y = (i - 16) / 219.0f;
+		const float chroma = (i - 128) / 224.0f;
+		for (int c = 0; c < 3; c++)
+			yTable[c][i] = (int32_t)lrintf((y - domainMin[c]) * scale[c]);
+		crR[i] = (int32_t)lrintf(2.0f * (1.0f - kr) * chroma * scale[0]);
+		crG[i] = (int32_t)lrintf(-2.0f * kr * (1.0f - kr) / kg * chroma * scale[1]);
+		cbG[i] = (int32_t)lrintf(-2.0f * kb * (1.0f - kb) / kg * chroma * scale[1]);
+		cbB[i] = (int32_t)lrintf(2.0f * (1.0f - kb) * chroma * scale[2]);
+	}
+
+	// Output RGB to YCbCr in 1/64 code values, stored in the nodes
+	const size_t count = (size_t)size * size * size;
+	nodes.assign(count * 4, 0);
+	for (size_t i = 0; i < count; i++) {
+		const float r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+		const float y = kr * r + kg * g + kb * b;
+		const float v[3] = {
+			16.0f + 219.0f * y,
+			128.0f + 224.0f * (b - y) / (2.0f * (1.0f - kb)),
+			128.0f + 224.0f * (r - y) / (2.0f * (1.0f - kr))
+		};
+		for (int c = 0; c < 3; c++) {
+			float q = v[c] * 64.0f;
+			nodes[i * 4 + c] = (int16_t)lrintf(q < 0.0f ? 0.0f : q > 255.0f * 64.0f ? 255.0f * 64.0f : q);
+		}
+	}
+
+}
+
+
+bool zs::Lut3D::Apply(Frame& src, uint32_t stride, Frame& dst) {
+
+	const bool srcYUY2 = src.fourcc == (uint32_t)ValidFourccCodes::YUY2;
+
+	if (stride == 0)
+		stride = src.width * 2;
+
+	if (size == 0 || src.data == nullptr ||
+		(!srcYUY2 && src.fourcc != (uint32_t)ValidFourccCodes::UYVY) ||
+		src.width % 2 != 0 ||
+		src.width < MIN_FRAME_WIDTH ||
+		src.height < MIN_FRAME_HEIGHT ||
+		stride < src.width * 2)
+		return false;
+
+	// Stripes run in parallel, so an output sharing the source buffer must put every row
+	// exactly where its source row is, or one stripe overwrites rows another has not read
+	const uint32_t outSize = src.width * src.height * 2;
+	if (dst.data != nullptr) {
+
+		const uintptr_t srcBegin = (uintptr_t)src.data, srcEnd = srcBegin + (uintptr_t)stride * (src.height - 1) + src.width * 2;
+		const uintptr_t dstBegin = (uintptr_t)dst.data, dstEnd = dstBegin + outSize;
+		if (dstBegin < srcEnd && srcBegin < dstEnd && (dst.data != src.data || stride != src.width * 2))
+			return false;
+
+	}
+	if (dst.data == nullptr || dst.size != outSize) {
+
+		// The output may live in the source buffer, never free that one
+		if (dst.data != src.data)
+			delete[] dst.data;
+		dst.size = outSize;
+		dst.data = new uint8_t[outSize];
+
+	}
+
+	dst.width = src.width;
+	dst.height = src.height;
+	dst.fourcc = (uint32_t)ValidFourccCodes::UYVY;
+	dst.sourceID = src.sourceID;
+	dst.frameID = src.frameID;
+
+	Run(src.data, stride, srcYUY2, dst.data, src.width * 2, src.width, src.height);
+	return true;
+
+}
+
+
+bool zs::Lut3D::Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride) {
+
+	if (size == 0 || data == nullptr ||
+		width % 2 != 0 ||
+		width < MIN_FRAME_WIDTH ||
+		height < MIN_FRAME_HEIGHT ||
+		stride < width * 2)
+		return false;
+
+	Run(data, stride, false, data, stride, width, height);
+	return true;
+
+}
+
+
+void zs::Lut3D::Run(const uint8_t* srcData, uint32_t srcStride, bool srcYUY2, uint8_t* dstData, uint32_t dstStride, uint32_t width, uint32_t height) {
+
+	// Byte offsets of U, Y0, V, Y1 in a source pair
+	const uint32_t oU = srcYUY2 ? 1 : 0, oY0 = srcYUY2 ? 0 : 1, oV = srcYUY2 ? 3 : 2, oY1 = srcYUY2 ? 2 : 3;
+	const int32_t limit = (int32_t)(size - 1) * 256;
+	const int32_t n = (int32_t)size;
+	const int16_t* lut = nodes.data();
+
+	// Tetrahedral interpolation of one pixel, lanes are Y/Cb/Cr in 1/(64 * 256) code values
+	auto sample = [&](int32_t r, int32_t g, int32_t b) -> v4i32 {
+
+		r = r < 0 ? 0 : r > limit ? limit : r;
+		g = g < 0 ? 0 : g > limit ? limit : g;
+		b = b < 0 ? 0 : b > limit ? limit : b;
+		int32_t ri = r >> 8, gi = g >> 8, bi = b >> 8;
+		int32_t fr = r & 255, fg = g & 255, fb = b & 255;
+		// Stay inside the cube at the top edge
+		if (ri == n - 1) { ri--; fr = 256; }
+		if (gi == n - 1) { gi--; fg = 256; }
+		if (bi == n - 1) { bi--; fb = 256; }
+
+		const int32_t dr = 4, dg = 4 * n, db = 4 * n * n;
+		const int16_t* c000 = lut + (bi * n * n + gi * n + ri) * 4;
+		const v4i32 a = Node(c000);
+		const v4i32 c111 = Node(c000 + dr + dg + db);
+		v4i32 c1, c2;
+		int32_t f1, f2, f3;
+		if (fr > fg) {
+			if (fg > fb) { c1 = Node(c000 + dr); c2 = Node(c000 + dr + dg); f1 = fr; f2 = fg; f3 = fb; }
+			else if (fr > fb) { c1 = Node(c000 + dr); c2 = Node(c000 + dr + db); f1 = fr; f2 = fb; f3 = fg; }
+			else { c1 = Node(c000 + db); c2 = Node(c000 + dr + db); f1 = fb; f2 = fr; f3 = fg; }
+		}
+		else {
+			if (fb > fg) { c1 = Node(c000 + db); c2 = Node(c000 + dg + db); f1 = fb; f2 = fg; f3 = fr; }
+			else if (fb > fr) { c1 = Node(c000 + dg); c2 = Node(c000 + dg + db); f1 = fg; f2 = fb; f3 = fr; }
+			else { c1 = Node(c000 + dg); c2 = Node(c000 + dr + dg); f1 = fg; f2 = fr; f3 = fb; }
+		}
+		return a * 256 + (c1 - a) * f1 + (c2 - c1) * f2 + (c111 - c2) * f3;
+
+	};
+
+	workers.Run(height, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t y = first; y < last; y++) {
+
+			const uint8_t* in = srcData + y * srcStride;
+			uint8_t* out = dstData + y * dstStride;
+			for (uint32_t x = 0; x < width; x += 2) {
+
+				const uint8_t* p = in + x * 2;
+				const uint8_t u = p[oU], y0 = p[oY0], v = p[oV], y1 = p[oY1];
+				const int32_t r = crR[v], g = cbG[u] + crG[v], b = cbB[u];
+
+				const v4i32 s0 = sample(yTable[0][y0] + r, yTable[1][y0] + g, yTable[2][y0] + b);
+				const v4i32 s1 = sample(yTable[0][y1] + r, yTable[1][y1] + g, yTable[2][y1] + b);
+				// The pair shares the average chroma of both results
+				const v4i32 c = (s0 + s1 + (1 << 14)) >> 15;
+
+				uint8_t* q = out + x * 2;
+				q[0] = Clamp(c[1]);
+				q[1] = Clamp((s0[0] + (1 << 13)) >> 14);
+				q[2] = Clamp(c[2]);
+				q[3] = Clamp((s1[0] + (1 << 13)) >> 14);
+
+			}
+
+		}
+
+	});
+
+}
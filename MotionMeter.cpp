@@ -0,0 +1,93 @@
+#include "MotionMeter.h"
+#include "SimdOps.h"
+
+
+using namespace zs::simd;
+
+
+namespace {
+
+	/// Gather the luma bytes of a packed 4:2:2 row
+	void ExtractLuma(const uint8_t* row, uint32_t width, uint32_t lumaOffset, uint8_t* luma) {
+
+		const v16u8 even = { 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+		const v16u8 mask = lumaOffset ? even + 1 : even;
+		uint32_t x = 0;
+		for (; x + kBytes <= width; x += kBytes)
+			Store(luma + x, __builtin_shuffle(Load(row + x * 2), Load(row + x * 2 + kBytes), mask));
+		for (; x < width; x++)
+			luma[x] = row[x * 2 + lumaOffset];
+
+	}
+
+}
+
+
+zs::MotionMeter::MotionMeter(uint32_t rowStep) : rowStep(rowStep ? rowStep : 1) {
+
+	Reset();
+
+}
+
+
+zs::MotionMeter::~MotionMeter() {
+
+
+}
+
+
+void zs::MotionMeter::Reset() {
+
+	previous = 0;
+	planeWidth = planeHeight = 0;
+	peak = 0;
+
+}
+
+
+float zs::MotionMeter::Measure(const uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, uint32_t lumaOffset) {
+
+	if (data == nullptr || width == 0 || height == 0)
+		return -1.0f;
+
+	const uint32_t rows = (height + rowStep - 1) / rowStep;
+	const bool first = width != planeWidth || height != planeHeight;
+	if (first) {
+
+		for (int i = 0; i < 2; i++)
+			planes[i].assign((size_t)width * rows, 0);
+		planeWidth = width;
+		planeHeight = height;
+
+	}
+
+	uint8_t* current = planes[1 - previous].data();
+	const uint8_t* reference = planes[previous].data();
+	uint64_t sad = 0;
+	v16u8 peaks = Splat(0);
+	uint8_t tailPeak = 0;
+	for (uint32_t r = 0; r < rows; r++) {
+
+		uint8_t* luma = current + (size_t)r * width;
+		ExtractLuma(data + (size_t)r * rowStep * stride, width, lumaOffset & 1, luma);
+		if (!first)
+			sad += SadRow(luma, reference + (size_t)r * width, width);
+
+		uint32_t x = 0;
+		for (; x + kBytes <= width; x += kBytes)
+			peaks = Max(peaks, Load(luma + x));
+		for (; x < width; x++)
+			tailPeak = luma[x] > tailPeak ? luma[x] : tailPeak;
+
+	}
+	previous = 1 - previous;
+
+	peak = tailPeak;
+	for (uint32_t i = 0; i < kBytes; i++)
+		peak = peaks[i] > peak ? peaks[i] : peak;
+
+	if (first)
+		return -1.0f;
+	return (float)sad / ((float)width * rows);
+
+}
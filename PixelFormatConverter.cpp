@@ -181,6 +181,111 @@ bool zs::PixelFormatConverter::Convert(Frame& src, Frame& dst) {
 }
 
 
+bool zs::PixelFormatConverter::ConvertRegion(Frame& src, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height, Frame& dst) {
+
+	const bool srcYUY2 = src.fourcc == (uint32_t)ValidFourccCodes::YUY2;
+	const bool dstYUY2 = dst.fourcc == (uint32_t)ValidFourccCodes::YUY2;
+
+	if (stride == 0)
+		stride = src.width * 2;
+
+	if (src.data == nullptr ||
+		(!srcYUY2 && src.fourcc != (uint32_t)ValidFourccCodes::UYVY) ||
+		(!dstYUY2 && dst.fourcc != (uint32_t)ValidFourccCodes::UYVY) ||
+		x % 2 != 0 || width % 2 != 0 ||
+		x + width > src.width || y + height > src.height ||
+		width < MIN_FRAME_WIDTH ||
+		height < MIN_FRAME_HEIGHT ||
+		(size_t)src.size < (size_t)stride * (y + height - 1) + (x + width) * 2)
+		return false;
+
+	const uint32_t size = width * height * 2;
+	if (dst.data == nullptr || dst.size != size) {
+
+		// The output may live in the source buffer, never free that one
+		if (dst.data != src.data)
+			delete[] dst.data;
+		dst.size = size;
+		dst.data = new uint8_t[dst.size];
+
+	}
+
+	dst.width = width;
+	dst.height = height;
+	dst.sourceID = src.sourceID;
+	dst.frameID = src.frameID;
+
+	// Rows are written front to back and never ahead of the row being read,
+	// so converting in place into the start of the source buffer is safe
+	const bool swap = srcYUY2 != dstYUY2;
+	for (uint32_t row = 0; row < height; row++) {
+
+		const uint32_t* in = (const uint32_t*)(src.data + (y + row) * stride + x * 2);
+		uint32_t* out = (uint32_t*)(dst.data + row * width * 2);
+		if (!swap) {
+			memmove(out, in, width * 2);
+			continue;
+		}
+		for (uint32_t i = 0; i < width / 2; i++) {
+			const uint32_t pair = in[i];
+			out[i] = ((pair >> 8) & 0x00ff00ff) | ((pair & 0x00ff00ff) << 8);
+		}
+
+	}
+
+	return true;
+
+}
+
+
+bool zs::PixelFormatConverter::ConvertPlanar(const uint8_t* const planes[3], const uint32_t strides[3], uint32_t width, uint32_t height, Frame& dst) {
+
+	const bool dstYUY2 = dst.fourcc == (uint32_t)ValidFourccCodes::YUY2;
+
+	if (planes[0] == nullptr || planes[1] == nullptr ||
+		(!dstYUY2 && dst.fourcc != (uint32_t)ValidFourccCodes::UYVY) ||
+		width % 2 != 0 || height % 2 != 0 ||
+		width < MIN_FRAME_WIDTH ||
+		height < MIN_FRAME_HEIGHT)
+		return false;
+
+	const uint32_t size = width * height * 2;
+	if (dst.data == nullptr || dst.size != size) {
+
+		delete[] dst.data;
+		dst.size = size;
+		dst.data = new uint8_t[dst.size];
+
+	}
+
+	dst.width = width;
+	dst.height = height;
+
+	// Every chroma row serves two luma rows, pixel pairs are packed into one
+	// 32-bit word (little endian: U Y0 V Y1 for UYVY, Y0 U Y1 V for YUY2)
+	const bool nv12 = planes[2] == nullptr;
+	for (uint32_t row = 0; row < height; row++) {
+
+		const uint8_t* y = planes[0] + row * strides[0];
+		const uint8_t* u = planes[1] + (row / 2) * strides[1];
+		const uint8_t* v = nv12 ? u + 1 : planes[2] + (row / 2) * strides[2];
+		const uint32_t step = nv12 ? 2 : 1;
+		uint32_t* out = (uint32_t*)(dst.data + row * width * 2);
+		for (uint32_t i = 0; i < width / 2; i++) {
+			const uint32_t y0 = y[2 * i];
+			const uint32_t y1 = y[2 * i + 1];
+			const uint32_t cb = u[i * step];
+			const uint32_t cr = v[i * step];
+			out[i] = dstYUY2 ? (y0 | cb << 8 | y1 << 16 | cr << 24) : (cb | y0 << 8 | cr << 16 | y1 << 24);
+		}
+
+	}
+
+	return true;
+
+}
+
+
 void zs::PixelFormatConverter::GetVersion(uint32_t& major, uint32_t& minor) {
 
 	major = majorVersion;
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include "RegionBlur.h"
+#include "SimdOps.h"
+
+
+#define MIN_FRAME_WIDTH 4
+#define MIN_FRAME_HEIGHT 2
+// Window sums of 16-bit lanes hold (2 * 127 + 1) x 255
+#define MAX_RADIUS 127
+
+
+using namespace zs::simd;
+
+
+namespace {
+
+	/// Sliding box of one channel along a row, samples every step bytes
+	void BoxRow(const uint8_t* row, uint32_t count, uint32_t step, int32_t first, int32_t length, int32_t radius, uint8_t* out) {
+
+		const int32_t last = (int32_t)count - 1;
+		auto at = [&](int32_t i) -> uint32_t { return row[(i < 0 ? 0 : i > last ? last : i) * step]; };
+		const uint32_t taps = 2 * radius + 1;
+		const uint32_t inverse = (65536 + taps / 2) / taps;
+
+		uint32_t sum = 0;
+		for (int32_t i = first - radius; i <= first + radius; i++)
+			sum += at(i);
+		for (int32_t i = 0; i < length; i++) {
+			out[i * step] = (uint8_t)((sum * inverse + 32768) >> 16);
+			sum += at(first + i + radius + 1);
+			sum -= at(first + i - radius);
+		}
+
+	}
+
+	/// Widen a byte vector into two 16-bit vectors
+	inline void Widen(v16u8 v, v8u16& lo, v8u16& hi) {
+		v8u8 l, h;
+		memcpy(&l, &v, sizeof(l));
+		memcpy(&h, (const uint8_t*)&v + sizeof(l), sizeof(h));
+		lo = __builtin_convertvector(l, v8u16);
+		hi = __builtin_convertvector(h, v8u16);
+	}
+
+	/// Divide 16-bit window sums by the number of taps, (sum * inverse) >> 16 in 32-bit lanes
+	inline v8u8 Scale(v8u16 sum, uint32_t inverse) {
+		typedef uint32_t v8u32 __attribute__((vector_size(32)));
+		v8u32 wide = __builtin_convertvector(sum, v8u32);
+		wide = (wide * inverse + 32768) >> 16;
+		return __builtin_convertvector(wide, v8u8);
+	}
+
+}
+
+
+zs::RegionBlur::RegionBlur(StripeWorkers& workers) : workers(workers), radius(8) {
+
+
+}
+
+
+zs::RegionBlur::~RegionBlur() {
+
+
+}
+
+
+bool zs::RegionBlur::SetRegions(const std::vector<BlurRegion>& regions, uint32_t radius) {
+
+	if (radius < 1 || radius > MAX_RADIUS)
+		return false;
+
+	this->regions = regions;
+	this->radius = radius;
+	return true;
+
+}
+
+
+bool zs::RegionBlur::Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride) {
+
+	if (stride == 0)
+		stride = width * 2;
+
+	if (data == nullptr ||
+		width % 2 != 0 ||
+		width < MIN_FRAME_WIDTH ||
+		height < MIN_FRAME_HEIGHT ||
+		stride < width * 2)
+		return false;
+
+	for (const BlurRegion& r : regions) {
+
+		// Clip to the frame, whole pixel pairs only
+		BlurRegion clipped;
+		clipped.x = std::min(r.x & ~1u, width);
+		clipped.y = std::min(r.y, height);
+		clipped.width = (std::min(r.x + r.width, width) - clipped.x + 1) & ~1u;
+		clipped.width = std::min(clipped.width, width - clipped.x);
+		clipped.height = std::min(r.y + r.height, height) - clipped.y;
+		if (clipped.width > 0 && clipped.height > 0)
+			BlurOne(data, width, height, stride, clipped);
+
+	}
+
+	return true;
+
+}
+
+
+void zs::RegionBlur::BlurOne(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, const BlurRegion& region) {
+
+	const int32_t r = (int32_t)radius;
+	const int32_t chromaRadius = std::max<int32_t>(1, r / 2);
+	// Rows feeding the vertical window, the frame edge repeats
+	const uint32_t top = (uint32_t)std::max<int32_t>(0, (int32_t)region.y - r);
+	const uint32_t bottom = std::min<uint32_t>(height, region.y + region.height + r);
+	const uint32_t bytes = region.width * 2;
+	const uint32_t pitch = (bytes + kBytes - 1) & ~(kBytes - 1);
+	temp.resize((size_t)pitch * (bottom - top));
+	uint8_t* tmp = temp.data();
+
+	// Horizontal pass: Y with the luma radius, U and V with half of it
+	workers.Run(bottom - top, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t y = first; y < last; y++) {
+
+			const uint8_t* row = data + (size_t)(top + y) * stride;
+			uint8_t* out = tmp + (size_t)y * pitch;
+			BoxRow(row + 1, width, 2, region.x, region.width, r, out + 1);
+			BoxRow(row, width / 2, 4, region.x / 2, region.width / 2, chromaRadius, out);
+			BoxRow(row + 2, width / 2, 4, region.x / 2, region.width / 2, chromaRadius, out + 2);
+
+		}
+
+	});
+
+	// Vertical pass over 16-byte columns, all channels alike
+	const uint32_t taps = 2 * r + 1;
+	const uint32_t inverse = (65536 + taps / 2) / taps;
+	const int32_t lastRow = (int32_t)bottom - 1 - (int32_t)top;
+	const int32_t regionTop = (int32_t)region.y - (int32_t)top;
+	auto rowAt = [&](int32_t y) -> const uint8_t* {
+		// Rows above and below the frame repeat its edge
+		return tmp + (size_t)(y < 0 ? 0 : y > lastRow ? lastRow : y) * pitch;
+	};
+
+	workers.Run(pitch / kBytes, [&](uint32_t first, uint32_t last) {
+
+		for (uint32_t c = first; c < last; c++) {
+
+			const uint32_t offset = c * kBytes;
+			v8u16 sumLo = Splat16(0), sumHi = Splat16(0);
+			for (int32_t y = regionTop - r; y <= regionTop + r; y++) {
+				v8u16 lo, hi;
+				Widen(Load(rowAt(y) + offset), lo, hi);
+				sumLo += lo;
+				sumHi += hi;
+			}
+
+			const uint32_t valid = std::min(kBytes, bytes - offset);
+			uint8_t* out = data + (size_t)region.y * stride + region.x * 2 + offset;
+			for (int32_t y = regionTop; y < regionTop + (int32_t)region.height; y++, out += stride) {
+
+				v8u8 lo = Scale(sumLo, inverse), hi = Scale(sumHi, inverse);
+				uint8_t result[kBytes];
+				memcpy(result, &lo, sizeof(lo));
+				memcpy(result + sizeof(lo), &hi, sizeof(hi));
+				memcpy(out, result, valid);
+
+				v8u16 inLo, inHi, outLo, outHi;
+				Widen(Load(rowAt(y + r + 1) + offset), inLo, inHi);
+				Widen(Load(rowAt(y - r) + offset), outLo, outHi);
+				sumLo += inLo - outLo;
+				sumHi += inHi - outHi;
+
+			}
+
+		}
+
+	});
+
+}
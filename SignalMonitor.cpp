@@ -0,0 +1,89 @@
+#include "SignalMonitor.h"
+
+
+// Brightest sample of a black picture, limited range black is 16
+#define BLACK_PEAK 32
+// Mean luma change below which a picture counts as frozen
+#define FROZEN_CHANGE 0.05f
+
+
+zs::SignalMonitor::SignalMonitor() : blackAfter(0), frozenAfter(0), blackSince(-1), frozenSince(-1), lastFrame(0), lost(false), pictureState(SignalState::Live) {
+
+
+}
+
+
+zs::SignalMonitor::~SignalMonitor() {
+
+
+}
+
+
+void zs::SignalMonitor::SetThresholds(float blackAfter, float frozenAfter) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	this->blackAfter = blackAfter;
+	this->frozenAfter = frozenAfter;
+
+}
+
+
+void zs::SignalMonitor::FrameArrived(double now) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	lastFrame = now;
+
+}
+
+
+zs::SignalState zs::SignalMonitor::Update(const uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, uint32_t lumaOffset, double now) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	lastFrame = now;
+
+	if (blackAfter > 0 || frozenAfter > 0) {
+
+		const float change = meter.Measure(data, width, height, stride, lumaOffset);
+
+		const bool black = blackAfter > 0 && meter.GetPeakLuma() <= BLACK_PEAK;
+		if (!black)
+			blackSince = -1;
+		else if (blackSince < 0)
+			blackSince = now;
+
+		const bool frozen = frozenAfter > 0 && change >= 0 && change < FROZEN_CHANGE;
+		if (!frozen)
+			frozenSince = -1;
+		else if (frozenSince < 0)
+			frozenSince = now;
+
+		if (blackSince >= 0 && now - blackSince >= blackAfter)
+			pictureState = SignalState::Black;
+		else if (frozenSince >= 0 && now - frozenSince >= frozenAfter)
+			pictureState = SignalState::Frozen;
+		else
+			pictureState = SignalState::Live;
+
+	}
+
+	return lost ? SignalState::NoSignal : pictureState;
+
+}
+
+
+void zs::SignalMonitor::SetNoSignal(bool lost) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	this->lost = lost;
+
+}
+
+
+zs::SignalState zs::SignalMonitor::Check(double now, double timeout) {
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (lost || lastFrame == 0 || now - lastFrame > timeout)
+		return SignalState::NoSignal;
+	return pictureState;
+
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include "StripeWorkers.h"
+
+
+zs::StripeWorkers::StripeWorkers(uint32_t threadCount, const std::function<void()>& onStart) :
+	stop(false), onStart(onStart) {
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (uint32_t i = 1; i < threadCount; i++)
+		threads.emplace_back(&StripeWorkers::WorkerLoop, this);
+
+}
+
+
+zs::StripeWorkers::~StripeWorkers() {
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stop = true;
+	}
+	wake.notify_all();
+	for (auto& t : threads)
+		t.join();
+
+}
+
+
+uint32_t zs::StripeWorkers::GetThreadCount() const {
+
+	return (uint32_t)threads.size() + 1;
+
+}
+
+
+void zs::StripeWorkers::GetStripe(const Task& task, uint32_t index, uint32_t& first, uint32_t& last) const {
+
+	const uint32_t count = GetThreadCount();
+	uint32_t step = (task.rows + count - 1) / count;
+	step = (step + task.rowAlign - 1) / task.rowAlign * task.rowAlign;
+	first = index * step < task.rows ? index * step : task.rows;
+	last = first + step < task.rows ? first + step : task.rows;
+
+}
+
+
+void zs::StripeWorkers::RunStripe(Task& task, std::unique_lock<std::mutex>& guard) {
+
+	const uint32_t index = task.next++;
+	if (task.next == GetThreadCount())
+		tasks.erase(std::find(tasks.begin(), tasks.end(), &task));
+	guard.unlock();
+
+	uint32_t first, last;
+	GetStripe(task, index, first, last);
+	if (first < last)
+		(*task.job)(first, last);
+
+	guard.lock();
+	if (--task.pending == 0)
+		done.notify_all();
+
+}
+
+
+void zs::StripeWorkers::Run(uint32_t rows, const Job& job, uint32_t rowAlign) {
+
+	if (threads.empty() || rows < 2 * rowAlign) {
+		job(0, rows);
+		return;
+	}
+
+	Task task;
+	task.job = &job;
+	task.rows = rows;
+	task.rowAlign = rowAlign ? rowAlign : 1;
+	task.next = 0;
+	task.pending = GetThreadCount();
+
+	std::unique_lock<std::mutex> guard(lock);
+	tasks.push_back(&task);
+	wake.notify_all();
+
+	// Work on our own stripes rather than wait for workers busy with other callers
+	while (task.next < GetThreadCount())
+		RunStripe(task, guard);
+	while (task.pending > 0)
+		done.wait(guard);
+
+}
+
+
+void zs::StripeWorkers::WorkerLoop() {
+
+	if (onStart)
+		onStart();
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+
+		while (!stop && tasks.empty())
+			wake.wait(guard);
+		if (stop)
+			return;
+		RunStripe(*tasks.front(), guard);
+
+	}
+
+}
@@ -0,0 +1,128 @@
+#include "TemporalDenoiser.h"
+#include "SimdOps.h"
+
+
+// Every n-th row is used for the bitrate estimate
+#define STATS_ROW_STEP 16
+
+
+using namespace zs::simd;
+
+
+zs::TemporalDenoiser::TemporalDenoiser(StripeWorkers& workers, FramePool& pool) :
+	workers(workers), pool(pool), refWidth(0), refHeight(0), strength(8), threshold(10), energyIn(0), energyOut(0) {
+
+
+}
+
+
+zs::TemporalDenoiser::~TemporalDenoiser() {
+
+
+}
+
+
+void zs::TemporalDenoiser::SetParameters(uint8_t strength, uint8_t threshold) {
+
+	this->strength = strength > 15 ? 15 : strength;
+	this->threshold = threshold;
+
+}
+
+
+void zs::TemporalDenoiser::Reset() {
+
+	reference.reset();
+	refWidth = refHeight = 0;
+
+}
+
+
+double zs::TemporalDenoiser::GetEstimatedReduction() {
+
+	std::lock_guard<std::mutex> guard(statsLock);
+	double reduction = energyIn > 0 && energyOut < energyIn ? 100.0 * (double)(energyIn - energyOut) / (double)energyIn : 0.0;
+	energyIn = energyOut = 0;
+	return reduction;
+
+}
+
+
+bool zs::TemporalDenoiser::Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride) {
+
+	if (data == nullptr || width < 4 || height < 2 || stride < width * 2)
+		return false;
+
+	const uint32_t rowBytes = width * 2;
+
+	// First frame (or new geometry) only seeds the reference
+	if (!reference || refWidth != width || refHeight != height) {
+
+		reference = pool.Acquire((size_t)rowBytes * height);
+		if (!reference)
+			return false;
+		for (uint32_t y = 0; y < height; y++)
+			memcpy(reference.get() + y * rowBytes, data + y * stride, rowBytes);
+		refWidth = width;
+		refHeight = height;
+		return true;
+
+	}
+
+	uint8_t* ref = reference.get();
+	const v16u8 limit = Splat(threshold);
+	const v8u16 wRef = Splat16(strength);
+	const v8u16 wCur = Splat16(16 - strength);
+	const v8u16 round = Splat16(8);
+
+	workers.Run(height, [&](uint32_t first, uint32_t last) {
+
+		uint64_t inSum = 0, outSum = 0;
+
+		for (uint32_t y = first; y < last; y++) {
+
+			uint8_t* cur = data + y * stride;
+			uint8_t* prev = ref + y * rowBytes;
+			const bool sample = y % STATS_ROW_STEP == 0;
+			if (sample)
+				inSum += SadRow(cur, cur + 4, rowBytes - 4);
+
+			uint32_t i = 0;
+			for (; i + kBytes <= rowBytes; i += kBytes) {
+
+				v16u8 c = Load(cur + i);
+				v16u8 r = Load(prev + i);
+				v16u8 still = (v16u8)(AbsDiff(c, r) <= limit);
+
+				v8u16 lo = (LoadWide(cur + i) * wCur + LoadWide(prev + i) * wRef + round) >> 4;
+				v8u16 hi = (LoadWide(cur + i + 8) * wCur + LoadWide(prev + i + 8) * wRef + round) >> 4;
+				uint8_t blended[kBytes];
+				StoreNarrow(blended, lo);
+				StoreNarrow(blended + 8, hi);
+
+				v16u8 out = Select(still, Load(blended), c);
+				Store(cur + i, out);
+				Store(prev + i, out);
+
+			}
+			for (; i < rowBytes; i++) {
+				int d = cur[i] - prev[i];
+				if (d <= threshold && d >= -threshold)
+					cur[i] = (uint8_t)((cur[i] * (16 - strength) + prev[i] * strength + 8) >> 4);
+				prev[i] = cur[i];
+			}
+
+			if (sample)
+				outSum += SadRow(cur, cur + 4, rowBytes - 4);
+
+		}
+
+		std::lock_guard<std::mutex> guard(statsLock);
+		energyIn += inSum;
+		energyOut += outSum;
+
+	});
+
+	return true;
+
+}
@@ -11,5 +11,5 @@ fi
 cp "NDI SDK for Linux"/include/* include/
 cp "NDI SDK for Linux"/lib/aarch64-rpi4-linux-gnueabi/* lib/
 
-g++ -std=c++14 -pthread  -Wl,--allow-shlib-undefined -Wl,--as-needed -Iinclude/ -L lib -o build/v4l2ndi main.cpp PixelFormatConverter.cpp -lndi -ldl -g -O2
+g++ -std=c++14 -pthread  -Wl,--allow-shlib-undefined -Wl,--as-needed -Iinclude/ -L lib -o build/v4l2ndi main.cpp PixelFormatConverter.cpp StripeWorkers.cpp Deinterlacer.cpp FramePool.cpp TemporalDenoiser.cpp FrameRotator.cpp FrameScaler.cpp Compositor.cpp AlphaPacker.cpp Lut3D.cpp LensCorrector.cpp CadenceDetector.cpp MotionMeter.cpp SignalMonitor.cpp RegionBlur.cpp DmabufPublisher.cpp EpollReactor.cpp LatencyHistogram.cpp -lndi -ldl -g -O2
 
@@ -0,0 +1,60 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief Builds UYVA frames (UYVY plane followed by an alpha plane) from key and fill
+
+	The fill is copied into the UYVY plane and the luma of the key becomes
+	the alpha plane in the same pass over both sources.
+	*/
+	class AlphaPacker {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		*/
+		explicit AlphaPacker(StripeWorkers& workers);
+
+		/// Class destructor
+		~AlphaPacker();
+
+		/**
+		\brief Set key luma range
+		\param[in] limited TRUE - key luma 16..235 maps to alpha 0..255, FALSE - key luma is used as is
+		*/
+		void SetLimitedRange(bool limited);
+
+		/**
+		\brief Combine fill and key into a UYVA frame
+		\param[in] fill Fill frame data (UYVY or YUY2)
+		\param[in] fillStride Fill line stride (bytes, 0 - packed)
+		\param[in] fillYUY2 TRUE - fill is YUY2, FALSE - fill is UYVY
+		\param[in] key Key frame data (UYVY or YUY2) of the same size
+		\param[in] keyStride Key line stride (bytes, 0 - packed)
+		\param[in] keyYUY2 TRUE - key is YUY2, FALSE - key is UYVY
+		\param[in] width Frame width (pixels, even)
+		\param[in] height Frame height (pixels)
+		\param[out] dst UYVA output, width * height * 3 bytes
+		\return TRUE - success, FALSE - error
+		*/
+		bool Pack(const uint8_t* fill, uint32_t fillStride, bool fillYUY2,
+			const uint8_t* key, uint32_t keyStride, bool keyYUY2,
+			uint32_t width, uint32_t height, uint8_t* dst);
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Key luma range
+		bool limitedRange;
+
+	};//class...
+
+}//namespace...
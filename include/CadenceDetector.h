@@ -0,0 +1,91 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+
+
+namespace zs {
+
+	/**
+	\brief enum of detected repeat patterns
+	*/
+	enum class Cadence {
+
+		None,
+		Pulldown22,     ///< Every frame sent twice (30p in 60p)
+		Pulldown32      ///< Frames sent 2, 3, 2, 3 times (24p in 60p)
+
+	};
+
+
+	/**
+	\brief Detection of repeated frames and pulldown cadences
+
+	Every frame gets a 64-bit signature hashed over a sparse set of rows,
+	four 32-bit lanes at a time. A frame whose signature equals the one of
+	the previous frame is treated as an exact repeat. Digital sources
+	repeat frames bit for bit, so no tolerance is needed. The pattern of
+	repeats over the last 10 frames gives the cadence.
+	*/
+	class CadenceDetector {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] rowStep Hash every rowStep-th row
+		*/
+		explicit CadenceDetector(uint32_t rowStep = 8);
+
+		/// Class destructor
+		~CadenceDetector();
+
+		/**
+		\brief Hash a frame and compare it with the previous one
+		\param[in] data Image data (any packed format)
+		\param[in] rowBytes Bytes of image data per row
+		\param[in] height Number of rows
+		\param[in] stride Line stride (bytes)
+		\return TRUE - same picture as the previous frame, FALSE - new picture
+		*/
+		bool IsRepeat(const uint8_t* data, uint32_t rowBytes, uint32_t height, uint32_t stride);
+
+		/// Get cadence of the recent frames
+		Cadence GetCadence() const { return cadence; }
+
+		/// Get number of repeats found so far
+		uint64_t GetRepeatCount() const { return repeats; }
+
+		/// Forget the previous frame and the cadence
+		void Reset();
+
+		/**
+		\brief Signature of a frame
+		\param[in] data Image data
+		\param[in] rowBytes Bytes of image data per row
+		\param[in] height Number of rows
+		\param[in] stride Line stride (bytes)
+		\param[in] rowStep Hash every rowStep-th row
+		\return 64-bit hash
+		*/
+		static uint64_t Signature(const uint8_t* data, uint32_t rowBytes, uint32_t height, uint32_t stride, uint32_t rowStep);
+
+	private:
+
+		/// Rows between hashed rows
+		uint32_t rowStep;
+		/// Signature of the previous frame
+		uint64_t last;
+		/// TRUE when last is valid
+		bool haveLast;
+		/// Repeat flags of the recent frames, newest in bit 0
+		uint32_t history;
+		/// Number of valid bits in history
+		uint32_t frames;
+		/// Current cadence
+		Cadence cadence;
+		/// Repeats found
+		uint64_t repeats;
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,89 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <vector>
+#include <StripeWorkers.h>
+#include <FrameScaler.h>
+
+
+namespace zs {
+
+	/**
+	\brief Grid layout of several UYVY sources on one canvas
+
+	Sources are scaled straight into their tile of the canvas, so no
+	intermediate frames are needed.
+	*/
+	class Compositor {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to draw tiles
+		\param[in] filter Scaling filter for the tiles
+		*/
+		Compositor(StripeWorkers& workers, ScaleFilter filter = ScaleFilter::Box);
+
+		/// Class destructor
+		~Compositor();
+
+		/**
+		\brief Set canvas size and number of tiles
+		\param[in] width Canvas width (pixels)
+		\param[in] height Canvas height (pixels)
+		\param[in] tiles Number of tiles, laid out in a grid as square as possible (4 - 2x2)
+		\return TRUE - success, FALSE - error
+		*/
+		bool SetLayout(uint32_t width, uint32_t height, uint32_t tiles);
+
+		/**
+		\brief Scale a UYVY frame into its tile
+		\param[in] tile Tile index (row-major)
+		\param[in] src Source frame data
+		\param[in] srcWidth Source width (pixels)
+		\param[in] srcHeight Source height (pixels)
+		\param[in] srcStride Source line stride (bytes, 0 - packed)
+		\param[out] canvas Canvas data (packed UYVY)
+		\return TRUE - success, FALSE - error
+		*/
+		bool Draw(uint32_t tile, const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcStride, uint8_t* canvas);
+
+		/**
+		\brief Fill a tile with black
+		\param[in] tile Tile index (row-major)
+		\param[out] canvas Canvas data (packed UYVY)
+		*/
+		void Clear(uint32_t tile, uint8_t* canvas);
+
+		/**
+		\brief Fill the canvas outside all tiles with black
+		\param[out] canvas Canvas data (packed UYVY)
+		*/
+		void ClearBorders(uint8_t* canvas);
+
+		/// Get canvas width
+		uint32_t GetWidth() const { return width; }
+		/// Get canvas height
+		uint32_t GetHeight() const { return height; }
+
+	private:
+
+		/// Tile rectangle
+		struct Tile {
+			uint32_t x, y, width, height;
+		};
+
+		/// Scaler shared by all tiles
+		FrameScaler scaler;
+		/// Canvas size
+		uint32_t width, height;
+		/// Tiles
+		std::vector<Tile> tiles;
+
+		/// Fill a rectangle with black
+		void Fill(uint8_t* canvas, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,103 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <VideoDataStructures.h>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief enum of deinterlace algorithms
+	*/
+	enum class DeinterlaceMode {
+
+		/// Line-double every field into its own frame (doubles the frame rate)
+		Bob,
+		/// Vertical [1 2 1] blend of both fields into one frame
+		Blend,
+		/// Weave static areas, interpolate moving areas
+		MotionAdaptive
+
+	};
+
+
+	/**
+	\brief Deinterlacer for packed 4:2:2 (UYVY) frames
+
+	Works on whole rows of bytes, so luma and chroma of a UYVY pair are
+	filtered with the same vertical kernel and stay correctly paired.
+	*/
+	class Deinterlacer {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		*/
+		explicit Deinterlacer(StripeWorkers& workers);
+
+		/// Class destructor
+		~Deinterlacer();
+
+		/**
+		\brief Build a progressive frame from one field of an interleaved frame
+		\param[in] src Interleaved UYVY frame
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[in] bottomField TRUE - keep odd lines, FALSE - keep even lines
+		\param[out] dst Progressive frame of the same size
+		\return TRUE - success, FALSE - error
+		*/
+		bool Bob(Frame& src, uint32_t stride, bool bottomField, Frame& dst);
+
+		/**
+		\brief Build a progressive frame from a single field buffer (V4L2_FIELD_ALTERNATE)
+		\param[in] src UYVY field with height equal to half of the frame height
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[in] bottomField TRUE - field is the bottom field
+		\param[out] dst Progressive frame of twice the field height
+		\return TRUE - success, FALSE - error
+		*/
+		bool BobField(Frame& src, uint32_t stride, bool bottomField, Frame& dst);
+
+		/**
+		\brief Blend both fields of an interleaved frame
+		\param[in] src Interleaved UYVY frame
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[out] dst Progressive frame of the same size
+		\return TRUE - success, FALSE - error
+		*/
+		bool Blend(Frame& src, uint32_t stride, Frame& dst);
+
+		/**
+		\brief Motion-adaptive deinterlace of an interleaved frame
+		\param[in] src Interleaved UYVY frame
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[in] bottomFirst TRUE - bottom field is the older field
+		\param[out] dst Progressive frame of the same size
+		\return TRUE - success, FALSE - error
+		*/
+		bool MotionAdaptive(Frame& src, uint32_t stride, bool bottomFirst, Frame& dst);
+
+		/**
+		\brief Set motion threshold of the motion-adaptive mode
+		\param[in] threshold Per-sample difference treated as motion (default 12)
+		*/
+		void SetMotionThreshold(uint8_t threshold);
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Previous input frame for motion detection
+		Frame previous;
+		/// Motion threshold
+		uint8_t motionThreshold;
+
+		/// Check source and allocate destination
+		bool Prepare(Frame& src, uint32_t& stride, Frame& dst, uint32_t dstHeight);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,85 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace zs {
+
+	/**
+	\brief Description of a published capture buffer, sent with its DMABUF fd
+	*/
+	struct DmabufFrame {
+
+		/// V4L2 buffer index
+		uint32_t index;
+		/// Image size (pixels) and line stride (bytes)
+		uint32_t width, height, stride;
+		/// V4L2 pixel format of the data
+		uint32_t fourcc;
+		/// Bytes of image data in the buffer
+		uint32_t bytesused;
+		/// Capture sequence number
+		uint32_t sequence;
+		/// Capture time (ns, CLOCK_MONOTONIC)
+		int64_t timestamp;
+
+	};
+
+
+	/**
+	\brief Hands capture buffers to local processes without copying
+
+	Listens on a Unix SOCK_SEQPACKET socket. Every published frame is sent
+	to each connected client as one DmabufFrame message with the buffer's
+	DMABUF file descriptor attached (SCM_RIGHTS). Clients map the fd and
+	bracket their reads with DMA_BUF_IOCTL_SYNC. Sends never block: a
+	client that is not keeping up misses frames.
+
+	Buffer ownership: frames are published as captured, before any
+	processing, and clients may only read them. There is no release
+	message; the buffer goes back to the driver once the sender is done
+	with it and is then overwritten by a later capture. A client must
+	finish reading within a frame period. The caller must not publish
+	buffers that it rewrites in place.
+	*/
+	class DmabufPublisher {
+
+	public:
+
+		/// Class constructor
+		DmabufPublisher();
+
+		/// Class destructor
+		~DmabufPublisher();
+
+		/**
+		\brief Create the listening socket
+		\param[in] path Socket path, an existing socket file is replaced
+		\return TRUE - success, FALSE - error (errno is set)
+		*/
+		bool Open(const char* path);
+
+		/**
+		\brief Accept new clients and send them a frame
+		\param[in] dmabuf DMABUF fd of the buffer
+		\param[in] frame Description of the buffer
+		*/
+		void Publish(int dmabuf, const DmabufFrame& frame);
+
+		/// Get number of connected clients
+		uint32_t GetClientCount() const { return (uint32_t)clients.size(); }
+
+	private:
+
+		/// Listening socket
+		int listener;
+		/// Socket path, removed on destruction
+		std::string path;
+		/// Connected clients
+		std::vector<int> clients;
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,77 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace zs {
+
+	/**
+	\brief Runs handlers for ready file descriptors from one epoll set
+
+	Any number of threads may call Run() on the same reactor. Descriptors are
+	registered one-shot and re-armed after their handler returns, so a handler
+	never runs on two threads at once and needs no locking of its own state.
+	*/
+	class EpollReactor {
+
+	public:
+
+		/// Handler of a ready descriptor, called with the epoll events
+		typedef std::function<void(uint32_t)> Handler;
+
+		/// Class constructor
+		EpollReactor();
+
+		/// Class destructor
+		~EpollReactor();
+
+		/**
+		\brief Create the epoll set
+		\return TRUE - success, FALSE - error (errno is set)
+		*/
+		bool Open();
+
+		/**
+		\brief Watch a descriptor
+		\param[in] fd Descriptor to watch, stays owned by the caller
+		\param[in] events Epoll events to wait for (EPOLLIN, EPOLLPRI, ...)
+		\param[in] handler Called on a reactor thread when the descriptor is ready
+		\return TRUE - success, FALSE - error (errno is set)
+		*/
+		bool Add(int fd, uint32_t events, const Handler& handler);
+
+		/**
+		\brief Dispatch ready descriptors until Stop() is called
+		\param[in] timeoutMs Longest wait before idle is called (-1 - forever)
+		\param[in] idle Called on this thread after every wait, may be empty
+		*/
+		void Run(int timeoutMs = -1, const std::function<void()>& idle = std::function<void()>());
+
+		/// Make every Run() return
+		void Stop();
+
+	private:
+
+		/// A watched descriptor
+		struct Entry {
+			int fd;
+			uint32_t events;
+			Handler handler;
+		};
+
+		/// Epoll set
+		int epfd;
+		/// Eventfd that wakes the threads in Run() to stop
+		int stopfd;
+		/// Watched descriptors, never moved while registered
+		std::vector<std::unique_ptr<Entry>> entries;
+		/// Protects entries
+		std::mutex lock;
+
+	};//class...
+
+}//namespace...
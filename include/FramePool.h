@@ -0,0 +1,83 @@
+#pragma once
+// VERSION: 1.0
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace zs {
+
+	/**
+	\brief Pool of page-aligned frame buffers
+
+	Buffers are handed out as shared pointers and go back to the pool when
+	the last reference is dropped, so steady-state processing does not
+	touch the allocator. Buffers still in use when the pool is destroyed
+	are freed by their last owner.
+	*/
+	class FramePool {
+
+	public:
+
+		/// Class constructor
+		FramePool();
+
+		/// Class destructor
+		~FramePool();
+
+		/**
+		\brief Get a buffer of at least the given size
+		\param[in] size Buffer size (bytes)
+		\return Page-aligned buffer or empty pointer if out of memory
+		*/
+		std::shared_ptr<uint8_t> Acquire(size_t size);
+
+		/**
+		\brief Free buffers that are not in use
+		*/
+		void Trim();
+
+		/**
+		\brief Get number of buffers owned by the pool
+		\return Buffers currently allocated, in use or idle
+		*/
+		size_t GetAllocatedCount();
+
+		/**
+		\brief Get total memory owned by the pool
+		\return Bytes currently allocated, in use or idle
+		*/
+		size_t GetAllocatedBytes();
+
+	private:
+
+		/// Idle buffer
+		struct Block {
+			/// Buffer size
+			size_t size;
+			/// Buffer memory
+			uint8_t* data;
+		};
+
+		/// Shared state, kept alive by outstanding buffers
+		struct State {
+			/// Protects the fields below
+			std::mutex lock;
+			/// Buffers ready for reuse
+			std::vector<Block> idle;
+			/// Buffers allocated
+			size_t count = 0;
+			/// Bytes allocated
+			size_t bytes = 0;
+			/// Set when the pool is gone and released buffers must be freed
+			bool closed = false;
+		};
+
+		/// Pool state
+		std::shared_ptr<State> state;
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,55 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <VideoDataStructures.h>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief Rotation and mirroring of UYVY frames
+
+	Quarter turns are done in 8x8 pixel blocks that are transposed in
+	vector registers, walking the frame in tiles so every input cache line
+	is used completely before it is evicted. Pixel pairs of the rotated
+	frame take the average chroma of the two source pixels, so the 4:2:2
+	chroma pairing stays valid.
+	*/
+	class FrameRotator {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		*/
+		explicit FrameRotator(StripeWorkers& workers);
+
+		/// Class destructor
+		~FrameRotator();
+
+		/**
+		\brief Mirror and rotate a frame
+		\param[in] src UYVY frame, width and height must be even
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[in] rotation Clockwise rotation (0, 90, 180 or 270 degrees)
+		\param[in] hflip Mirror the source horizontally before rotating
+		\param[out] dst Packed UYVY output frame
+		\return TRUE - success, FALSE - error
+		*/
+		bool Transform(Frame& src, uint32_t stride, uint32_t rotation, bool hflip, Frame& dst);
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+
+		/// 0 or 180 degrees, optionally mirrored
+		void FlipRows(Frame& src, uint32_t stride, bool mirror, bool upsideDown, Frame& dst);
+		/// 90 or 270 degrees, optionally mirrored
+		void Transpose(Frame& src, uint32_t stride, bool reverseRows, bool reverseColumns, Frame& dst);
+
+	};//class...
+
+}//namespace...
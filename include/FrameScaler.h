@@ -0,0 +1,92 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <vector>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief enum of scaling filters
+	*/
+	enum class ScaleFilter {
+
+		/// Average of all source pixels covered by the output pixel
+		Box,
+		/// Two-tap linear interpolation in each direction
+		Bilinear
+
+	};
+
+
+	/**
+	\brief Scaler for UYVY frames, meant for downscaling
+
+	Each output row is first filtered vertically over whole source rows with
+	vector arithmetic, then horizontally with per-column tables computed once
+	per geometry. Chroma is filtered per pixel pair so the output stays 4:2:2.
+	When upscaling, the box filter repeats the nearest source pixel.
+	*/
+	class FrameScaler {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		\param[in] filter Scaling filter
+		*/
+		FrameScaler(StripeWorkers& workers, ScaleFilter filter = ScaleFilter::Box);
+
+		/// Class destructor
+		~FrameScaler();
+
+		/**
+		\brief Scale a UYVY frame
+		\param[in] src Source frame data
+		\param[in] srcWidth Source width (pixels, even)
+		\param[in] srcHeight Source height (pixels)
+		\param[in] srcStride Source line stride (bytes, 0 - packed)
+		\param[out] dst Output frame data
+		\param[in] dstWidth Output width (pixels, even)
+		\param[in] dstHeight Output height (pixels)
+		\param[in] dstStride Output line stride (bytes, 0 - packed)
+		\return TRUE - success, FALSE - error
+		*/
+		bool Scale(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcStride,
+			uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstStride);
+
+	private:
+
+		/// Horizontal taps of one output sample
+		struct Tap {
+			/// First source sample
+			uint32_t first;
+			/// Number of source samples (box) or weight of the second sample in 1/256 (bilinear)
+			uint32_t count;
+		};
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Filter
+		ScaleFilter filter;
+		/// Geometry the tables were built for
+		uint32_t tableSrcWidth, tableDstWidth;
+		/// Luma taps per output pixel (source pixel units)
+		std::vector<Tap> lumaTaps;
+		/// Chroma taps per output pair (source pair units)
+		std::vector<Tap> chromaTaps;
+		/// Geometry the row taps were built for
+		uint32_t rowSrcHeight, rowDstHeight;
+		/// Vertical taps per output row (source row units)
+		std::vector<Tap> rowTaps;
+
+		/// Build horizontal tables
+		void BuildTables(uint32_t srcWidth, uint32_t dstWidth);
+		/// Build taps mapping srcCount samples onto dstCount samples
+		void BuildTaps(uint32_t srcCount, uint32_t dstCount, std::vector<Tap>& taps);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,86 @@
+#pragma once
+// VERSION: 1.0
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+namespace zs {
+
+	/**
+	\brief Histogram of latencies in microseconds, 8 linear steps per octave
+
+	Samples below 16 us get a bucket per microsecond. Above, every power of
+	two is split into 8 equal steps, so a bucket is never wider than 1/8 of
+	its value. Percentiles interpolate within the bucket. Samples are added
+	from the capture path and read from whichever thread reports, so the
+	counters are atomic.
+	*/
+	class LatencyHistogram {
+
+	public:
+
+		/// Linear steps per octave
+		static const int Steps = 8;
+		/// Octaves above the 1 us buckets, up to about 16 s
+		static const int Octaves = 20;
+		/// Number of buckets, the last one takes everything from about 16 s up
+		static const int Buckets = 2 * Steps + Octaves * Steps;
+
+		/// Class constructor
+		LatencyHistogram();
+
+		/// Class destructor
+		~LatencyHistogram();
+
+		/**
+		\brief Count a sample
+		\param[in] micros Latency (microseconds), negative samples count as 0
+		*/
+		void Add(int64_t micros);
+
+		/**
+		\brief Count the samples of another histogram too
+		\param[in] other Histogram to add, e.g. one reset after every report
+		*/
+		void Merge(const LatencyHistogram& other);
+
+		/**
+		\brief Total of the samples counted
+		\return Number of samples since the last Reset()
+		*/
+		uint64_t Count() const;
+
+		/**
+		\brief Latency below which a share of the samples fall
+		\param[in] fraction Share of the samples (0.5 - median, 0.99 - 99th percentile)
+		\return Latency (microseconds), interpolated within the bucket holding that sample, 0 - no samples
+		*/
+		uint64_t Percentile(double fraction) const;
+
+		/**
+		\brief Format the samples per power of two as "<4us:12 <8us:301 ..."
+		\return Summary line, empty with no samples
+		*/
+		std::string Format() const;
+
+		/// Drop all samples
+		void Reset();
+
+	private:
+
+		/// Bucket of a sample
+		static int Bucket(uint64_t micros);
+
+		/// First value of a bucket (microseconds)
+		static uint64_t Lower(int bucket);
+
+		/// Values in a bucket (microseconds)
+		static uint64_t Width(int bucket);
+
+		/// Samples per bucket
+		std::atomic<uint64_t> counts[Buckets];
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,90 @@
+#pragma once
+// VERSION: 1.0
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <VideoDataStructures.h>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief Camera intrinsics and distortion coefficients (OpenCV model)
+	*/
+	struct LensParameters {
+
+		/// Focal lengths (pixels)
+		float fx, fy;
+		/// Principal point (pixels)
+		float cx, cy;
+		/// Radial coefficients
+		float k1, k2, k3;
+		/// Tangential coefficients
+		float p1, p2;
+		/// Magnification of the corrected picture (1 - keep the focal length)
+		float zoom;
+
+	};
+
+
+	/**
+	\brief Lens distortion correction of UYVY frames
+
+	The source position of every output pixel is computed once, when the
+	first frame of a size arrives, and stored as 12.4 fixed point x and y
+	in one 32-bit entry. Chroma uses the entry of the even pixel of each
+	pair, so the table costs 4 bytes per output pixel: 8.3 MB at 1920x1080
+	and 33.2 MB at 3840x2160, the largest size supported is 4096 pixels per
+	side. Entries are stored tile by tile in the order the tiles are
+	processed, so the table is read sequentially while the source reads of
+	a tile stay within a few neighbouring lines.
+	*/
+	class LensCorrector {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of tiles
+		*/
+		explicit LensCorrector(StripeWorkers& workers);
+
+		/// Class destructor
+		~LensCorrector();
+
+		/**
+		\brief Set lens parameters, the table is rebuilt with the next frame
+		\param[in] parameters Intrinsics in pixels of the frames passed to Remap()
+		*/
+		void SetParameters(const LensParameters& parameters);
+
+		/**
+		\brief Correct a frame
+		\param[in] src UYVY frame, width must be even
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[out] dst Packed UYVY output frame of the source size
+		\return TRUE - success, FALSE - error
+		*/
+		bool Remap(Frame& src, uint32_t stride, Frame& dst);
+
+		/// Get size of the remap table (bytes)
+		size_t GetTableBytes() const { return map.size() * sizeof(uint32_t); }
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Lens parameters
+		LensParameters parameters;
+		/// Source positions, y << 16 | x in 1/16 pixel, tile by tile
+		std::vector<uint32_t> map;
+		/// Size the table was built for
+		uint32_t mapWidth, mapHeight;
+
+		/// Build the table for a frame size
+		void Build(uint32_t width, uint32_t height);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,113 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <VideoDataStructures.h>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief enum of YCbCr matrices (limited range)
+	*/
+	enum class ColorMatrix {
+
+		BT601,
+		BT709
+
+	};
+
+
+	/**
+	\brief 3D LUT color transform with tetrahedral interpolation
+
+	The LUT works on RGB, but its nodes are stored already converted back to
+	YCbCr. The YCbCr to RGB step is folded into per-channel tables and the
+	RGB to YCbCr step into the nodes, so a frame is transformed in a single
+	pass over packed 4:2:2 data. Nodes are 4 x 16-bit (8 bytes) in file
+	order, which keeps a 33^3 LUT under 300 KB.
+	*/
+	class Lut3D {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		*/
+		explicit Lut3D(StripeWorkers& workers);
+
+		/// Class destructor
+		~Lut3D();
+
+		/**
+		\brief Load a .cube file
+		\param[in] path File path
+		\return TRUE - success, FALSE - error (see GetError())
+		*/
+		bool LoadCube(const char* path);
+
+		/**
+		\brief Set the YCbCr matrix of the frames, rebuilds the tables
+		\param[in] matrix Color matrix
+		*/
+		void SetMatrix(ColorMatrix matrix);
+
+		/**
+		\brief Apply the LUT
+		\param[in] src Source image (UYVY or YUY2), width must be even
+		\param[in] stride Source line stride (bytes, 0 - packed)
+		\param[out] dst Packed UYVY output. It may be the source buffer itself only when the source is
+		packed (stride == width * 2), any other overlap with the source is refused
+		\return TRUE - success, FALSE - error
+		*/
+		bool Apply(Frame& src, uint32_t stride, Frame& dst);
+
+		/**
+		\brief Apply the LUT in place to UYVY data
+		\param[in,out] data Image data
+		\param[in] width Image width (even)
+		\param[in] height Image height
+		\param[in] stride Line stride (bytes)
+		\return TRUE - success, FALSE - error
+		*/
+		bool Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride);
+
+		/// Get number of nodes per axis (0 - not loaded)
+		uint32_t GetSize() const { return size; }
+
+		/// Get description of the last error
+		const std::string& GetError() const { return error; }
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Nodes per axis
+		uint32_t size;
+		/// Matrix of the frames
+		ColorMatrix matrix;
+		/// LUT as loaded, RGB per node
+		std::vector<float> rgb;
+		/// Domain of the LUT input
+		float domainMin[3], domainMax[3];
+		/// Output nodes, Y/Cb/Cr/0 in 1/64 code values
+		std::vector<int16_t> nodes;
+		/// LUT coordinates (1/256 node units) contributed by Y to R, G and B
+		int32_t yTable[3][256];
+		/// LUT coordinates contributed by Cb to G and B, and by Cr to R and G
+		int32_t cbG[256], cbB[256], crR[256], crG[256];
+		/// Last error
+		std::string error;
+
+		/// Rebuild tables and nodes for the current matrix
+		void Build();
+
+		/// Transform packed 4:2:2 rows into UYVY rows
+		void Run(const uint8_t* src, uint32_t srcStride, bool srcYUY2, uint8_t* dst, uint32_t dstStride, uint32_t width, uint32_t height);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,61 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <vector>
+
+
+namespace zs {
+
+	/**
+	\brief Inter-frame change of packed 4:2:2 frames
+
+	Luma of every rowStep-th row is gathered into a compact plane and
+	compared with the plane of the previous frame by vector SAD, so a 1080p
+	frame costs about 500 KB of reads.
+	*/
+	class MotionMeter {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] rowStep Measure every rowStep-th row
+		*/
+		explicit MotionMeter(uint32_t rowStep = 4);
+
+		/// Class destructor
+		~MotionMeter();
+
+		/**
+		\brief Compare a frame with the previous one
+		\param[in] data Image data (YUY2 or UYVY)
+		\param[in] width Image width (pixels)
+		\param[in] height Image height
+		\param[in] stride Line stride (bytes)
+		\param[in] lumaOffset Byte offset of the first luma sample (0 - YUY2, 1 - UYVY)
+		\return Mean absolute luma difference (0-255), -1 for the first frame of a size
+		*/
+		float Measure(const uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, uint32_t lumaOffset);
+
+		/// Get brightest luma sample of the last measured frame
+		uint8_t GetPeakLuma() const { return peak; }
+
+		/// Forget the previous frame
+		void Reset();
+
+	private:
+
+		/// Rows between measured rows
+		uint32_t rowStep;
+		/// Luma of the measured rows, current and previous frame
+		std::vector<uint8_t> planes[2];
+		/// Index of the previous frame in planes
+		int previous;
+		/// Size the planes were taken from
+		uint32_t planeWidth, planeHeight;
+		/// Brightest sample of the last frame
+		uint8_t peak;
+
+	};//class...
+
+}//namespace...
@@ -29,6 +29,30 @@ namespace zs {
 		*/
 		bool Convert(Frame& src, Frame& dst);
 
+		/**
+		\brief Method for converting a rectangle of a packed 4:2:2 image
+		\param[in] src Source image (YUY2 or UYVY)
+		\param[in] stride Source line stride in bytes (0 - packed)
+		\param[in] x Left edge of the rectangle (pixels, must be even)
+		\param[in] y Top edge of the rectangle (pixels)
+		\param[in] width Rectangle width (pixels, must be even)
+		\param[in] height Rectangle height (pixels)
+		\param[out] dst Output image (YUY2 or UYVY) of the rectangle size, may share the source buffer
+		\return TRUE - success, FALSE - error
+		*/
+		bool ConvertRegion(Frame& src, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height, Frame& dst);
+
+		/**
+		\brief Method for converting a 4:2:0 image held in separate planes to a packed 4:2:2 image
+		\param[in] planes Y, U and V planes, or Y and interleaved UV (NV12) planes with planes[2] = nullptr
+		\param[in] strides Line strides of the planes in bytes
+		\param[in] width Image width (pixels, must be even)
+		\param[in] height Image height (pixels, must be even)
+		\param[out] dst Output image (UYVY or YUY2)
+		\return TRUE - success, FALSE - error
+		*/
+		bool ConvertPlanar(const uint8_t* const planes[3], const uint32_t strides[3], uint32_t width, uint32_t height, Frame& dst);
+
 		/**
 		\brief Method to get version
 		\param[out] major Major index of version
@@ -0,0 +1,78 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <vector>
+#include <StripeWorkers.h>
+
+
+namespace zs {
+
+	/**
+	\brief Rectangle of a frame (pixels)
+	*/
+	struct BlurRegion {
+
+		uint32_t x, y;
+		uint32_t width, height;
+
+	};
+
+
+	/**
+	\brief Box blur of rectangular regions of UYVY frames (privacy masks)
+
+	Separable box filter with sliding-window sums: every output sample adds
+	the sample entering the window and subtracts the one leaving it, so the
+	cost depends on the masked area and not on the radius. The horizontal
+	pass runs per row, the vertical pass walks 16-byte columns in vector
+	registers. Pixels outside the frame repeat the edge, pixels outside the
+	region but inside the frame take part in the blur.
+	*/
+	class RegionBlur {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows and columns
+		*/
+		explicit RegionBlur(StripeWorkers& workers);
+
+		/// Class destructor
+		~RegionBlur();
+
+		/**
+		\brief Set regions to blur
+		\param[in] regions Rectangles, clipped to the frame when processing
+		\param[in] radius Box radius in luma pixels (1-127)
+		\return TRUE - success, FALSE - error
+		*/
+		bool SetRegions(const std::vector<BlurRegion>& regions, uint32_t radius);
+
+		/**
+		\brief Blur the regions in place
+		\param[in,out] data UYVY image data
+		\param[in] width Image width (pixels)
+		\param[in] height Image height
+		\param[in] stride Line stride (bytes)
+		\return TRUE - success, FALSE - error
+		*/
+		bool Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride);
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Regions to blur
+		std::vector<BlurRegion> regions;
+		/// Box radius (luma pixels)
+		uint32_t radius;
+		/// Horizontally blurred rows of the current region
+		std::vector<uint8_t> temp;
+
+		/// Blur one region, already clipped and aligned to pixel pairs
+		void BlurOne(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, const BlurRegion& region);
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,99 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <mutex>
+#include <MotionMeter.h>
+
+
+namespace zs {
+
+	/**
+	\brief enum of input signal states
+	*/
+	enum class SignalState {
+
+		Live,
+		NoSignal,       ///< No frames, or the receiver reports no link
+		Black,
+		Frozen
+
+	};
+
+
+	/**
+	\brief Tracks whether a capture carries a live picture
+
+	Combines what the driver reports (DV timing and power events) with
+	the frames themselves: no frames for a while, a peak luma at black
+	level, or no change between frames. Frames are fed from the capture
+	path and the state is read from the main loop, so all methods lock.
+	*/
+	class SignalMonitor {
+
+	public:
+
+		/// Class constructor
+		SignalMonitor();
+
+		/// Class destructor
+		~SignalMonitor();
+
+		/**
+		\brief Set the time a black or frozen picture must last to count
+		\param[in] blackAfter Seconds of black (0 - never treat black as lost)
+		\param[in] frozenAfter Seconds without change (0 - never treat frozen as lost)
+		*/
+		void SetThresholds(float blackAfter, float frozenAfter);
+
+		/**
+		\brief Note that a frame was dequeued, without looking at it
+		\param[in] now Monotonic time (seconds)
+		*/
+		void FrameArrived(double now);
+
+		/**
+		\brief Analyze a frame
+		\param[in] data Image data (YUY2 or UYVY)
+		\param[in] width Image width (pixels)
+		\param[in] height Image height
+		\param[in] stride Line stride (bytes)
+		\param[in] lumaOffset Byte offset of the first luma sample (0 - YUY2, 1 - UYVY)
+		\param[in] now Monotonic time (seconds)
+		\return State after this frame
+		*/
+		SignalState Update(const uint8_t* data, uint32_t width, uint32_t height, uint32_t stride, uint32_t lumaOffset, double now);
+
+		/**
+		\brief Set link state reported by the driver
+		\param[in] lost TRUE - no usable signal
+		*/
+		void SetNoSignal(bool lost);
+
+		/**
+		\brief Get state, taking the time since the last frame into account
+		\param[in] now Monotonic time (seconds)
+		\param[in] timeout Seconds without frames treated as no signal
+		\return Current state
+		*/
+		SignalState Check(double now, double timeout);
+
+	private:
+
+		/// Guards all members
+		std::mutex lock;
+		/// Change and peak luma of the frames
+		MotionMeter meter;
+		/// Seconds of black and frozen pictures that count as lost
+		float blackAfter, frozenAfter;
+		/// Start of the current black and frozen runs (< 0 - none)
+		double blackSince, frozenSince;
+		/// Time of the last frame
+		double lastFrame;
+		/// Driver reports no signal
+		bool lost;
+		/// State from the last analyzed frame
+		SignalState pictureState;
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,102 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <cstring>
+
+
+namespace zs {
+
+	/**
+	\brief Portable 128-bit vector helpers
+
+	Built on GCC vector extensions so the same code compiles to SSE2 on
+	x86_64 and to NEON on the Raspberry Pi builds.
+	*/
+	namespace simd {
+
+		/// 16 x 8-bit unsigned lanes
+		typedef uint8_t v16u8 __attribute__((vector_size(16)));
+		/// 8 x 8-bit unsigned lanes (half register)
+		typedef uint8_t v8u8 __attribute__((vector_size(8)));
+		/// 8 x 16-bit unsigned lanes
+		typedef uint16_t v8u16 __attribute__((vector_size(16)));
+		/// 4 x 32-bit unsigned lanes
+		typedef uint32_t v4u32 __attribute__((vector_size(16)));
+
+		/// Number of bytes processed per vector
+		const uint32_t kBytes = 16;
+
+		/// Unaligned load of 16 bytes
+		inline v16u8 Load(const uint8_t* p) { v16u8 v; memcpy(&v, p, sizeof(v)); return v; }
+		/// Unaligned store of 16 bytes
+		inline void Store(uint8_t* p, v16u8 v) { memcpy(p, &v, sizeof(v)); }
+		/// Broadcast a byte to all lanes
+		inline v16u8 Splat(uint8_t x) { v16u8 v = { x,x,x,x,x,x,x,x,x,x,x,x,x,x,x,x }; return v; }
+		/// Broadcast a 16-bit value to all lanes
+		inline v8u16 Splat16(uint16_t x) { v8u16 v = { x,x,x,x,x,x,x,x }; return v; }
+
+		/// Load 8 bytes widened to 16-bit lanes
+		inline v8u16 LoadWide(const uint8_t* p) { v8u8 v; memcpy(&v, p, sizeof(v)); return __builtin_convertvector(v, v8u16); }
+		/// Store 16-bit lanes narrowed (truncated) to 8 bytes
+		inline void StoreNarrow(uint8_t* p, v8u16 v) { v8u8 n = __builtin_convertvector(v, v8u8); memcpy(p, &n, sizeof(n)); }
+
+		/// Rounding average, (a + b + 1) / 2 without overflow (pavgb / vrhadd)
+		inline v16u8 Avg(v16u8 a, v16u8 b) { return (a | b) - ((a ^ b) >> 1); }
+		/// Per-lane maximum
+		inline v16u8 Max(v16u8 a, v16u8 b) { v16u8 m = (v16u8)(a > b); return (a & m) | (b & ~m); }
+		/// Per-lane minimum
+		inline v16u8 Min(v16u8 a, v16u8 b) { v16u8 m = (v16u8)(a > b); return (b & m) | (a & ~m); }
+		/// Per-lane absolute difference
+		inline v16u8 AbsDiff(v16u8 a, v16u8 b) { return Max(a, b) - Min(a, b); }
+		/// Per-lane select: mask ? a : b
+		inline v16u8 Select(v16u8 mask, v16u8 a, v16u8 b) { return (a & mask) | (b & ~mask); }
+
+		/// Per-lane absolute difference of 16-bit lanes
+		inline v8u16 AbsDiff16(v8u16 a, v8u16 b) { v8u16 m = (v8u16)(a > b); return ((a - b) & m) | ((b - a) & ~m); }
+		/// Per-lane minimum of 16-bit lanes
+		inline v8u16 Min16(v8u16 a, v8u16 b) { v8u16 m = (v8u16)(a > b); return (b & m) | (a & ~m); }
+
+		/// Horizontal sum of 16-bit lanes
+		inline uint32_t Sum16(v8u16 v) {
+			uint32_t s = 0;
+			for (int i = 0; i < 8; i++)
+				s += v[i];
+			return s;
+		}
+
+		/// Rounding average of two byte rows
+		inline void AverageRows(const uint8_t* a, const uint8_t* b, uint8_t* dst, uint32_t bytes) {
+			uint32_t i = 0;
+			for (; i + kBytes <= bytes; i += kBytes)
+				Store(dst + i, Avg(Load(a + i), Load(b + i)));
+			for (; i < bytes; i++)
+				dst[i] = (uint8_t)((a[i] + b[i] + 1) >> 1);
+		}
+
+		/// Widen both halves of a byte vector and add them into 16-bit lanes
+		inline v8u16 AddHalves(v16u8 v) {
+			v8u8 lo, hi;
+			memcpy(&lo, &v, sizeof(lo));
+			memcpy(&hi, (const uint8_t*)&v + sizeof(lo), sizeof(hi));
+			return __builtin_convertvector(lo, v8u16) + __builtin_convertvector(hi, v8u16);
+		}
+
+		/// Sum of absolute differences of two byte rows
+		inline uint64_t SadRow(const uint8_t* a, const uint8_t* b, uint32_t bytes) {
+			uint64_t sad = 0;
+			uint32_t i = 0;
+			while (i + kBytes <= bytes) {
+				// 16-bit lanes take 128 iterations of 2 x 255 before they can overflow
+				v8u16 acc = Splat16(0);
+				for (uint32_t n = 0; n < 128 && i + kBytes <= bytes; n++, i += kBytes)
+					acc += AddHalves(AbsDiff(Load(a + i), Load(b + i)));
+				sad += Sum16(acc);
+			}
+			for (; i < bytes; i++)
+				sad += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+			return sad;
+		}
+
+	}//namespace simd...
+
+}//namespace...
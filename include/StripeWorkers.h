@@ -0,0 +1,94 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace zs {
+
+	/**
+	\brief Small persistent thread pool that splits a frame into horizontal stripes
+
+	Every stage that works row by row hands its kernel to Run(), which slices
+	the rows into one stripe per thread. The calling thread processes the
+	first stripe itself, so a pool of N threads only keeps N - 1 workers.
+	Several threads may call Run() at once: their stripes queue up for the
+	same workers, and every caller works on its own stripes while it waits.
+	*/
+	class StripeWorkers {
+
+	public:
+
+		/// Stripe kernel, called with the first and one-past-last row
+		typedef std::function<void(uint32_t, uint32_t)> Job;
+
+		/**
+		\brief Class constructor
+		\param[in] threadCount Total number of threads including the caller (0 - one per CPU)
+		\param[in] onStart Called first on every worker thread (e.g. to set its scheduling), may be empty
+		*/
+		explicit StripeWorkers(uint32_t threadCount = 0, const std::function<void()>& onStart = std::function<void()>());
+
+		/// Class destructor
+		~StripeWorkers();
+
+		/**
+		\brief Run a kernel over rows [0, rows) and wait for all stripes
+		\param[in] rows Number of rows to process
+		\param[in] job Kernel to execute for every stripe
+		\param[in] rowAlign Stripe boundaries are multiples of this (e.g. 2 for field pairs)
+		*/
+		void Run(uint32_t rows, const Job& job, uint32_t rowAlign = 1);
+
+		/**
+		\brief Get number of threads taking part in Run()
+		\return Thread count including the caller
+		*/
+		uint32_t GetThreadCount() const;
+
+	private:
+
+		/// A call of Run() waiting for its stripes
+		struct Task {
+			/// Kernel of the call
+			const Job* job;
+			/// Rows to process
+			uint32_t rows;
+			/// Stripe alignment
+			uint32_t rowAlign;
+			/// Next stripe to hand out
+			uint32_t next;
+			/// Stripes not finished yet
+			uint32_t pending;
+		};
+
+		/// Worker thread body
+		void WorkerLoop();
+		/// Take the next stripe of a task and run it, called and returns with lock held
+		void RunStripe(Task& task, std::unique_lock<std::mutex>& guard);
+		/// Row range of a stripe
+		void GetStripe(const Task& task, uint32_t index, uint32_t& first, uint32_t& last) const;
+
+		/// Worker threads
+		std::vector<std::thread> threads;
+		/// Protects the fields below and the tasks
+		std::mutex lock;
+		/// Signals workers that a new task is queued
+		std::condition_variable wake;
+		/// Signals callers of Run() that stripes finished
+		std::condition_variable done;
+		/// Tasks with stripes not handed out yet, oldest first
+		std::deque<Task*> tasks;
+		/// Set to stop the workers
+		bool stop;
+		/// Called first on every worker thread
+		std::function<void()> onStart;
+
+	};//class...
+
+}//namespace...
@@ -0,0 +1,87 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <StripeWorkers.h>
+#include <FramePool.h>
+
+
+namespace zs {
+
+	/**
+	\brief Motion-gated recursive temporal denoiser for UYVY frames
+
+	Every sample is blended with the previous output where it changed by
+	less than the threshold and passed through unchanged where it moved.
+	The frame is filtered in place and the result becomes the reference
+	for the next frame, so only one reference frame is kept.
+	*/
+	class TemporalDenoiser {
+
+	public:
+
+		/**
+		\brief Class constructor
+		\param[in] workers Thread pool used to process stripes of rows
+		\param[in] pool Pool the reference frame is taken from
+		*/
+		TemporalDenoiser(StripeWorkers& workers, FramePool& pool);
+
+		/// Class destructor
+		~TemporalDenoiser();
+
+		/**
+		\brief Filter a UYVY frame in place
+		\param[in,out] data Frame data
+		\param[in] width Frame width (pixels)
+		\param[in] height Frame height (pixels)
+		\param[in] stride Line stride (bytes)
+		\return TRUE - success, FALSE - error
+		*/
+		bool Process(uint8_t* data, uint32_t width, uint32_t height, uint32_t stride);
+
+		/**
+		\brief Set filter parameters
+		\param[in] strength Weight of the reference in 1/16 (1..15, default 8)
+		\param[in] threshold Per-sample difference treated as motion (default 10)
+		*/
+		void SetParameters(uint8_t strength, uint8_t threshold);
+
+		/**
+		\brief Estimated reduction of the encoded size since the last call
+
+		NDI compresses every frame on its own, so its bitrate follows the
+		high-frequency energy of the picture. This compares the horizontal
+		gradient energy of sampled rows before and after filtering.
+		\return Reduction in percent (0 - no reduction)
+		*/
+		double GetEstimatedReduction();
+
+		/// Drop the reference so the next frame starts a new sequence
+		void Reset();
+
+	private:
+
+		/// Thread pool
+		StripeWorkers& workers;
+		/// Reference frame pool
+		FramePool& pool;
+		/// Reference frame (previous output)
+		std::shared_ptr<uint8_t> reference;
+		/// Geometry of the reference frame
+		uint32_t refWidth, refHeight;
+		/// Weight of the reference in 1/16
+		uint8_t strength;
+		/// Motion threshold
+		uint8_t threshold;
+		/// Gradient energy of sampled input rows
+		uint64_t energyIn;
+		/// Gradient energy of sampled output rows
+		uint64_t energyOut;
+		/// Protects energy counters
+		std::mutex statsLock;
+
+	};//class...
+
+}//namespace...
@@ -10,6 +10,10 @@
 #include <string.h>
 #include <assert.h>
 #include <iostream>
+#include <algorithm>
+#include <string>
+#include <math.h>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -23,70 +27,375 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <malloc.h>
+#include <linux/dma-buf.h>
+#include <linux/udmabuf.h>
 
 #include <linux/videodev2.h>
 #include <Processing.NDI.Lib.h>
 #include <PixelFormatConverter.h>
+#include <StripeWorkers.h>
+#include <Deinterlacer.h>
+#include <FramePool.h>
+#include <TemporalDenoiser.h>
+#include <FrameRotator.h>
+#include <FrameScaler.h>
+#include <Compositor.h>
+#include <AlphaPacker.h>
+#include <Lut3D.h>
+#include <LensCorrector.h>
+#include <CadenceDetector.h>
+#include <MotionMeter.h>
+#include <SignalMonitor.h>
+#include <RegionBlur.h>
+#include <DmabufPublisher.h>
+#include <EpollReactor.h>
+#include <LatencyHistogram.h>
 
 
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
 
 //Full NDI
 NDIlib_send_create_t NDI_send_create_desc;
-NDIlib_send_instance_t pNDI_full_send;
-NDIlib_video_frame_v2_t NDI_video_frame1;
-NDIlib_video_frame_v2_t NDI_video_frame2;
 
+// Shared by every device
 zs::PixelFormatConverter converter;
-zs::Frame yuy2Frame;
-zs::Frame uyvyFrame;
+std::unique_ptr<zs::StripeWorkers> workers;     // Conversion and processing stages of all devices
+zs::FramePool frame_pool;
+std::vector<zs::BlurRegion> blur_regions;
+
+enum field_send_mode {
+        FIELDS_OFF,
+        FIELDS_INTERLEAVED,     // Whole interlaced buffer as one interleaved frame
+        FIELDS_SEPARATE,        // Every field as its own NDI field frame
+};
 
 enum io_method {
         IO_METHOD_READ,
         IO_METHOD_MMAP,
         IO_METHOD_USERPTR,
+        IO_METHOD_DMABUF,       // Capture into udmabuf buffers owned by the application
 };
 
 struct buffer {
         void   *start;
         size_t  length;
+        int     dmabuf;         // DMABUF fd of the buffer, -1 if not exported
+        int     parked;         // Out of circulation after the pool shrank
+        unsigned int n_planes;  // Memory planes, more than one for NV12M and YUV420M
+        void   *plane_start[VIDEO_MAX_PLANES];  // Plane 0 is start, length and dmabuf again
+        size_t  plane_length[VIDEO_MAX_PLANES];
+        int     plane_dmabuf[VIDEO_MAX_PLANES];
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];     // Descriptors of a multi-planar buffer while queued or dequeued
+        int64_t captured;       // Driver's capture timestamp of the frame it holds (monotonic ns), 0 - not on our clock
+        int64_t dequeued;       // When it was dequeued (monotonic ns)
 };
 
 static char            *dev_name;
 static enum io_method   io = IO_METHOD_MMAP;
-static int              fd = -1;
-static unsigned int     n_buffers;
 static int              out_buf;
 static int              force_yuyv = 0;
 static int              force_uyvy = 0;
+static int              force_nv12 = 0;
+static int              force_i420 = 0;
 static int              width = 0;
 static int              height = 0;
 static float            fps_N = 30000;
 static float            fps_D = 1001;
+static bool             fps_requested = false;  // -n or -e given, the device is asked for that rate
 static char             *ndi_name;
-int                     m_width = 0;
-int                     m_height = 0;
-int                     m_format = 0;
-int                     frame_buffer = 0;
-uint8_t*                p_frame1;
-uint8_t*                p_frame2;
 int                     ndi_async = 0;
 int                     image_threaded = 0;
+int                     worker_threads = 0;
+int                     deinterlace = 0;
+zs::DeinterlaceMode     deinterlace_mode = zs::DeinterlaceMode::Bob;
+int                     field_mode = FIELDS_OFF;
+int                     denoise_strength = 0;
+int                     denoise_threshold = 10;
+char                    *lut_file = NULL;
+int                     lut_matrix = 0;         // 0 - from the frame height, otherwise 601 or 709
+int                     lens_correct = 0;
+int                     dedupe = 0;             // Skip frames that repeat the previous one
+unsigned int            buffer_count = 8;       // Capture buffers requested at start
+unsigned int            buffer_budget = 0;      // MB the capture buffers may take, 0 - no limit
+int                     latest_only = 0;        // Of the frames ready at a wakeup send only the newest
+int                     busy_poll_cpu = -1;     // Poll the capture from this core instead of waiting in select, -1 - off
+thread_local int64_t    frame_captured = 0;     // Capture and dequeue time (monotonic ns) of the frame being sent by this thread
+thread_local int64_t    frame_dequeued = 0;
+volatile sig_atomic_t   stop_requested = 0;     // SIGINT or SIGTERM, the capture loop winds down
+int                     memory_lock = 0;        // Lock the process in memory and prefault the capture buffers
+
+// Scheduling of a pipeline stage, from --rt-capture, --rt-convert and --rt-send
+struct stage_policy {
+  bool set = false;       // Given on the command line
+  int priority = 0;       // SCHED_FIFO priority, 0 - stay SCHED_OTHER
+  bool pinned = false;    // Runs on cpus only, otherwise on any core the process started with
+  cpu_set_t cpus;
+};
+stage_policy            rt_capture, rt_convert, rt_send;
+cpu_set_t               startup_cpus;           // Affinity of the process at start
+char                    *streams_file = NULL;   // Capture every device listed here, each into its own NDI sender
+int                     reactor_threads = 1;
+int                     dmabuf_export = 0;      // Export the MMAP buffers as DMABUF
+char                    *dmabuf_socket = NULL;  // Publish capture buffers to local processes here
+int                     blur_radius = 24;
+char                    *slate_file = NULL;
+float                   slate_fps = 5;
+float                   black_after = 0;        // Seconds of black treated as signal loss, 0 - never
+float                   frozen_after = 0;       // Seconds without change treated as signal loss, 0 - never
+float                   idle_fps = 0;           // Rate of static scenes, 0 - always full rate
+float                   idle_after = 2;         // Seconds without motion before the rate drops
+float                   idle_threshold = 1;     // Mean luma difference treated as motion
+zs::LensParameters      lens_parameters = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+int                     stats_interval = 10;    // Seconds between statistics reports
+int                     rotation = 0;           // Clockwise, applied after the flips
+int                     hflip = 0;
+int                     vflip = 0;
+int                     proxy = 0;
+int                     proxy_width = 640;
+int                     proxy_height = 360;
+float                   proxy_fps = 0;          // 0 - same rate as the full stream
+zs::ScaleFilter         proxy_filter = zs::ScaleFilter::Box;
+std::string             proxy_name;
+std::vector<std::string> multiview_devices;    // Devices composited into one grid
+int                     multiview_width = 1920;
+int                     multiview_height = 1080;
+int                     multiview_separate = 0; // Also send every input as its own stream
+const char              *key_dev_name = NULL;  // Key device, the fill is the main device
+int                     key_full_range = 0;
+int                     crop = 0;
+struct v4l2_rect        crop_rect;
+std::size_t             m_max_depth = 3;        // How many frames the image thread queues before dropping them
+
+// Pixel format of -f, -u, --nv12 or --i420, 0 - none given
+static unsigned int forced_format(void){
+  if(force_yuyv == 1){
+   return V4L2_PIX_FMT_YUYV;
+  }
+  if(force_uyvy == 1){
+   return V4L2_PIX_FMT_UYVY;
+  }
+  if(force_nv12 == 1){
+   return V4L2_PIX_FMT_NV12;
+  }
+  return (force_i420 == 1) ? V4L2_PIX_FMT_YUV420 : 0;
+}
 
-// Queues for communcating between threads
-// These (and the thread functions) should really be in C++ classes, but...
-std::size_t m_max_depth = 3;    // How many items we will queue before dropping them
-std::mutex m_lock;
-std::condition_variable m_condvar;
-std::queue<std::unique_ptr<v4l2_buffer>> m_queue;
-
-// Thread for processing frames
-std::thread image_thread;
-
-//Buffers
-struct buffer          *buffers;
+// A capture device and the pipeline that sends it: the single device, every device of --streams
+// and the inputs of multiview and key/fill. The options above are the defaults of every device,
+// the ones a device can change (--streams sets them per line, the source changes the rate) are
+// copied here.
+struct capture_device {
+  std::string device;                   // Path of the V4L2 device
+  std::string ndi_name;                 // Name of its NDI source
+  unsigned int format = forced_format(); // Pixel format to set, 0 - as the device is
+  int width = ::width;                  // Size to set, 0 - as the device is
+  int height = ::height;
+  float fps_N = ::fps_N;
+  float fps_D = ::fps_D;
+  bool fps_requested = ::fps_requested; // The device is asked for fps_N/fps_D, otherwise its own rate is sent
+  int crop = ::crop;                    // Cleared when the crop stops fitting the source
+  int sw_crop = 0;                      // Device could not crop, crop the capture buffer instead
+  struct v4l2_rect crop_rect = ::crop_rect;
+  int sw_rotation = 0;                  // What is left for the rotator after the device flips
+  int sw_hflip = 0;
+
+  // Capture
+  enum v4l2_buf_type capture_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;  // _MPLANE for CSI receivers and ISPs
+  int fd = -1;
+  struct buffer *buffers = nullptr;
+  unsigned int n_buffers = 0;
+  int m_width = 0;
+  int m_height = 0;
+  int m_format = 0;
+  int m_stride = 0;
+  unsigned int m_planes = 1;            // Memory planes of a capture buffer
+  int m_plane_stride[VIDEO_MAX_PLANES];
+  bool yuyv = false;                    // YUY2 capture, converted to UYVY
+  bool capture_planar = false;          // 4:2:0 capture (NV12, YUV420 and their multi-planar variants)
+  bool planar_direct = false;           // ... handed to NDI as it is, without converting to UYVY
+  double last_frame_time = 0;           // Capture timestamp of the newest frame (monotonic seconds), 0 - unknown
+  bool reconfigure_pending = false;     // The source changed, the capture is set up again
+  std::mutex serving;                   // Held by the thread serving the device
+
+  // Capture buffers, grown when the driver starves and shrunk when idle
+  std::mutex buffer_lock;
+  unsigned int buffer_count = ::buffer_count; // Buffers the pool shrinks back to
+  unsigned int buffer_active = 0;       // Buffers circulating between driver and application
+  unsigned int buffer_target = 0;       // Buffers that should circulate, requeues park the rest
+  unsigned int buffer_max = VIDEO_MAX_FRAME;
+  unsigned int buffer_high_water = 0;
+  int buffer_in_driver = 0;             // Queued and not dequeued yet
+  int buffer_in_driver_last = 0;        // buffer_in_driver right after the previous dequeue
+  uint32_t buffer_sequence = 0;         // Sequence of the previous dequeue
+  bool buffer_have_sequence = false;
+  double buffer_last_change = 0;        // Time the pool last grew or shrank
+  size_t buffer_length[VIDEO_MAX_PLANES]; // Plane sizes of application allocated buffers
+  int udmabuf_dev = -1;
+  std::vector<std::shared_ptr<uint8_t>> userptr_slots; // Buffers queued in the driver, by index
+  std::shared_ptr<uint8_t> userptr_dequeued;           // Buffer of the frame being processed
+  std::shared_ptr<uint8_t> userptr_held[2];            // Buffers of p_frame1/p_frame2
+
+  // Full NDI
+  NDIlib_send_instance_t pNDI_full_send = nullptr;
+  NDIlib_video_frame_v2_t NDI_video_frame1;
+  NDIlib_video_frame_v2_t NDI_video_frame2;
+  uint32_t receiver_wait = 10000;       // ms a capture waits for a receiver, 0 on a thread serving other devices too
+  int frame_buffer = 0;
+  uint8_t *p_frame1 = nullptr;
+  uint8_t *p_frame2 = nullptr;
+  zs::Frame yuy2Frame;
+  zs::Frame uyvyFrame;
+
+  // Proxy NDI, fed from the frames of the full stream
+  NDIlib_send_instance_t pNDI_proxy_send = nullptr;
+  std::unique_ptr<zs::FrameScaler> proxy_scaler;
+  std::thread proxy_thread;
+  std::mutex proxy_lock;
+  std::condition_variable proxy_condvar;
+  std::shared_ptr<uint8_t> proxy_pending;       // Latest scaled frame not yet sent
+  NDIlib_video_frame_v2_t NDI_proxy_frame;      // Description of proxy_pending
+  bool proxy_exit = false;
+  double proxy_next = 0;                        // Time the next proxy frame is due
+
+  // Processing stages
+  std::unique_ptr<zs::TemporalDenoiser> denoiser;
+  std::unique_ptr<zs::FrameRotator> rotator;
+  zs::Frame rot_frames[2];      // Ping-pong outputs of the rotator
+  int rot_index = 0;
+  NDIlib_video_frame_v2_t NDI_rot_frames[2];
+  std::unique_ptr<zs::Deinterlacer> deinterlacer;
+  std::unique_ptr<zs::Lut3D> lut;
+  std::unique_ptr<zs::LensCorrector> lens;
+  int lens_width = 0;           // Frame size lens_parameters are given for, 0 - not known yet
+  int lens_height = 0;
+  std::unique_ptr<zs::CadenceDetector> cadence;
+  std::unique_ptr<zs::MotionMeter> motion_meter;
+  std::unique_ptr<zs::SignalMonitor> signal_monitor;
+  std::unique_ptr<zs::DmabufPublisher> dmabuf_publisher;
+  std::unique_ptr<zs::RegionBlur> region_blur;
+  zs::Frame slate_frame;        // Sent in place of the capture while it has no picture
+  NDIlib_video_frame_v2_t NDI_slate_frame;
+  zs::SignalState reported = zs::SignalState::Live;     // Input state last printed
+  double last_slate = 0;
+  std::mutex send_lock;         // The slate is sent from the capture loop, frames possibly from the image thread
+  double idle_last_motion = 0;  // Time of the last capture with motion
+  double idle_last_sent = 0;
+  unsigned long idle_sent = 0;  // Frames sent and held back since the last report
+  unsigned long idle_skipped = 0;
+  zs::Frame lens_frames[2];     // Ping-pong outputs of the lens correction
+  int lens_index = 0;
+  NDIlib_video_frame_v2_t NDI_lens_frames[2];
+  zs::Frame deint_frames[2];    // Ping-pong outputs, NDI async keeps the last one in use
+  int deint_index = 0;
+  NDIlib_video_frame_v2_t NDI_deint_frames[2];
+  NDIlib_video_frame_v2_t NDI_field_frames[2];
+
+  // Statistics
+  double last_report = 0;
+  std::atomic<unsigned long> frames_sent{0};    // Since the last report
+  std::atomic<unsigned long> latest_dropped{0}; // Older frames given back to the driver in latest-only mode
+  zs::LatencyHistogram dequeue_latency;         // From the driver's capture timestamp to the dequeue
+  zs::LatencyHistogram convert_latency;         // From the dequeue to the processed frame reaching NDI
+  zs::LatencyHistogram send_latency;            // Time spent in the NDI send call
+  zs::LatencyHistogram glass_latency;           // From the capture timestamp to the frame sent
+  zs::LatencyHistogram run_latency[4];          // The four above over the whole run, for the report at exit
+  std::atomic<unsigned long> frames_lost{0};    // Frames the driver skipped, from gaps in the sequence numbers
+  std::atomic<unsigned long> frames_lost_run{0};
+
+  // Queue of the image thread
+  std::mutex m_lock;
+  std::condition_variable m_condvar;
+  std::queue<std::unique_ptr<v4l2_buffer>> m_queue;
+  std::thread image_thread;
+
+  // Setting up
+  void open_capture(bool input);
+  void probe_capture_type(void);
+  void apply_format(const struct v4l2_format &fmt);
+  void init_device(void);
+  void get_format(struct v4l2_format &fmt);
+  void init_capture_format(void);
+  void reset_device_crop(void);
+  bool init_crop(void);
+  void init_orientation(void);
+  void mmap_buffer(unsigned int b);
+  void init_mmap(void);
+  enum v4l2_memory io_memory(void);
+  size_t capture_length(void);
+  void plan_buffers(void);
+  void alloc_userptr(unsigned int b);
+  void init_userptr(void);
+  void export_buffer(unsigned int b);
+  void export_dmabuf(void);
+  void alloc_udmabuf(unsigned int b);
+  void init_dmabuf(void);
+  void init_capture_buffers(void);
+  void init_stages(void);
+  void open_senders(bool shared_thread);
+  void init_slate(void);
+  void init_frames(void);
+  void init_format_stages(void);
+  void start(void);
+  void start_capturing(void);
+  void stop_capturing(void);
+  void uninit_device(void);
+  void close_device(void);
+  void stop(void);
+
+  // Capturing
+  void park_buffer(unsigned int index);
+  void requeue_capture(unsigned int index);
+  bool buffer_dequeued(const struct v4l2_buffer *buf);
+  void grow_buffers(unsigned int count);
+  void tune_buffers(bool starved);
+  std::unique_ptr<v4l2_buffer> dequeue_capture(bool &starved);
+  void process_capture(std::unique_ptr<v4l2_buffer> buf);
+  int read_frame(void);
+  void subscribe_signal_events(void);
+  void dequeue_signal_events(void);
+  void reconfigure_capture(void);
+  void wakeup(bool readable, bool event);
+  void busy_poll_loop(void);
+
+  // Processing and sending
+  void queue_wait(void);
+  void queue_push(std::unique_ptr<v4l2_buffer> buf);
+  std::unique_ptr<v4l2_buffer> queue_pop_opt(void);
+  void report_latency(bool run);
+  void report_stats(void);
+  void send_video(const NDIlib_video_frame_v2_t *frame, bool async);
+  void proxy_frame(const NDIlib_video_frame_v2_t *frame);
+  void proxy_send_thread(void);
+  void output_frame(const NDIlib_video_frame_v2_t *frame, bool async);
+  void finish_frame(const NDIlib_video_frame_v2_t *frame, bool async);
+  void deinterlace_frame(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async);
+  void send_fields(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async);
+  void send_frame(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async);
+  void set_frame_data(NDIlib_video_frame_v2_t *frame, uint8_t *data, bool region_only);
+  bool convert_in_place(void);
+  bool convert_capture(zs::Frame &src, zs::Frame &dst);
+  uint8_t *capture_data(unsigned int index);
+  void capture_planes(const void *data, unsigned int index, const uint8_t *planes[3], uint32_t strides[3]);
+  bool convert_planes(const void *data, unsigned int index, zs::Frame &dst);
+  void set_frame_format(NDIlib_video_frame_v2_t *frame);
+  bool skip_capture(const void *p);
+  void stamp_frame(NDIlib_video_frame_v2_t *frame, unsigned int index);
+  void process_image_thread(void);
+  uint8_t *convert_planes_async(const void *p, unsigned int index, int slot);
+  void process_image_async(const void *p, int size, uint32_t field, unsigned int index);
+  void process_image(const void *p, int size, uint32_t field, unsigned int index);
+  bool has_receivers(void);
+  zs::SignalState service_signal(bool held = false);
+};
 
 static void errno_exit(const char *s){
   fprintf(stderr, "%s error %d, %s\\n", s, errno, strerror(errno));
@@ -133,51 +442,90 @@ static void open_device(const char *device_name, int &fd){ //open the device for
   }
 }
 
-static void init_device(const char *d_name, int fd, unsigned int d_type, unsigned int d_format, unsigned int d_width, unsigned int d_height){ //initialize device
+// Use the multi-planar API on devices that offer only that (CSI receivers, ISPs)
+void capture_device::probe_capture_type(void){
+  struct v4l2_capability cap;
+  CLEAR(cap);
+  if(-1 == xioctl(fd, VIDIOC_QUERYCAP, &cap)){
+   return; // init_device reports it
+  }
+  const uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+  if(!(caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE)){
+   capture_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+   fprintf(stderr, "%s uses the multi-planar API\n", device.c_str());
+  }
+}
+
+// Take size, pixel format and plane layout from a single- or multi-planar format
+void capture_device::apply_format(const struct v4l2_format &fmt){
+  if(V4L2_TYPE_IS_MULTIPLANAR(fmt.type)){
+   m_width = fmt.fmt.pix_mp.width;
+   m_height = fmt.fmt.pix_mp.height;
+   m_format = fmt.fmt.pix_mp.pixelformat;
+   m_planes = std::max((unsigned int)fmt.fmt.pix_mp.num_planes, 1u);
+   for(unsigned int p = 0; p < m_planes; ++p){
+    m_plane_stride[p] = fmt.fmt.pix_mp.plane_fmt[p].bytesperline;
+   }
+  }else{
+   m_width = fmt.fmt.pix.width;
+   m_height = fmt.fmt.pix.height;
+   m_format = fmt.fmt.pix.pixelformat;
+   m_planes = 1;
+   m_plane_stride[0] = fmt.fmt.pix.bytesperline;
+  }
+  m_stride = m_plane_stride[0];
+  yuyv = (m_format == V4L2_PIX_FMT_YUYV);
+  capture_planar = (m_format == V4L2_PIX_FMT_NV12) || (m_format == V4L2_PIX_FMT_NV12M)
+                || (m_format == V4L2_PIX_FMT_YUV420) || (m_format == V4L2_PIX_FMT_YUV420M);
+}
+
+void capture_device::init_device(void){ //initialize device
   struct v4l2_capability cap;
   struct v4l2_format fmt;
   //Query capabilities
   if(-1 == xioctl(fd, VIDIOC_QUERYCAP, &cap)){
    if(EINVAL == errno){
-    fprintf(stderr, "%s is no V4L2 device\n",d_name);
+    fprintf(stderr, "%s is no V4L2 device\n",device.c_str());
     exit(EXIT_FAILURE);
    }else{
     errno_exit("VIDIOC_QUERYCAP");
    }
   }
-  fprintf(stderr, "Path: %s ",d_name);
+  fprintf(stderr, "Path: %s ",device.c_str());
   fprintf(stderr, "Driver: %s \n",cap.driver);
-  if ((cap.capabilities & V4L2_CAP_VIDEO_OUTPUT)){fprintf(stderr, "%s support output\n",d_name);}
+  if ((cap.capabilities & V4L2_CAP_VIDEO_OUTPUT)){fprintf(stderr, "%s support output\n",device.c_str());}
 
-	if ((cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)){fprintf(stderr, "%s support capture\n",d_name);}
+	if ((cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)){fprintf(stderr, "%s support capture\n",device.c_str());}
 
-	if ((cap.capabilities & V4L2_CAP_READWRITE)){fprintf(stderr, "%s support read/write\n",d_name);}
-	if ((cap.capabilities & V4L2_CAP_STREAMING)){fprintf(stderr, "%s support streaming\n",d_name);}
-  if ((cap.capabilities & V4L2_CAP_VIDEO_M2M_MPLANE)){fprintf(stderr, "%s support m2m mplane\n",d_name);}
+	if ((cap.capabilities & V4L2_CAP_READWRITE)){fprintf(stderr, "%s support read/write\n",device.c_str());}
+	if ((cap.capabilities & V4L2_CAP_STREAMING)){fprintf(stderr, "%s support streaming\n",device.c_str());}
+  if ((cap.capabilities & V4L2_CAP_VIDEO_M2M_MPLANE)){fprintf(stderr, "%s support m2m mplane\n",device.c_str());}
   
-	if ((cap.capabilities & V4L2_CAP_TIMEPERFRAME)){fprintf(stderr, "%s support timeperframe\n",d_name);} 
+	if ((cap.capabilities & V4L2_CAP_TIMEPERFRAME)){fprintf(stderr, "%s support timeperframe\n",device.c_str());} 
   
   CLEAR(fmt);
-  fmt.type = d_type;
+  fmt.type = capture_type;
   if (xioctl(fd, VIDIOC_G_FMT, &fmt) == -1){
     fprintf(stderr, "Cannot get format\n");
 	  errno_exit("VIDIOC_G_FMT");
 	}
-  std::cout << "Current pixel format: " << fourcc(fmt.fmt.pix.pixelformat) << std::endl;
-  fprintf(stderr, "Current frame width: %u\n",fmt.fmt.pix.width); 
-  fprintf(stderr, "Current frame height: %u\n",fmt.fmt.pix.height);  
-
-  if (d_width != 0) {
-		fmt.fmt.pix.width = d_width;
-    fprintf(stderr, "Setting frame width to: %u\n",d_width);
+  apply_format(fmt);
+  std::cout << "Current pixel format: " << fourcc(m_format) << std::endl;
+  fprintf(stderr, "Current frame width: %u\n",m_width); 
+  fprintf(stderr, "Current frame height: %u\n",m_height);  
+
+  const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(capture_type);
+  if (width != 0) {
+		(mplane ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width) = width;
+    fprintf(stderr, "Setting frame width to: %u\n",width);
 	}
-	if (d_height != 0) {
-		fmt.fmt.pix.height = d_height;
-    fprintf(stderr, "Setting frame height to: %u\n",d_height);
+	if (height != 0) {
+		(mplane ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height) = height;
+    fprintf(stderr, "Setting frame height to: %u\n",height);
 	}
-	if (d_format != 0) {
-		fmt.fmt.pix.pixelformat = d_format;
-    std::cout << "Setting pixel format to: " << fourcc(d_format) << std::endl;
+	if (format != 0) {
+		(mplane ? fmt.fmt.pix_mp.pixelformat : fmt.fmt.pix.pixelformat) = format;
+    std::cout << "Setting pixel format to: " << fourcc(format) << std::endl;
 	}
   
   if (-1 == xioctl(fd, VIDIOC_S_FMT, &fmt)){
@@ -190,90 +538,675 @@ static void init_device(const char *d_name, int fd, unsigned int d_type, unsigne
 	  errno_exit("VIDIOC_G_FMT");
 	}
 
-  if((d_format != 0)&&(fmt.fmt.pix.pixelformat != d_format)){
-   std::cout << "Cannot set pixel format to: " << fourcc(d_format) << "." << " Current pixel format: " << fourcc(fmt.fmt.pix.pixelformat) << std::endl;  
+  apply_format(fmt);
+
+  if((format != 0)&&((unsigned int)m_format != format)){
+   std::cout << "Cannot set pixel format to: " << fourcc(format) << "." << " Current pixel format: " << fourcc(m_format) << std::endl;  
+  }
+
+  if((width != 0)&&(m_width != width)){
+   fprintf(stderr, "Cannot set frame width to: %u. Current width: %u\n",width, m_width);  
+  }
+
+  if((height != 0)&&(m_height != height)){
+   fprintf(stderr, "Cannot set frame height to: %u. Current height: %u\n",height, m_height);  
+  }
+}
+
+void capture_device::get_format(struct v4l2_format &fmt){
+  CLEAR(fmt);
+  fmt.type = capture_type;
+  if (xioctl(fd, VIDIOC_G_FMT, &fmt) == -1){
+   errno_exit("VIDIOC_G_FMT");
+  }
+  apply_format(fmt);
+}
+
+// Frame rate of DV timings as numerator and denominator, 1000/1001 rates such as 59.94 as N*1000/1001
+static bool dv_frame_rate(const struct v4l2_bt_timings &bt, float &n, float &d){
+  const uint64_t total = (uint64_t)V4L2_DV_BT_FRAME_WIDTH(&bt) * V4L2_DV_BT_FRAME_HEIGHT(&bt);
+  if((total == 0) || (bt.pixelclock == 0)){
+   return false;
+  }
+  const double fps = (double)bt.pixelclock / total;
+  const double ntsc = fps * 1.001;
+  if((fabs(fps - round(fps)) > 0.01) && (fabs(ntsc - round(ntsc)) < 0.01)){
+   n = round(ntsc) * 1000;
+   d = 1001;
+  }else{
+   n = round(fps);
+   d = 1;
+  }
+  return n > 0;
+}
+
+// HDMI and SDI receivers (TC358743, ADV7604) capture whatever the source sends. Lock on to the
+// detected timings, which also sets the capture size, and take the frame rate from them.
+static bool init_dv_timings(const char *d_name, int fd, float &n, float &d){
+  struct v4l2_dv_timings timings;
+  CLEAR(timings);
+  if(-1 == xioctl(fd, VIDIOC_QUERY_DV_TIMINGS, &timings)){
+   if((errno == ENOLINK) || (errno == ENOLCK) || (errno == ERANGE)){
+    fprintf(stderr, "%s: no usable signal (%s), keeping its current timings\n", d_name, strerror(errno));
+   }
+   return false; // ENOTTY - not a DV receiver
+  }
+  if(-1 == xioctl(fd, VIDIOC_S_DV_TIMINGS, &timings)){
+   fprintf(stderr, "Cannot set the detected timings on %s: %s\n", d_name, strerror(errno));
+   return false;
+  }
+  if(!dv_frame_rate(timings.bt, n, d)){
+   return false;
+  }
+  fprintf(stderr, "%s: source is %ux%u%s at %.2f fps\n", d_name, timings.bt.width, timings.bt.height,
+          timings.bt.interlaced ? "i" : "p", n / d);
+  return true;
+}
+
+// Ask the device for a frame rate with VIDIOC_S_PARM when requested, and read back the rate it
+// runs at into n/d, so the NDI frame rate is the real cadence. A device without
+// V4L2_CAP_TIMEPERFRAME has its reported rate taken only when adopt is set.
+static void init_frame_rate(const char *d_name, int fd, unsigned int d_type, float &n, float &d, bool requested, bool adopt){
+  struct v4l2_streamparm parm;
+  CLEAR(parm);
+  parm.type = d_type;
+  if(-1 == xioctl(fd, VIDIOC_G_PARM, &parm)){
+   fprintf(stderr, "%s does not report its frame rate, sending %.2f fps\n", d_name, n / d);
+   return;
+  }
+  const bool settable = (parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME) != 0;
+  if(requested && settable){
+   parm.parm.capture.timeperframe.numerator = lround(d);
+   parm.parm.capture.timeperframe.denominator = lround(n);
+   if(-1 == xioctl(fd, VIDIOC_S_PARM, &parm)){ // Fills in the rate the driver picked
+    fprintf(stderr, "Cannot set the frame rate of %s: %s\n", d_name, strerror(errno));
+    CLEAR(parm);
+    parm.type = d_type;
+    xioctl(fd, VIDIOC_G_PARM, &parm);
+   }
+  }
+  const struct v4l2_fract &tpf = parm.parm.capture.timeperframe;
+  if((tpf.numerator != 0) && (tpf.denominator != 0) && (settable || adopt)){
+   if(requested && ((double)tpf.denominator * d != (double)tpf.numerator * n)){
+    fprintf(stderr, "%s runs at %u/%u fps, not the %g/%g asked for\n", d_name, tpf.denominator, tpf.numerator, n, d);
+   }
+   n = tpf.denominator;
+   d = tpf.numerator;
+  }
+  fprintf(stderr, "%s: capturing at %.2f fps\n", d_name, n / d);
+}
+
+// Set the pixel format and size asked for, or keep the device's, and read the geometry
+void capture_device::init_capture_format(void){
+  if(format || width || height){
+   init_device(); //init v4l2 device
+  }else{ // Capture in the format the device is set to
+   struct v4l2_format fmt;
+   get_format(fmt);
+  }
+}
+
+// Let the device capture its whole picture again, after it adjusted a crop rectangle or a crop
+// no longer fits. The format goes back to the requested size, or to the default rectangle.
+void capture_device::reset_device_crop(void){
+  struct v4l2_selection sel;
+  CLEAR(sel);
+  sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  sel.target = V4L2_SEL_TGT_CROP_DEFAULT;
+  if(-1 == xioctl(fd, VIDIOC_G_SELECTION, &sel)){ // No cropping on the device, nothing to undo
+   return;
+  }
+  sel.target = V4L2_SEL_TGT_CROP;
+  if(-1 == xioctl(fd, VIDIOC_S_SELECTION, &sel)){
+   fprintf(stderr, "Cannot restore the device crop: %s\n", strerror(errno));
+  }
+  struct v4l2_format fmt;
+  get_format(fmt);
+  const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(fmt.type);
+  (mplane ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width) = width ? width : sel.r.width;
+  (mplane ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height) = height ? height : sel.r.height;
+  if(-1 == xioctl(fd, VIDIOC_S_FMT, &fmt)){
+   fprintf(stderr, "Cannot restore the capture size: %s\n", strerror(errno));
+  }
+  get_format(fmt);
+}
+
+// Crop on the device with the selection API, or fall back to cropping the capture buffers.
+// FALSE if the rectangle cannot be used on this capture, the error is printed.
+bool capture_device::init_crop(void){
+  struct v4l2_format fmt;
+  get_format(fmt);
+
+  // Pixel pairs share chroma and fields alternate lines, keep both intact
+  crop_rect.left &= ~1;
+  crop_rect.top &= ~1;
+  crop_rect.width &= ~1u;
+  if((crop_rect.width < 4) || (crop_rect.height < 4)){
+   fprintf(stderr, "Crop rectangle is too small\n");
+   return false;
+  }
+
+  struct v4l2_selection sel;
+  CLEAR(sel);
+  sel.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  sel.target = V4L2_SEL_TGT_CROP;
+  sel.r = crop_rect;
+  if((xioctl(fd, VIDIOC_S_SELECTION, &sel) != -1) && (sel.r.left == crop_rect.left) && (sel.r.top == crop_rect.top)
+     && (sel.r.width == crop_rect.width) && (sel.r.height == crop_rect.height)){
+   // Ask for an unscaled capture of the crop rectangle
+   const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(fmt.type);
+   (mplane ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width) = crop_rect.width;
+   (mplane ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height) = crop_rect.height;
+   if(-1 == xioctl(fd, VIDIOC_S_FMT, &fmt)){
+    fprintf(stderr, "Cannot capture the device crop unscaled: %s\n", strerror(errno));
+   }
+   get_format(fmt);
+   fprintf(stderr, "Cropping %ux%u+%d+%d on the device, capturing %dx%d\n", crop_rect.width, crop_rect.height, crop_rect.left, crop_rect.top, m_width, m_height);
+   sw_crop = 0;
+   return true;
   }
+  reset_device_crop(); // The device may have taken an adjusted rectangle, crop the whole picture instead
 
-  if((d_width != 0)&&(fmt.fmt.pix.width != d_width)){
-   fprintf(stderr, "Cannot set frame width to: %u. Current width: %u\n",d_width, fmt.fmt.pix.width);  
+  if((crop_rect.left + crop_rect.width > (unsigned int)m_width) || (crop_rect.top + crop_rect.height > (unsigned int)m_height)){
+   fprintf(stderr, "Crop rectangle %ux%u+%d+%d is outside the %dx%d capture\n", crop_rect.width, crop_rect.height, crop_rect.left, crop_rect.top, m_width, m_height);
+   return false;
+  }
+  if(capture_planar){
+   fprintf(stderr, "Device cannot crop, and 4:2:0 captures are only cropped on the device\n");
+   return false;
   }
+  fprintf(stderr, "Device cannot crop, cropping %ux%u+%d+%d from the capture buffers\n", crop_rect.width, crop_rect.height, crop_rect.left, crop_rect.top);
+  sw_crop = 1;
+  return true;
+}
+
+static bool set_control(int fd, unsigned int id, int value){
+  struct v4l2_control ctrl;
+  CLEAR(ctrl);
+  ctrl.id = id;
+  ctrl.value = value;
+  return xioctl(fd, VIDIOC_S_CTRL, &ctrl) != -1;
+}
 
-  if((d_height != 0)&&(fmt.fmt.pix.height != d_height)){
-   fprintf(stderr, "Cannot set frame height to: %u. Current height: %u\n",d_height, fmt.fmt.pix.height);  
+// Split the requested orientation into device flips and what the rotator still has to do
+void capture_device::init_orientation(void){
+  // A half turn is a horizontal plus a vertical flip
+  int h = hflip, v = vflip, r = rotation;
+  if(r >= 180){
+   h = !h;
+   v = !v;
+   r -= 180;
+  }
+  // The sensor flips before anything else, so whatever it does is free. Both controls are
+  // always written, a flip left on by an earlier run would otherwise stay.
+  if(set_control(fd, V4L2_CID_HFLIP, h) && h){
+   fprintf(stderr, "Horizontal flip done by the device\n");
+   h = 0;
   }
+  if(set_control(fd, V4L2_CID_VFLIP, v) && v){
+   fprintf(stderr, "Vertical flip done by the device\n");
+   v = 0;
+  }
+  // A vertical flip is a half turn of a mirrored frame
+  if(v){
+   h = !h;
+   r += 180;
+  }
+  sw_rotation = r;
+  sw_hflip = h;
+}
 
-  m_width = fmt.fmt.pix.width;
-  m_height = fmt.fmt.pix.height;  
-  m_format = fmt.fmt.pix.pixelformat;
+// Map buffer b of a MMAP capture, every plane of a multi-planar one
+void capture_device::mmap_buffer(unsigned int b){
+  struct v4l2_buffer buf;
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
+  const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(capture_type);
+  CLEAR(buf);
+  buf.type        = capture_type;
+  buf.memory      = V4L2_MEMORY_MMAP;
+  buf.index       = b;
+  if(mplane){
+   CLEAR(planes);
+   buf.m.planes = planes;
+   buf.length = VIDEO_MAX_PLANES;
+  }
+  if(-1 == xioctl(fd, VIDIOC_QUERYBUF, &buf)){
+   errno_exit("VIDIOC_QUERYBUF");
+  }
+  struct buffer &bb = buffers[b];
+  bb.n_planes = mplane ? buf.length : 1;
+  for(unsigned int p = 0; p < bb.n_planes; ++p){
+   const size_t length = mplane ? planes[p].length : buf.length;
+   const off_t offset = mplane ? planes[p].m.mem_offset : buf.m.offset;
+   fprintf(stderr, "Mapping %s buffer %u plane %u, len %zu\n", device.c_str(), b, p, length);
+   bb.plane_length[p] = length;
+   bb.plane_dmabuf[p] = -1;
+   bb.plane_start[p] = mmap(NULL,length,PROT_READ | PROT_WRITE,MAP_SHARED,fd, offset);
+   if (MAP_FAILED == bb.plane_start[p]){
+    errno_exit("mmap");
+   }
+  }
+  bb.start = bb.plane_start[0];
+  bb.length = bb.plane_length[0];
+  bb.dmabuf = -1;
+  bb.parked = 0;
 }
 
-static void init_mmap(const char *device_name, int &fd, enum v4l2_buf_type type, struct buffer **bufs_out, unsigned int *n_bufs){  //initialize buffer for device
+void capture_device::init_mmap(void){  //initialize buffer for device
   struct v4l2_requestbuffers req;
-  struct buffer *bufs;
   unsigned int b;
   CLEAR(req);
-  req.count = 8;
-  req.type = type;
+  req.count = buffer_count;
+  req.type = capture_type;
   req.memory = V4L2_MEMORY_MMAP;
 
   if(-1 == xioctl(fd, VIDIOC_REQBUFS, &req)){
    if (EINVAL == errno) {
-    fprintf(stderr, "%s does not support memory mappingn", device_name);
+    fprintf(stderr, "%s does not support memory mappingn", device.c_str());
     exit(EXIT_FAILURE);
    }else{
     errno_exit("VIDIOC_REQBUFS");
    }
   }
   if (req.count < 2) {
-   fprintf(stderr, "Insufficient buffer memory on %s\\n",device_name);
+   fprintf(stderr, "Insufficient buffer memory on %s\\n",device.c_str());
    exit(EXIT_FAILURE);
   }
 
-  bufs = (buffer*)calloc(req.count, sizeof(*bufs));
+  buffers = (buffer*)calloc(VIDEO_MAX_FRAME, sizeof(*buffers)); // Room to grow
 
-  if(!bufs){
+  if(!buffers){
    fprintf(stderr, "Out of memory\\n");
    exit(EXIT_FAILURE);
   }
 
   for(b = 0; b < req.count; ++b){
-   struct v4l2_buffer buf;
-   CLEAR(buf);
-   buf.type        = type;
-   buf.memory      = V4L2_MEMORY_MMAP;
-   buf.index       = b;
-   if(-1 == xioctl(fd, VIDIOC_QUERYBUF, &buf)){
-    errno_exit("VIDIOC_QUERYBUF");
-   }
-   fprintf(stderr, "Mapping %s buffer %u, len %u\n", device_name, b, buf.length);
-   bufs[b].length = buf.length;
-   bufs[b].start = mmap(NULL,buf.length,PROT_READ | PROT_WRITE,MAP_SHARED,fd, buf.m.offset);
-   if (MAP_FAILED == bufs[b].start){
+   mmap_buffer(b);
+  }
+  n_buffers = b;
+}
+
+// Memory type of the capture
+enum v4l2_memory capture_device::io_memory(void){
+  switch(io){
+   case IO_METHOD_DMABUF:
+    return V4L2_MEMORY_DMABUF;
+   case IO_METHOD_USERPTR:
+    return V4L2_MEMORY_USERPTR;
+   default:
+    return V4L2_MEMORY_MMAP;
+  }
+}
+
+// Plane sizes of application allocated capture buffers into buffer_length, sizeimage
+// rounded up to whole pages, returns the size of a whole buffer
+size_t capture_device::capture_length(void){
+  struct v4l2_format fmt;
+  CLEAR(fmt);
+  fmt.type = capture_type;
+  if(-1 == xioctl(fd, VIDIOC_G_FMT, &fmt)){
+   errno_exit("VIDIOC_G_FMT");
+  }
+  const long page = sysconf(_SC_PAGESIZE);
+  const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(capture_type);
+  const unsigned int planes = mplane ? std::max((unsigned int)fmt.fmt.pix_mp.num_planes, 1u) : 1;
+  size_t total = 0;
+  for(unsigned int p = 0; p < planes; ++p){
+   const size_t size = mplane ? fmt.fmt.pix_mp.plane_fmt[p].sizeimage : fmt.fmt.pix.sizeimage;
+   buffer_length[p] = (size + page - 1) & ~(size_t)(page - 1);
+   total += buffer_length[p];
+  }
+  return total;
+}
+
+// Fit the capture buffer count to --buffer-budget, the pool never grows past it
+void capture_device::plan_buffers(void){
+  if(buffer_budget == 0){
+   return;
+  }
+  const size_t length = capture_length();
+  const size_t fit = ((size_t)buffer_budget << 20) / std::max(length, (size_t)1);
+  buffer_max = (unsigned int)std::max((size_t)2, std::min(fit, (size_t)VIDEO_MAX_FRAME));
+  if(buffer_count > buffer_max){
+   fprintf(stderr, "A %u MB budget holds %u capture buffers of %zu bytes\n", buffer_budget, buffer_max, length);
+   buffer_count = buffer_max;
+  }
+}
+
+// Give user pointer buffer b a frame pool allocation of buffer_length bytes (one plane)
+void capture_device::alloc_userptr(unsigned int b){
+  if(userptr_slots.size() <= b){
+   userptr_slots.resize(VIDEO_MAX_FRAME);
+  }
+  userptr_slots[b] = frame_pool.Acquire(buffer_length[0]);
+  if(!userptr_slots[b]){
+   fprintf(stderr, "Out of memory\n");
+   exit(EXIT_FAILURE);
+  }
+  buffers[b].start = buffers[b].plane_start[0] = userptr_slots[b].get();
+  buffers[b].length = buffers[b].plane_length[0] = buffer_length[0];
+  buffers[b].dmabuf = buffers[b].plane_dmabuf[0] = -1;
+  buffers[b].n_planes = 1;
+  buffers[b].parked = 0;
+}
+
+// Capture into page-aligned, cached buffers of the frame pool (V4L2_MEMORY_USERPTR)
+void capture_device::init_userptr(void){
+  capture_length();
+
+  struct v4l2_requestbuffers req;
+  CLEAR(req);
+  req.count = buffer_count;
+  req.type = capture_type;
+  req.memory = V4L2_MEMORY_USERPTR;
+  if(-1 == xioctl(fd, VIDIOC_REQBUFS, &req)){
+   if (EINVAL == errno) {
+    fprintf(stderr, "%s does not support user pointer i/o\n", device.c_str());
+    exit(EXIT_FAILURE);
+   }else{
+    errno_exit("VIDIOC_REQBUFS");
+   }
+  }
+  if (req.count < 2) {
+   fprintf(stderr, "Insufficient buffer memory on %s\n",device.c_str());
+   exit(EXIT_FAILURE);
+  }
+
+  buffers = (buffer*)calloc(VIDEO_MAX_FRAME, sizeof(*buffers)); // Room to grow
+  if(!buffers){
+   fprintf(stderr, "Out of memory\n");
+   exit(EXIT_FAILURE);
+  }
+  for(unsigned int b = 0; b < req.count; ++b){
+   alloc_userptr(b);
+  }
+  fprintf(stderr, "Allocated %u %s user pointer buffers, len %zu\n", req.count, device.c_str(), buffer_length[0]);
+  n_buffers = req.count;
+}
+
+// Export every plane of MMAP buffer b as DMABUF
+void capture_device::export_buffer(unsigned int b){
+  for(unsigned int p = 0; p < buffers[b].n_planes; ++p){
+   struct v4l2_exportbuffer exp;
+   CLEAR(exp);
+   exp.type = capture_type;
+   exp.index = b;
+   exp.plane = p;
+   exp.flags = O_RDWR | O_CLOEXEC;
+   if(-1 == xioctl(fd, VIDIOC_EXPBUF, &exp)){
+    errno_exit("VIDIOC_EXPBUF");
+   }
+   buffers[b].plane_dmabuf[p] = exp.fd;
+   fprintf(stderr, "Exported %s buffer %u plane %u as DMABUF fd %d\n", device.c_str(), b, p, exp.fd);
+  }
+  buffers[b].dmabuf = buffers[b].plane_dmabuf[0];
+}
+
+// Export MMAP buffers as DMABUF so other devices and processes can use them without copying
+void capture_device::export_dmabuf(void){
+  for(unsigned int b = 0; b < n_buffers; ++b){
+   export_buffer(b);
+  }
+}
+
+// Back every plane of buffer b with a udmabuf of buffer_length bytes, mapped for the CPU
+void capture_device::alloc_udmabuf(unsigned int b){
+  struct buffer &bb = buffers[b];
+  bb.n_planes = m_planes;
+  for(unsigned int p = 0; p < bb.n_planes; ++p){
+   int memfd = memfd_create("v4l2ndi", MFD_ALLOW_SEALING | MFD_CLOEXEC);
+   if((-1 == memfd) || (-1 == ftruncate(memfd, buffer_length[p])) || (-1 == fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK))){
+    errno_exit("memfd");
+   }
+   struct udmabuf_create create;
+   CLEAR(create);
+   create.memfd = memfd;
+   create.flags = UDMABUF_FLAGS_CLOEXEC;
+   create.size = buffer_length[p];
+   bb.plane_dmabuf[p] = ioctl(udmabuf_dev, UDMABUF_CREATE, &create);
+   if(-1 == bb.plane_dmabuf[p]){
+    errno_exit("UDMABUF_CREATE");
+   }
+   close(memfd); // The DMABUF keeps the memory
+   bb.plane_length[p] = buffer_length[p];
+   bb.plane_start[p] = mmap(NULL, buffer_length[p], PROT_READ | PROT_WRITE, MAP_SHARED, bb.plane_dmabuf[p], 0);
+   if (MAP_FAILED == bb.plane_start[p]){
     errno_exit("mmap");
    }
   }
-  *n_bufs = b;
-  *bufs_out = bufs;
+  bb.start = bb.plane_start[0];
+  bb.length = bb.plane_length[0];
+  bb.dmabuf = bb.plane_dmabuf[0];
+  bb.parked = 0;
+}
+
+// Allocate capture buffers from udmabuf (memfd backed, cached) and import them with V4L2_MEMORY_DMABUF
+void capture_device::init_dmabuf(void){
+  const size_t length = capture_length();
+
+  struct v4l2_requestbuffers req;
+  CLEAR(req);
+  req.count = buffer_count;
+  req.type = capture_type;
+  req.memory = V4L2_MEMORY_DMABUF;
+  if(-1 == xioctl(fd, VIDIOC_REQBUFS, &req)){
+   if (EINVAL == errno) {
+    fprintf(stderr, "%s does not support DMABUF import\n", device.c_str());
+    exit(EXIT_FAILURE);
+   }else{
+    errno_exit("VIDIOC_REQBUFS");
+   }
+  }
+  if (req.count < 2) {
+   fprintf(stderr, "Insufficient buffer memory on %s\n",device.c_str());
+   exit(EXIT_FAILURE);
+  }
+
+  udmabuf_dev = open("/dev/udmabuf", O_RDWR | O_CLOEXEC); // Kept open to grow the pool
+  if(-1 == udmabuf_dev){
+   fprintf(stderr, "Cannot open /dev/udmabuf (%s), load the udmabuf module or use MMAP capture\n", strerror(errno));
+   exit(EXIT_FAILURE);
+  }
+
+  buffers = (buffer*)calloc(VIDEO_MAX_FRAME, sizeof(*buffers)); // Room to grow
+  if(!buffers){
+   fprintf(stderr, "Out of memory\n");
+   exit(EXIT_FAILURE);
+  }
+  for(unsigned int b = 0; b < req.count; ++b){
+   alloc_udmabuf(b);
+   fprintf(stderr, "Allocated %s DMABUF buffer %u, len %zu in %u planes\n", device.c_str(), b, length, buffers[b].n_planes);
+  }
+  n_buffers = req.count;
+}
+
+// Bracket CPU access to a DMABUF so caches are maintained, flags DMA_BUF_SYNC_START or _END
+static void dmabuf_sync(int dmabuf, uint64_t flags){
+  if(dmabuf < 0){
+   return;
+  }
+  struct dma_buf_sync sync;
+  sync.flags = flags | DMA_BUF_SYNC_RW;
+  while((-1 == ioctl(dmabuf, DMA_BUF_IOCTL_SYNC, &sync)) && (EINTR == errno));
+}
+
+// dmabuf_sync every plane of a buffer
+static void dmabuf_sync_planes(const struct buffer &b, uint64_t flags){
+  for(unsigned int p = 0; p < b.n_planes; ++p){
+   dmabuf_sync(b.plane_dmabuf[p], flags);
+  }
+}
+
+// Describe buffer index of bufs for VIDIOC_QBUF, with its planes when the capture is multi-planar
+static void describe_buffer(struct v4l2_buffer &buf, struct buffer *bufs, unsigned int index, enum v4l2_buf_type type, enum v4l2_memory memory){
+  struct buffer &b = bufs[index];
+  CLEAR(buf);
+  buf.type = type;
+  buf.memory = memory;
+  buf.index = index;
+  if(V4L2_TYPE_IS_MULTIPLANAR(type)){
+   CLEAR(b.planes);
+   for(unsigned int p = 0; p < b.n_planes; ++p){
+    b.planes[p].length = b.plane_length[p];
+    if(memory == V4L2_MEMORY_DMABUF){
+     b.planes[p].m.fd = b.plane_dmabuf[p];
+    }else if(memory == V4L2_MEMORY_USERPTR){
+     b.planes[p].m.userptr = (unsigned long)b.plane_start[p];
+    }
+   }
+   buf.m.planes = b.planes;
+   buf.length = b.n_planes;
+  }else if(memory == V4L2_MEMORY_DMABUF){
+   buf.m.fd = b.dmabuf;
+   buf.length = b.length;
+  }else if(memory == V4L2_MEMORY_USERPTR){
+   buf.m.userptr = (unsigned long)b.start;
+   buf.length = b.length;
+  }
+}
+
+// Take capture buffer b out of circulation, freeing it where the kernel can remove buffers
+void capture_device::park_buffer(unsigned int index){
+  struct buffer &b = buffers[index];
+  b.parked = 1;
+#ifdef VIDIOC_REMOVE_BUFS
+  struct v4l2_remove_buffers remove;
+  CLEAR(remove);
+  remove.index = index;
+  remove.count = 1;
+  remove.type = capture_type;
+  if(-1 == xioctl(fd, VIDIOC_REMOVE_BUFS, &remove)){
+   return; // Keep it parked
+  }
+  for(unsigned int p = 0; p < b.n_planes; ++p){
+   if(io == IO_METHOD_USERPTR){
+    userptr_slots[index].reset();
+   }else{
+    munmap(b.plane_start[p], b.plane_length[p]);
+   }
+   if(b.plane_dmabuf[p] >= 0){
+    close(b.plane_dmabuf[p]);
+   }
+   b.plane_start[p] = NULL;
+   b.plane_dmabuf[p] = -1;
+  }
+  b.start = NULL;
+  b.dmabuf = -1;
+#endif
+}
+
+// Give a capture buffer back to the driver
+void capture_device::requeue_capture(unsigned int index){
+  struct v4l2_buffer buf;
+  dmabuf_sync_planes(buffers[index], DMA_BUF_SYNC_END);
+  {
+   std::lock_guard<std::mutex> lock(buffer_lock);
+   if(buffer_active > buffer_target){ // The pool is shrinking
+    buffer_active--;
+    park_buffer(index);
+    return;
+   }
+   buffer_in_driver++;
+  }
+  describe_buffer(buf, buffers, index, capture_type, io_memory()); // A user pointer slot may hold a fresh buffer by now
+  if(-1 == xioctl(fd, VIDIOC_QBUF, &buf)){
+   errno_exit("VIDIOC_QBUF");
+  }
+}
+
+// Allocate the capture buffers for the current format
+void capture_device::init_capture_buffers(void){
+  plan_buffers();
+  if(io == IO_METHOD_DMABUF){
+   init_dmabuf();
+  }else if(io == IO_METHOD_USERPTR){
+   init_userptr();
+  }else{
+   init_mmap();
+   if((dmabuf_export == 1) || (dmabuf_socket != NULL)){
+    export_dmabuf();
+   }
+  }
+  buffer_active = buffer_target = buffer_high_water = n_buffers;
+  buffer_count = n_buffers; // What the driver granted, the pool shrinks back to it
+  buffer_max = std::max(buffer_max, n_buffers);
+}
+
+// Keep every page of the process in RAM, now and as it grows, so a frame never waits for a page fault
+static void lock_memory(void){
+  mallopt(M_TRIM_THRESHOLD, -1); // Freed memory stays mapped and locked for the next frame
+  mallopt(M_MMAP_MAX, 0);
+  if(mlockall(MCL_CURRENT | MCL_FUTURE) == -1){
+   fprintf(stderr, "Cannot lock memory: %s (needs CAP_IPC_LOCK or a memlock limit)\n", strerror(errno));
+  }
+}
+
+// Touch every page of the capture buffers, device mappings are not populated by mlockall
+static void prefault_buffers(struct buffer *bufs, unsigned int n_bufs){
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  volatile uint8_t sink = 0;
+  for(unsigned int b = 0; b < n_bufs; b++){
+   for(unsigned int p = 0; p < bufs[b].n_planes; p++){
+    const uint8_t *data = (const uint8_t*)bufs[b].plane_start[p];
+    for(size_t o = 0; data && (o < bufs[b].plane_length[p]); o += page){
+     sink ^= data[o];
+    }
+   }
+  }
+  (void)sink;
 }
 
-static void start_capturing(const char *device_name, int &fd, enum v4l2_buf_type type, unsigned int n_bufs){ //start capturing with main v4l2 device
+void capture_device::start_capturing(void){ //start capturing with main v4l2 device
   unsigned int i;
-  for (i = 0; i < n_bufs; ++i) {
+  enum v4l2_buf_type type = capture_type;
+  const enum v4l2_memory memory = io_memory();
+  if(memory_lock == 1){
+   prefault_buffers(buffers, n_buffers);
+  }
+  for (i = 0; i < n_buffers; ++i) {
    struct v4l2_buffer buf;
-   CLEAR(buf);
-   buf.type = type;
-   buf.memory = V4L2_MEMORY_MMAP;
-   buf.index = i;
+   describe_buffer(buf, buffers, i, type, memory);
    if (-1 == xioctl(fd, VIDIOC_QBUF, &buf)){
     errno_exit("VIDIOC_QBUF");
    }else{
-    fprintf(stderr, "Queueing %s buffer %u\n",device_name, i); 
+    fprintf(stderr, "Queueing %s buffer %u\n",device.c_str(), i); 
    }
   }
   if (-1 == xioctl(fd, VIDIOC_STREAMON, &type)){
    errno_exit("VIDIOC_STREAMON");
   }else{
-   fprintf(stderr, "Starting stream into mmap buffer map, %s\n",device_name);  
+   fprintf(stderr, "Starting stream into %s buffers, %s\n", (memory == V4L2_MEMORY_DMABUF) ? "DMABUF" : (memory == V4L2_MEMORY_USERPTR) ? "user pointer" : "mmap", device.c_str());  
+  }
+}
+
+void capture_device::stop_capturing(void){
+  enum v4l2_buf_type type;
+  type = capture_type;
+  if (-1 == xioctl(fd, VIDIOC_STREAMOFF, &type)){
+   errno_exit("VIDIOC_STREAMOFF");
+  }
+}
+
+void capture_device::uninit_device(void){
+  unsigned int i;
+  for (i = 0; i < n_buffers; ++i){
+   if ((io == IO_METHOD_USERPTR) || !buffers[i].start){ // Pool memory or removed
+    continue;
+   }
+   for (unsigned int p = 0; p < buffers[i].n_planes; ++p){
+    if (-1 == munmap(buffers[i].plane_start[p], buffers[i].plane_length[p])){
+     errno_exit("munmap");
+    }
+    if (buffers[i].plane_dmabuf[p] >= 0){
+     close(buffers[i].plane_dmabuf[p]);
+    }
+   }
+  }
+  free(buffers);
+  userptr_slots.clear();
+  if(udmabuf_dev >= 0){
+   close(udmabuf_dev);
+   udmabuf_dev = -1;
   }
 }
 
@@ -291,7 +1224,7 @@ int is_writable(int &fd, timeval* tv){
  return select(fd+1, NULL, &fdset, NULL, tv); 
 }
 
-static void queue_wait(void){
+void capture_device::queue_wait(void){
   // Lock the queue
   std::unique_lock<std::mutex> lock_queue(m_lock);
 
@@ -300,7 +1233,7 @@ static void queue_wait(void){
     m_condvar.wait(lock_queue);
 }
 
-static void queue_push(std::unique_ptr<v4l2_buffer> buf){
+void capture_device::queue_push(std::unique_ptr<v4l2_buffer> buf){
   // Lock the queue
   std::unique_lock<std::mutex> lock_queue(m_lock);
 
@@ -313,9 +1246,7 @@ static void queue_push(std::unique_ptr<v4l2_buffer> buf){
   {
     // Pull the item off the queue and requeue it so we don't loose buffers!
     std::unique_ptr<v4l2_buffer> item = std::move(m_queue.front());
-    if(-1 == xioctl(fd, VIDIOC_QBUF, item.get())){
-      errno_exit("VIDIOC_QBUF");
-    }
+    requeue_capture(item->index);
 
     m_queue.pop();
     // LOG(LOG_ERR, "!");	// Dropped an item from the queue!
@@ -329,7 +1260,7 @@ static void queue_push(std::unique_ptr<v4l2_buffer> buf){
   m_condvar.notify_one();
 }
 
-static std::unique_ptr<v4l2_buffer> queue_pop_opt(void){
+std::unique_ptr<v4l2_buffer> capture_device::queue_pop_opt(void){
   // Lock the queue
   std::unique_lock<std::mutex> lock_queue(m_lock);
 
@@ -348,248 +1279,2263 @@ static std::unique_ptr<v4l2_buffer> queue_pop_opt(void){
   return item;
 }
 
-static void process_image_thread(void){
-  // Used to signal exit
-  bool exit_thread = false;
-
-  v4l2_buffer* last_buf = nullptr;
-
-  std::unique_ptr<NDIlib_video_frame_v2_t> frame, last_frame;
+static double monotonic_seconds(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-  // Cycle until we are told to exit
-  while (true)
-  {
-    // Wait for the queue to have some data
-    queue_wait();
+static int64_t monotonic_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-    while (true)
-    {
-      // See if we have any data
-      auto buf = queue_pop_opt();
+// NDI timecode (100 ns units of UTC) of a monotonic time, so receivers can line up sources by when they were captured
+static int64_t ndi_timecode(int64_t monotonic){
+  struct timespec real;
+  clock_gettime(CLOCK_REALTIME, &real);
+  const int64_t offset = (int64_t)real.tv_sec * 1000000000 + real.tv_nsec - monotonic_ns();
+  return (monotonic + offset) / 100;
+}
 
-      // If there was data available, buf will be valid, otherwise it will be false
-      if (!buf) {
-        // Nothing else on the queue to process, go to sleep
-        break;
-      }
+// Parse a kernel CPU list ("2", "2,3", "4-7", as in /sys/devices/system/cpu/isolated), false if malformed
+static bool parse_cpu_list(const char *list, cpu_set_t &cpus){
+  CPU_ZERO(&cpus);
+  const char *p = list;
+  while((*p != '\0') && (*p != '\n')){
+   char *end;
+   const long first = strtol(p, &end, 10);
+   long last = first;
+   if(end == p){
+    return false;
+   }
+   if(*end == '-'){
+    p = end + 1;
+    last = strtol(p, &end, 10);
+    if(end == p){
+     return false;
+    }
+   }
+   if((first < 0) || (last < first) || (last >= CPU_SETSIZE)){
+    return false;
+   }
+   for(long c = first; c <= last; c++){
+    CPU_SET(c, &cpus);
+   }
+   p = end;
+   if(*p == ','){
+    p++;
+   }else if((*p != '\0') && (*p != '\n')){
+    return false;
+   }
+  }
+  return true;
+}
 
-      // A valid unique_ptr to nullptr is submitted as a signal to exit the thread
-      if (buf.get() == nullptr) {
-        exit_thread = true;
-        break;
-      }
+// Parse "priority[@cpus]" of a stage option
+static bool parse_policy(const char *arg, stage_policy &policy){
+  char *end;
+  policy.priority = strtol(arg, &end, 10);
+  if((end == arg) || (policy.priority < 0) || (policy.priority > sched_get_priority_max(SCHED_FIFO))){
+   return false;
+  }
+  policy.pinned = false;
+  if(*end == '@'){
+   if(!parse_cpu_list(end + 1, policy.cpus) || (CPU_COUNT(&policy.cpus) == 0)){
+    return false;
+   }
+   policy.pinned = true;
+  }else if(*end != '\0'){
+   return false;
+  }
+  policy.set = true;
+  return true;
+}
 
-      // Convert to UYVY if necessary, copying in-place
-      if(force_yuyv == 1){
-        zs::Frame src, dst;
-        src.fourcc = (uint32_t)zs::ValidFourccCodes::YUY2;
-        src.width = m_width;
-        src.height = m_height;
-        src.size = buf->bytesused;
-        src.data = (uint8_t*)buffers[buf->index].start;
+// Cores the kernel keeps free of other work (isolcpus= and nohz_full=)
+static void isolated_cpus(cpu_set_t &cpus){
+  static const char *files[] = { "/sys/devices/system/cpu/isolated", "/sys/devices/system/cpu/nohz_full" };
+  CPU_ZERO(&cpus);
+  for(const char *file : files){
+   FILE *f = fopen(file, "r");
+   if(f == NULL){
+    continue;
+   }
+   char line[256];
+   cpu_set_t found;
+   if((fgets(line, sizeof(line), f) != NULL) && parse_cpu_list(line, found)){
+    CPU_OR(&cpus, &cpus, &found);
+   }
+   fclose(f);
+  }
+  CPU_AND(&cpus, &cpus, &startup_cpus);
+}
+
+// Give the stages that were not pinned on the command line their own isolated cores:
+// capture the first, send the next, conversion the rest (or share the last one)
+static void place_stages(void){
+  cpu_set_t isolated;
+  isolated_cpus(isolated);
+  std::vector<int> cores;
+  for(int c = 0; c < CPU_SETSIZE; c++){
+   if(CPU_ISSET(c, &isolated)){
+    cores.push_back(c);
+   }
+  }
+  if(cores.empty()){
+   return;
+  }
+  if(rt_capture.set && !rt_capture.pinned){
+   CPU_ZERO(&rt_capture.cpus);
+   CPU_SET(busy_poll_cpu >= 0 ? busy_poll_cpu : cores[0], &rt_capture.cpus);
+   rt_capture.pinned = true;
+  }
+  if(rt_send.set && !rt_send.pinned){
+   CPU_ZERO(&rt_send.cpus);
+   CPU_SET(cores[std::min<size_t>(1, cores.size() - 1)], &rt_send.cpus);
+   rt_send.pinned = true;
+  }
+  if(rt_convert.set && !rt_convert.pinned){
+   CPU_ZERO(&rt_convert.cpus);
+   for(size_t i = std::min<size_t>(2, cores.size() - 1); i < cores.size(); i++){
+    CPU_SET(cores[i], &rt_convert.cpus);
+   }
+   rt_convert.pinned = true;
+  }
+  fprintf(stderr, "Placing pipeline threads on %zu isolated cores\n", cores.size());
+}
+
+// Run the calling thread with the scheduling of a stage. Threads of stages without an option
+// go back to SCHED_OTHER on the startup cores, as a thread inherits the policy of its creator.
+static void apply_policy(const stage_policy &policy, const char *stage){
+  static std::atomic<bool> warned(false);
+  if(!rt_capture.set && !rt_convert.set && !rt_send.set){
+   return;
+  }
+  struct sched_param param;
+  param.sched_priority = policy.priority;
+  int err = pthread_setschedparam(pthread_self(), policy.priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+  if((err != 0) && !warned.exchange(true)){
+   fprintf(stderr, "Cannot make the %s thread real-time: %s (needs CAP_SYS_NICE or an rtprio limit)\n", stage, strerror(err));
+  }
+  err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), policy.pinned ? &policy.cpus : &startup_cpus);
+  if(err != 0){
+   fprintf(stderr, "Cannot set the cores of the %s thread: %s\n", stage, strerror(err));
+  }
+}
+
+// Thread start of the stripe workers, which do the conversion stages. With more than one
+// conversion core, each worker gets a core of its own; the first core is left to the
+// thread calling Run(), which works on a stripe too.
+static void convert_thread_start(void){
+  static std::atomic<int> started(0);
+  stage_policy policy = rt_convert;
+  const int count = policy.pinned ? CPU_COUNT(&rt_convert.cpus) : 0;
+  if(count > 1){
+   int nth = (1 + started++) % count;
+   CPU_ZERO(&policy.cpus);
+   for(int c = 0; c < CPU_SETSIZE; c++){
+    if(CPU_ISSET(c, &rt_convert.cpus) && (nth-- == 0)){
+     CPU_SET(c, &policy.cpus);
+     break;
+    }
+   }
+  }
+  apply_policy(policy, "conversion");
+}
+
+// Print the latency of the stages and the frames lost, since the last report or over the whole run
+void capture_device::report_latency(bool run){
+  zs::LatencyHistogram *stages[] = { &dequeue_latency, &convert_latency, &send_latency, &glass_latency };
+  static const char *names[] = { "capture to dequeue", "dequeue to send", "send", "capture to sent" };
+  for(int i = 0; i < 4; i++){
+    zs::LatencyHistogram &h = run ? run_latency[i] : *stages[i];
+    if(!run){
+      run_latency[i].Merge(h);
+    }
+    if(h.Count() == 0){
+      continue;
+    }
+    fprintf(stderr, "\n%s: %s p50 %lluus p90 %lluus p99 %lluus%s %s\n", ndi_name.c_str(), names[i],
+            (unsigned long long)h.Percentile(0.5), (unsigned long long)h.Percentile(0.9), (unsigned long long)h.Percentile(0.99),
+            (i == 0) ? (busy_poll_cpu >= 0 ? " (busy poll)" : (streams_file != NULL) ? " (epoll)" : " (select)") : "", h.Format().c_str());
+    if(!run){
+      h.Reset();
+    }
+  }
+  const unsigned long lost = run ? frames_lost_run.load() : frames_lost.exchange(0);
+  if(!run){
+    frames_lost_run += lost;
+  }
+  if(lost){
+    fprintf(stderr, "\n%s: %lu frames lost by the driver\n", ndi_name.c_str(), lost);
+  }
+}
+
+// Print statistics of the processing stages every stats_interval seconds
+void capture_device::report_stats(void){
+  double now = monotonic_seconds();
+  if(last_report == 0){
+    last_report = now;
+    return;
+  }
+  if((stats_interval <= 0) || (now - last_report < stats_interval)){
+    return;
+  }
+  const double elapsed = now - last_report;
+  last_report = now;
+  const unsigned long sent = frames_sent.exchange(0);
+
+  if(motion_meter){
+    const unsigned long total = idle_sent + idle_skipped;
+    fprintf(stderr, "\n%s: sending %.1f fps, %lu frames (%.1f%% of the bandwidth) saved on static scenes\n", ndi_name.c_str(),
+            idle_sent / elapsed, idle_skipped, total ? 100.0 * idle_skipped / total : 0.0);
+    idle_sent = idle_skipped = 0;
+  }else{
+    fprintf(stderr, "\n%s: sending %.1f fps\n", ndi_name.c_str(), sent / elapsed);
+  }
+
+  if(cadence){
+    static const char *names[] = { "none", "2:2", "3:2" };
+    fprintf(stderr, "\n%s: %llu repeated frames skipped, cadence %s\n", ndi_name.c_str(),
+            (unsigned long long)cadence->GetRepeatCount(), names[(int)cadence->GetCadence()]);
+  }
+  if(denoiser){
+    fprintf(stderr, "\n%s: denoise estimated NDI bandwidth reduction %.1f%%\n", ndi_name.c_str(), denoiser->GetEstimatedReduction());
+  }
+  report_latency(false);
+  const unsigned long dropped = latest_dropped.exchange(0); // Counted on the capture thread
+  if(dropped){
+    fprintf(stderr, "\n%s: %lu stale frames dropped for the newest\n", ndi_name.c_str(), dropped);
+  }
+  if(buffer_high_water > buffer_count){ // The pool had to grow
+    std::lock_guard<std::mutex> lock(buffer_lock);
+    fprintf(stderr, "\n%s: %u capture buffers in use, high water %u\n", ndi_name.c_str(), buffer_active, buffer_high_water);
+  }
+}
+
+void capture_device::send_video(const NDIlib_video_frame_v2_t *frame, bool async){
+  std::lock_guard<std::mutex> lock(send_lock);
+  const int64_t start = monotonic_ns();
+  if(async){
+    NDIlib_send_send_video_async_v2(pNDI_full_send, frame);
+  }else{
+    NDIlib_send_send_video_v2(pNDI_full_send, frame);
+  }
+  const int64_t end = monotonic_ns();
+  send_latency.Add((end - start) / 1000);
+  if(frame_dequeued){ // First send of the frame stamped by this thread, fields are sent twice
+    frames_sent++;
+    convert_latency.Add((start - frame_dequeued) / 1000);
+    if(frame_captured){
+      glass_latency.Add((end - frame_captured) / 1000);
+    }
+    frame_dequeued = frame_captured = 0;
+  }
+}
+
+static bool field_is_interlaced(uint32_t field){
+  switch(field){
+    case V4L2_FIELD_INTERLACED:
+    case V4L2_FIELD_INTERLACED_TB:
+    case V4L2_FIELD_INTERLACED_BT:
+    case V4L2_FIELD_TOP:
+    case V4L2_FIELD_BOTTOM:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool field_is_bottom_first(uint32_t field, int lines){
+  switch(field){
+    case V4L2_FIELD_INTERLACED_BT:
+      return true;
+    case V4L2_FIELD_INTERLACED: // Temporal order depends on the standard, only 525-line video is bottom first
+      return lines == 480;
+    default:
+      return false;
+  }
+}
+
+// Scale a finished frame for the proxy sender while it is still in cache
+void capture_device::proxy_frame(const NDIlib_video_frame_v2_t *frame){
+  const double now = monotonic_seconds();
+  if(proxy_fps > 0){
+    if(now < proxy_next){
+      return;
+    }
+    // Keep the cadence, but do not try to catch up after a stall
+    proxy_next = (now - proxy_next > 1.0 / proxy_fps) ? now + 1.0 / proxy_fps : proxy_next + 1.0 / proxy_fps;
+  }
+
+  // Never upscale, and keep whole pixel pairs
+  const int w = std::min(proxy_width, frame->xres) & ~1;
+  const int h = std::min(proxy_height, frame->yres);
+  std::shared_ptr<uint8_t> data = frame_pool.Acquire(w * h * 2);
+  if(!data || !proxy_scaler->Scale(frame->p_data, frame->xres, frame->yres, frame->line_stride_in_bytes, data.get(), w, h, 0)){
+    fprintf(stderr, "Proxy scale failed\n");
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(proxy_lock);
+  proxy_pending = std::move(data);
+  NDI_proxy_frame = *frame;
+  NDI_proxy_frame.xres = w;
+  NDI_proxy_frame.yres = h;
+  NDI_proxy_frame.line_stride_in_bytes = w * 2;
+  NDI_proxy_frame.p_data = nullptr;
+  if(proxy_fps > 0){
+    NDI_proxy_frame.frame_rate_N = (int)(proxy_fps * 1000);
+    NDI_proxy_frame.frame_rate_D = 1000;
+  }
+  lock.unlock();
+  proxy_condvar.notify_one();
+}
+
+// Send the newest proxy frame whenever one is ready, frames that arrive meanwhile replace it
+void capture_device::proxy_send_thread(void){
+  apply_policy(rt_send, "send");
+  std::unique_lock<std::mutex> lock(proxy_lock);
+  while(true){
+    while(!proxy_pending && !proxy_exit){
+      proxy_condvar.wait(lock);
+    }
+    if(proxy_exit){
+      return;
+    }
+    std::shared_ptr<uint8_t> data = std::move(proxy_pending);
+    NDIlib_video_frame_v2_t frame = NDI_proxy_frame;
+    lock.unlock();
+
+    // Synchronous, so the pooled buffer can be released right after
+    frame.p_data = data.get();
+    NDIlib_send_send_video_v2(pNDI_proxy_send, &frame);
+    data.reset();
+
+    lock.lock();
+  }
+}
+
+// Send a finished frame on the full stream and feed the proxy from it
+void capture_device::output_frame(const NDIlib_video_frame_v2_t *frame, bool async){
+  send_video(frame, async);
+  if(proxy_scaler){
+    proxy_frame(frame);
+  }
+}
+
+// Run the stages that work on progressive frames and send the result
+void capture_device::finish_frame(const NDIlib_video_frame_v2_t *frame, bool async){
+  if(lens){
+    zs::Frame src;
+    src.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+    src.width = frame->xres;
+    src.height = frame->yres;
+    src.size = frame->xres * frame->yres * 2;
+    src.data = frame->p_data;
+
+    zs::Frame &dst = lens_frames[lens_index];
+    bool ok = lens->Remap(src, frame->line_stride_in_bytes, dst);
+    // Zero the data element or zs::~Frame will try to free the memory!
+    src.data = nullptr;
+    if(!ok){
+      fprintf(stderr, "Lens correction failed\n");
+      return;
+    }
+
+    NDIlib_video_frame_v2_t &out = NDI_lens_frames[lens_index];
+    out = *frame;
+    out.line_stride_in_bytes = dst.width * 2;
+    out.p_data = dst.data;
+    lens_index = 1 - lens_index;
+    frame = &out;
+  }
+  if(rotator){
+    zs::Frame src;
+    src.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+    src.width = frame->xres;
+    src.height = frame->yres;
+    src.size = frame->xres * frame->yres * 2;
+    src.data = frame->p_data;
+
+    zs::Frame &dst = rot_frames[rot_index];
+    bool ok = rotator->Transform(src, frame->line_stride_in_bytes, sw_rotation, sw_hflip == 1, dst);
+    // Zero the data element or zs::~Frame will try to free the memory!
+    src.data = nullptr;
+    if(!ok){
+      fprintf(stderr, "Rotate failed\n");
+      return;
+    }
+
+    NDIlib_video_frame_v2_t &out = NDI_rot_frames[rot_index];
+    out = *frame;
+    out.xres = dst.width;
+    out.yres = dst.height;
+    out.line_stride_in_bytes = dst.width * 2;
+    out.p_data = dst.data;
+    if((sw_rotation == 90) || (sw_rotation == 270)){
+      out.picture_aspect_ratio = 0; // Square pixels of the new geometry
+    }
+    rot_index = 1 - rot_index;
+    output_frame(&out, async);
+    return;
+  }
+  output_frame(frame, async);
+}
+
+// Timecode of the second field sent from a frame, half a frame period after the first
+static int64_t second_field_timecode(const NDIlib_video_frame_v2_t *frame){
+  if((frame->timecode == NDIlib_send_timecode_synthesize) || (frame->frame_rate_N <= 0)){ // NDI counts the fields itself
+    return frame->timecode;
+  }
+  return frame->timecode + (int64_t)(5000000.0 * frame->frame_rate_D / frame->frame_rate_N);
+}
+
+// Deinterlace a UYVY frame into the ping-pong buffers and send the result(s)
+void capture_device::deinterlace_frame(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async){
+  zs::Frame src;
+  src.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+  src.width = frame->xres;
+  src.height = frame->yres;
+  src.size = frame->xres * frame->yres * 2;
+  src.data = frame->p_data;
+  const uint32_t stride = frame->line_stride_in_bytes;
+
+  const bool single_field = (field == V4L2_FIELD_TOP) || (field == V4L2_FIELD_BOTTOM);
+  const bool bottom_first = field_is_bottom_first(field, frame->yres);
+  int outputs = 1;
+  bool ok;
+  for(int n = 0; n < outputs; n++){
+    zs::Frame &dst = deint_frames[deint_index];
+    if(single_field){ // V4L2_FIELD_ALTERNATE delivers one field per buffer, always bob it
+      ok = deinterlacer->BobField(src, stride, field == V4L2_FIELD_BOTTOM, dst);
+    }else if(deinterlace_mode == zs::DeinterlaceMode::Bob){
+      // Both fields are already here, so the older one goes out immediately followed by the newer one
+      outputs = 2;
+      ok = deinterlacer->Bob(src, stride, (n == 0) == bottom_first, dst);
+    }else if(deinterlace_mode == zs::DeinterlaceMode::Blend){
+      ok = deinterlacer->Blend(src, stride, dst);
+    }else{
+      ok = deinterlacer->MotionAdaptive(src, stride, bottom_first, dst);
+    }
+    if(!ok){
+      fprintf(stderr, "Deinterlace failed\n");
+      break;
+    }
+
+    NDIlib_video_frame_v2_t &out = NDI_deint_frames[deint_index];
+    out = *frame;
+    out.xres = dst.width;
+    out.yres = dst.height;
+    out.line_stride_in_bytes = dst.width * 2;
+    out.p_data = dst.data;
+    if(single_field || deinterlace_mode == zs::DeinterlaceMode::Bob){ // One frame per field
+      out.frame_rate_N = frame->frame_rate_N * 2;
+    }
+    if(n == 1){
+      out.timecode = second_field_timecode(frame);
+    }
+    deint_index = 1 - deint_index;
+    finish_frame(&out, async);
+  }
+
+  // Zero the data element or zs::~Frame will try to free the memory!
+  src.data = nullptr;
+}
+
+// Send an interlaced UYVY frame as NDI fields without copying it
+void capture_device::send_fields(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async){
+  const int line = frame->line_stride_in_bytes ? frame->line_stride_in_bytes : frame->xres * 2;
+
+  if((field == V4L2_FIELD_TOP) || (field == V4L2_FIELD_BOTTOM)){ // V4L2_FIELD_ALTERNATE, the buffer already is a field
+    NDIlib_video_frame_v2_t &out = NDI_field_frames[0];
+    out = *frame;
+    out.yres = frame->yres * 2; // NDI describes fields with the height of the full frame
+    out.line_stride_in_bytes = line;
+    out.frame_format_type = (field == V4L2_FIELD_TOP) ? NDIlib_frame_format_type_field_0 : NDIlib_frame_format_type_field_1;
+    send_video(&out, async);
+    return;
+  }
+
+  const bool bottom_first = field_is_bottom_first(field, frame->yres);
+  if((field_mode == FIELDS_INTERLEAVED) && !bottom_first){ // NDI interleaved frames are always top field first
+    NDIlib_video_frame_v2_t &out = NDI_field_frames[0];
+    out = *frame;
+    out.frame_format_type = NDIlib_frame_format_type_interleaved;
+    send_video(&out, async);
+    return;
+  }
+
+  // Point each field at its first line and skip every other line, older field first
+  for(int n = 0; n < 2; n++){
+    const bool bottom = (n == 0) == bottom_first;
+    NDIlib_video_frame_v2_t &out = NDI_field_frames[n];
+    out = *frame;
+    out.p_data = frame->p_data + (bottom ? line : 0);
+    out.line_stride_in_bytes = line * 2;
+    out.frame_format_type = bottom ? NDIlib_frame_format_type_field_1 : NDIlib_frame_format_type_field_0;
+    if(n == 1){
+      out.timecode = second_field_timecode(frame);
+    }
+    send_video(&out, async);
+  }
+}
+
+// Run the optional processing stages on a UYVY frame and hand the result to NDI
+void capture_device::send_frame(const NDIlib_video_frame_v2_t *frame, uint32_t field, bool async){
+  report_stats();
+  if(lut && !yuyv){ // YUY2 captures got the LUT while being converted
+    const int line = frame->line_stride_in_bytes ? frame->line_stride_in_bytes : frame->xres * 2;
+    if(!lut->Process(frame->p_data, frame->xres, frame->yres, line)){
+      fprintf(stderr, "LUT failed\n");
+    }
+  }
+  if(region_blur){ // Masked before anything else can see the picture
+    const int line = frame->line_stride_in_bytes ? frame->line_stride_in_bytes : frame->xres * 2;
+    if(!region_blur->Process(frame->p_data, frame->xres, frame->yres, line)){
+      fprintf(stderr, "Blur failed\n");
+    }
+  }
+  if(denoiser){ // Filtered in place, the result is what gets sent
+    const int line = frame->line_stride_in_bytes ? frame->line_stride_in_bytes : frame->xres * 2;
+    if(!denoiser->Process(frame->p_data, frame->xres, frame->yres, line)){
+      fprintf(stderr, "Denoise failed\n");
+    }
+  }
+  if((field_mode != FIELDS_OFF) && field_is_interlaced(field)){
+    send_fields(frame, field, async);
+    if(proxy_scaler){ // Fields go out as they are, the proxy gets the whole frame
+      proxy_frame(frame);
+    }
+    return;
+  }
+  if(deinterlacer && field_is_interlaced(field)){
+    deinterlace_frame(frame, field, async);
+    return;
+  }
+  finish_frame(frame, async);
+}
+
+// Point an NDI frame at UYVY capture data. Without a software crop this is
+// the whole frame; otherwise it is either the packed crop rectangle (when only
+// the rectangle was converted) or a zero-copy view into the capture buffer.
+void capture_device::set_frame_data(NDIlib_video_frame_v2_t *frame, uint8_t *data, bool region_only){
+  frame->p_data = data;
+  if(sw_crop == 0){
+    return;
+  }
+  frame->xres = crop_rect.width;
+  frame->yres = crop_rect.height;
+  if(region_only){
+    frame->line_stride_in_bytes = crop_rect.width * 2;
+  }else{
+    const int stride = m_stride ? m_stride : m_width * 2;
+    frame->p_data = data + crop_rect.top * stride + crop_rect.left * 2;
+    frame->line_stride_in_bytes = stride;
+  }
+}
+
+// TRUE if convert_capture() may write into the capture buffer it reads. The conversion goes row by
+// row and always can; the LUT runs stripes in parallel and needs every output row where its input is.
+bool capture_device::convert_in_place(void){
+  return !lut || ((sw_crop == 0) && ((m_stride == 0) || (m_stride == m_width * 2)));
+}
+
+// Convert a YUY2 capture to packed UYVY, only the crop rectangle when cropping in software
+bool capture_device::convert_capture(zs::Frame &src, zs::Frame &dst){
+  const uint32_t stride = m_stride ? m_stride : src.width * 2;
+  const uint32_t x = sw_crop ? crop_rect.left : 0;
+  const uint32_t y = sw_crop ? crop_rect.top : 0;
+  bool ok;
+  if(lut){ // The LUT pass writes UYVY, so it replaces the conversion
+    zs::Frame region;
+    region.fourcc = src.fourcc;
+    region.width = sw_crop ? crop_rect.width : src.width;
+    region.height = sw_crop ? crop_rect.height : src.height;
+    region.data = src.data + y * stride + x * 2;
+    ok = lut->Apply(region, stride, dst);
+    region.data = nullptr;
+  }else{
+    // A capture with padded lines is bytesperline * height long, more than the packed size the frame may carry
+    zs::Frame padded;
+    padded.fourcc = src.fourcc;
+    padded.width = src.width;
+    padded.height = src.height;
+    padded.data = src.data;
+    padded.size = std::max(src.size, stride * src.height);
+    const uint32_t w = sw_crop ? crop_rect.width : src.width;
+    const uint32_t h = sw_crop ? crop_rect.height : src.height;
+    const bool packed = (x == 0) && (y == 0) && (stride == w * 2);
+    if(workers && dst.data && (dst.size == w * h * 2) && ((dst.data != src.data) || packed)){
+      // Stripes of whole 4-row groups (ConvertRegion's minimum) on the shared workers. In place a
+      // stripe may only overwrite the rows it reads, so a cropped or padded capture goes serially.
+      std::atomic<bool> failed(false);
+      workers->Run(h, [&](uint32_t first, uint32_t last){
+        if(first == last){
+          return;
+        }
+        zs::Frame stripe;
+        stripe.fourcc = dst.fourcc;
+        stripe.size = w * (last - first) * 2;
+        stripe.data = dst.data + (size_t)first * w * 2;
+        if(!converter.ConvertRegion(padded, stride, x, y + first, w, last - first, stripe)){
+          failed = true;
+        }
+        stripe.data = nullptr;
+      }, (h % 4 == 0) ? 4 : h);
+      dst.width = w;
+      dst.height = h;
+      ok = !failed;
+    }else{
+      ok = converter.ConvertRegion(padded, stride, x, y, w, h, dst);
+    }
+    padded.data = nullptr;
+  }
+  return ok;
+}
+
+// First byte of the picture in capture buffer index (plane 0 of a multi-planar one)
+uint8_t *capture_device::capture_data(unsigned int index){
+  uint8_t *data = (uint8_t*)buffers[index].start;
+  return V4L2_TYPE_IS_MULTIPLANAR(capture_type) ? data + buffers[index].planes[0].data_offset : data;
+}
+
+// Y, U and V planes (Y and UV for NV12) of a 4:2:0 capture starting at data in buffer index.
+// Single memory plane formats lay the planes out one after the other.
+void capture_device::capture_planes(const void *data, unsigned int index, const uint8_t *planes[3], uint32_t strides[3]){
+  const struct buffer &b = buffers[index];
+  const bool nv12 = (m_format == V4L2_PIX_FMT_NV12) || (m_format == V4L2_PIX_FMT_NV12M);
+  planes[0] = (const uint8_t*)data;
+  strides[0] = m_stride;
+  planes[2] = nullptr;
+  strides[2] = 0;
+  if(b.n_planes > 1){
+   for(unsigned int p = 1; (p < b.n_planes) && (p < 3); ++p){
+    planes[p] = (const uint8_t*)b.plane_start[p] + b.planes[p].data_offset;
+    strides[p] = m_plane_stride[p];
+   }
+   return;
+  }
+  planes[1] = planes[0] + (size_t)m_stride * m_height;
+  strides[1] = nv12 ? m_stride : m_stride / 2;
+  if(!nv12){
+   planes[2] = planes[1] + (size_t)strides[1] * (m_height / 2);
+   strides[2] = strides[1];
+  }
+}
+
+// Convert a 4:2:0 capture to UYVY straight from its planes, there is no copy of the capture first
+bool capture_device::convert_planes(const void *data, unsigned int index, zs::Frame &dst){
+  const uint8_t *planes[3];
+  uint32_t strides[3];
+  capture_planes(data, index, planes, strides);
+  dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+  return converter.ConvertPlanar(planes, strides, m_width, m_height, dst);
+}
+
+// NDI format of the frames made from captures: NV12 or I420 when a 4:2:0 capture is sent as it is, UYVY otherwise
+void capture_device::set_frame_format(NDIlib_video_frame_v2_t *frame){
+  if(!planar_direct){
+    frame->FourCC = NDIlib_FourCC_type_UYVY;
+    frame->line_stride_in_bytes = 0;
+    return;
+  }
+  frame->FourCC = (m_format == V4L2_PIX_FMT_NV12) ? NDIlib_FourCC_type_NV12 : NDIlib_FourCC_type_I420;
+  frame->line_stride_in_bytes = m_stride;
+}
+
+// TRUE if a capture need not be converted or sent: it repeats the previous
+// one, or the scene is static and the reduced rate is not due yet
+bool capture_device::skip_capture(const void *p){
+  const int stride = m_stride ? m_stride : m_width * 2;
+  // The checks sample every other luma byte of packed 4:2:2, on a luma plane that is every other pixel
+  const int luma_width = capture_planar ? m_width / 2 : m_width;
+  const int luma_offset = (capture_planar || yuyv) ? 0 : 1;
+  if(signal_monitor && (signal_monitor->Update((const uint8_t*)p, luma_width, m_height, stride, luma_offset, monotonic_seconds()) != zs::SignalState::Live)){
+    return true; // The slate goes out instead
+  }
+  if(cadence && cadence->IsRepeat((const uint8_t*)p, capture_planar ? m_width : m_width * 2, m_height, stride)){
+    return true;
+  }
+  if(motion_meter){
+    const double now = monotonic_seconds();
+    const float change = motion_meter->Measure((const uint8_t*)p, luma_width, m_height, stride, luma_offset);
+    if((change < 0) || (change > idle_threshold)){ // Back to full rate with the first moving frame
+      idle_last_motion = now;
+    }
+    // Half a capture interval of slack, so the floor rate is met with captures arriving on a grid
+    const double period = 1.0 / idle_fps - 0.5 * fps_D / fps_N;
+    if((now - idle_last_motion >= idle_after) && (now - idle_last_sent < period)){
+      idle_skipped++;
+      return true;
+    }
+    idle_last_sent = now;
+    idle_sent++;
+  }
+  return false;
+}
+
+// With frames skipped, NDI cannot synthesize timecodes from the frame count.
+// Stamp frames with the capture time, and advertise the rate of the new
+// pictures once a pulldown cadence is found.
+void capture_device::stamp_frame(NDIlib_video_frame_v2_t *frame, unsigned int index){
+  frame_captured = buffers[index].captured;
+  frame_dequeued = buffers[index].dequeued;
+  if(frame_captured){ // When the frame was captured, not when it got through the pipeline
+    frame->timecode = ndi_timecode(frame_captured);
+  }else{
+    frame->timecode = NDIlib_send_timecode_synthesize;
+  }
+  if(!cadence && !motion_meter){
+    return;
+  }
+  if(!frame_captured){ // Skipped frames would throw off the timecodes NDI synthesizes
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    frame->timecode = (int64_t)ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+  }
+  switch(cadence ? cadence->GetCadence() : zs::Cadence::None){
+    case zs::Cadence::Pulldown22:
+      frame->frame_rate_N = fps_N;
+      frame->frame_rate_D = fps_D * 2;
+      break;
+    case zs::Cadence::Pulldown32:
+      frame->frame_rate_N = fps_N * 2;
+      frame->frame_rate_D = fps_D * 5;
+      break;
+    default:
+      frame->frame_rate_N = fps_N;
+      frame->frame_rate_D = fps_D;
+      break;
+  }
+}
+
+void capture_device::process_image_thread(void){
+  apply_policy(rt_convert, "conversion");
+  // Used to signal exit
+  bool exit_thread = false;
+
+  v4l2_buffer* last_buf = nullptr;
+
+  std::unique_ptr<NDIlib_video_frame_v2_t> frame, last_frame;
+
+  // UYVY that cannot be made in the capture buffer: from a 4:2:0 capture, which is larger,
+  // or from the LUT when the capture is cropped or has padded lines
+  std::shared_ptr<uint8_t> converted_out, last_converted_out;
+
+  // Cycle until we are told to exit
+  while (!exit_thread)
+  {
+    // Wait for the queue to have some data
+    queue_wait();
+
+    while (true)
+    {
+      // See if we have any data
+      auto buf = queue_pop_opt();
+
+      // If there was data available, buf will be valid, otherwise it will be false
+      if (!buf) {
+        // Nothing else on the queue to process, go to sleep
+        break;
+      }
+
+      // A buffer without a type is submitted as a signal to exit the thread
+      if (buf->type == 0) {
+        exit_thread = true;
+        break;
+      }
+
+      uint8_t *data = capture_data(buf->index);
+      if(skip_capture(data)){ // Nothing new to send, hand the buffer straight back
+        requeue_capture(buf->index);
+        continue;
+      }
+
+      // Convert to UYVY if necessary, in place when that is safe
+      if(yuyv){
+        zs::Frame src, dst;
+        src.fourcc = (uint32_t)zs::ValidFourccCodes::YUY2;
+        src.width = m_width;
+        src.height = m_height;
+        src.size = buf->bytesused;
+        src.data = data;
 
         dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
-        dst.size = buf->bytesused;
-        dst.data = (uint8_t*)buffers[buf->index].start;
+        dst.size = (sw_crop ? crop_rect.width * crop_rect.height : m_width * m_height) * 2;
+        if(convert_in_place()){
+          dst.data = data;
+        }else{
+          converted_out = frame_pool.Acquire(dst.size);
+          dst.data = converted_out.get();
+        }
 
-        if(!converter.Convert(src,dst)){
+        if(!convert_capture(src,dst)){
           fprintf(stderr, "Convert failed\n");
         }
+        data = dst.data;
 
         // Zero the data elements or zs::~Frame will try to free the memory!
         src.data = dst.data = nullptr;
       }
+      if(capture_planar && !planar_direct){
+        zs::Frame dst;
+        dst.size = m_width * m_height * 2;
+        converted_out = frame_pool.Acquire(dst.size);
+        dst.data = converted_out.get();
+        if(!convert_planes(data, buf->index, dst)){
+          fprintf(stderr, "Convert failed\n");
+        }
+        dst.data = nullptr;
+        data = converted_out.get();
+      }
+
+      // Create a new frame we can pass to the NDI stack
+      frame = std::make_unique<NDIlib_video_frame_v2_t>();
+      frame->xres = m_width;
+      frame->yres = m_height;
+      frame->frame_rate_N = fps_N;
+      frame->frame_rate_D = fps_D;
+      set_frame_format(frame.get());
+      set_frame_data(frame.get(), data, yuyv);
+      stamp_frame(frame.get(), buf->index);
+
+      // We're now done with the previous v4l2 buffer, so requeue it
+      if (last_buf){
+        requeue_capture(last_buf->index);
+      }
+
+      // Pass the frame to the NDI stack
+      send_frame(frame.get(), buf->field, true);
+
+      // Keep references to what we passed to the NDI stack until we queue the
+      // next frame, or the memory could disappear out from under us!
+      last_buf = buf.release();
+      last_frame = std::move(frame);
+      last_converted_out = std::move(converted_out);
+    }
+  }
+
+  // Let NDI finish with the last frame before its memory goes
+  {
+    std::lock_guard<std::mutex> lock(send_lock);
+    NDIlib_send_send_video_async_v2(pNDI_full_send, NULL);
+  }
+  delete last_buf;
+}
+
+// UYVY for an async frame made from a 4:2:0 capture, converted straight into memory that
+// stays with the frame (the pool's held buffer with user pointers, otherwise from malloc)
+uint8_t *capture_device::convert_planes_async(const void *p, unsigned int index, int slot){
+  const size_t size = (size_t)m_width * m_height * 2;
+  uint8_t *out;
+  if(io == IO_METHOD_USERPTR){
+   userptr_held[slot] = frame_pool.Acquire(size);
+   out = userptr_held[slot].get();
+  }else{
+   out = (uint8_t*)malloc(size);
+  }
+  zs::Frame dst;
+  dst.data = out;
+  dst.size = size;
+  if(!convert_planes(p, index, dst)){
+   fprintf(stderr, "Convert failed\n");
+  }
+  dst.data = nullptr;
+  userptr_dequeued.reset(); // The capture buffer is not needed past the conversion
+  return out;
+}
+
+void capture_device::process_image_async(const void *p, int size, uint32_t field, unsigned int index){
+ if(skip_capture(p)){
+  return;
+ }
+ frame_buffer = 1 - frame_buffer; 
+ //std::cout << "Frame size: " << size << std::endl; 
+ if(frame_buffer == 0){
+  if(capture_planar && !planar_direct){
+   p_frame1 = convert_planes_async(p, index, 0);
+   set_frame_data(&NDI_video_frame1, p_frame1, true);
+  }else{
+   if(io == IO_METHOD_USERPTR){ //the capture buffer is ours and stays off the driver's queue while NDI uses it
+    userptr_held[0] = std::move(userptr_dequeued);
+    p_frame1 = (uint8_t*)p;
+   }else{
+    p_frame1 = (uint8_t*)malloc(size);
+    memcpy(p_frame1, (uint8_t*)p, size);
+   }
+   if(yuyv){ //if this is enabled - convert from YUY2 to UYVY for NDI
+    yuy2Frame.data = p_frame1;
+    if(!convert_capture(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
+     fprintf(stderr, "Convert failed\n");       
+    }
+    yuy2Frame.data = nullptr; // Borrowed, zs::~Frame must not free it
+    set_frame_data(&NDI_video_frame1, uyvyFrame.data, true); //link the UYVY frame data to the NDI frame
+   }else{
+    set_frame_data(&NDI_video_frame1, p_frame1, false); //link the UYVY frame data to the NDI frame 
+   }
+  }
+  stamp_frame(&NDI_video_frame1, index);
+  send_frame(&NDI_video_frame1, field, true); //send the data out to NDI
+  if(io == IO_METHOD_USERPTR){
+   userptr_held[1].reset(); //back to the pool
+  }else{
+   free(p_frame2);
+  }
+ }
+ if(frame_buffer == 1){
+  if(capture_planar && !planar_direct){
+   p_frame2 = convert_planes_async(p, index, 1);
+   set_frame_data(&NDI_video_frame2, p_frame2, true);
+  }else{
+   if(io == IO_METHOD_USERPTR){ //the capture buffer is ours and stays off the driver's queue while NDI uses it
+    userptr_held[1] = std::move(userptr_dequeued);
+    p_frame2 = (uint8_t*)p;
+   }else{
+    p_frame2 = (uint8_t*)malloc(size);
+    memcpy(p_frame2, (uint8_t*)p, size);
+   }
+   if(yuyv){ //if this is enabled - convert from YUY2 to UYVY for NDI
+    yuy2Frame.data = p_frame2;
+    if(!convert_capture(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
+     fprintf(stderr, "Convert failed\n");       
+    }
+    yuy2Frame.data = nullptr; // Borrowed, zs::~Frame must not free it
+    set_frame_data(&NDI_video_frame2, uyvyFrame.data, true); //link the UYVY frame data to the NDI frame
+   }else{
+    set_frame_data(&NDI_video_frame2, p_frame2, false); //link the UYVY frame data to the NDI frame 
+   }
+  }
+  stamp_frame(&NDI_video_frame2, index);
+  send_frame(&NDI_video_frame2, field, true); //send the data out to NDI
+  if(io == IO_METHOD_USERPTR){
+   userptr_held[0].reset(); //back to the pool
+  }else{
+   free(p_frame1);
+  }
+ }
+}
+
+void capture_device::process_image(const void *p, int size, uint32_t field, unsigned int index){
+ if(skip_capture(p)){
+  return;
+ }
+ if(yuyv){ //if this is enabled - convert from YUY2 to UYVY for NDI
+  yuy2Frame.data = (uint8_t*)p;
+  if(!convert_capture(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
+   fprintf(stderr, "Convert failed\n");       
+  }
+  yuy2Frame.data = nullptr; // Borrowed, zs::~Frame must not free it
+  set_frame_data(&NDI_video_frame1, uyvyFrame.data, true); //link the UYVY frame data to the NDI frame
+ }else if(capture_planar && !planar_direct){ //4:2:0 planes to UYVY
+  if(!convert_planes(p, index, uyvyFrame)){
+   fprintf(stderr, "Convert failed\n");
+  }
+  set_frame_data(&NDI_video_frame1, uyvyFrame.data, true);
+ }else{
+  set_frame_data(&NDI_video_frame1, (uint8_t*)p, false); //link the UYVY (or direct NV12/I420) frame data to the NDI frame 
+ }
+ stamp_frame(&NDI_video_frame1, index);
+ send_frame(&NDI_video_frame1, field, false); //send the data out to NDI
+}
+
+// Wait for a NDI receiver on the full or the proxy stream - no need to encode without a client connected
+bool capture_device::has_receivers(void){
+  if(pNDI_proxy_send && NDIlib_send_get_no_connections(pNDI_proxy_send, 0)){
+    return true;
+  }
+  return NDIlib_send_get_no_connections(pNDI_full_send, receiver_wait) > 0;
+}
+
+// Account a dequeued buffer of the capture, TRUE if frames were lost because the driver ran dry
+bool capture_device::buffer_dequeued(const struct v4l2_buffer *buf){
+  std::lock_guard<std::mutex> lock(buffer_lock);
+  buffer_in_driver--;
+  const bool lost = buffer_have_sequence && (buf->sequence != buffer_sequence + 1);
+  if(lost && (buf->sequence > buffer_sequence)){
+   frames_lost += buf->sequence - buffer_sequence - 1;
+  }
+  const bool starved = lost && ((buffer_in_driver_last <= 1) || (buffer_in_driver <= 0));
+  buffer_sequence = buf->sequence;
+  buffer_have_sequence = true;
+  buffer_in_driver_last = buffer_in_driver;
+  return starved;
+}
+
+// Put count more buffers into circulation, parked ones first, then new ones from VIDIOC_CREATE_BUFS
+void capture_device::grow_buffers(unsigned int count){
+  std::lock_guard<std::mutex> lock(buffer_lock);
+  const enum v4l2_memory memory = io_memory();
+  unsigned int added = 0;
+  for(unsigned int i = 0; (i < n_buffers) && (added < count); ++i){
+   struct buffer &b = buffers[i];
+   if(!b.parked || !b.start){
+    continue;
+   }
+   struct v4l2_buffer buf;
+   describe_buffer(buf, buffers, i, capture_type, memory);
+   if(-1 == xioctl(fd, VIDIOC_QBUF, &buf)){
+    errno_exit("VIDIOC_QBUF");
+   }
+   b.parked = 0;
+   buffer_in_driver++;
+   added++;
+  }
+  if((added < count) && (buffer_active + added < buffer_max)){
+   struct v4l2_create_buffers create;
+   CLEAR(create);
+   create.count = std::min(count - added, buffer_max - buffer_active - added);
+   create.memory = memory;
+   create.format.type = capture_type;
+   if(-1 == xioctl(fd, VIDIOC_G_FMT, &create.format)){
+    errno_exit("VIDIOC_G_FMT");
+   }
+   if((-1 == xioctl(fd, VIDIOC_CREATE_BUFS, &create)) || (create.count == 0)){
+    fprintf(stderr, "Cannot add capture buffers (%s)\n", strerror(errno));
+    buffer_max = buffer_active + added; // Don't try again
+   }else{
+    for(unsigned int i = create.index; i < create.index + create.count; ++i){
+     if(memory == V4L2_MEMORY_DMABUF){
+      alloc_udmabuf(i);
+     }else if(memory == V4L2_MEMORY_USERPTR){
+      alloc_userptr(i);
+     }else{
+      mmap_buffer(i);
+     }
+     if(((dmabuf_export == 1) || (dmabuf_socket != NULL)) && (memory == V4L2_MEMORY_MMAP)){
+      export_buffer(i);
+     }
+     if(memory_lock == 1){ // Mapped after mlockall, so not populated yet
+      prefault_buffers(buffers + i, 1);
+     }
+     struct v4l2_buffer buf;
+     describe_buffer(buf, buffers, i, capture_type, memory);
+     if(-1 == xioctl(fd, VIDIOC_QBUF, &buf)){
+      errno_exit("VIDIOC_QBUF");
+     }
+     buffer_in_driver++;
+     added++;
+    }
+    n_buffers = std::max(n_buffers, create.index + create.count);
+   }
+  }
+  buffer_active += added;
+  buffer_target = buffer_active;
+  buffer_high_water = std::max(buffer_high_water, buffer_active);
+}
+
+// Grow the capture buffer pool when the driver starved, shrink it back after a quiet period
+void capture_device::tune_buffers(bool starved){
+  #define BUFFER_GROW_STEP 2
+  #define BUFFER_SHRINK_AFTER 30.0      // Seconds without starvation before giving a buffer back
+  const double now = monotonic_seconds();
+  if(starved){
+   const unsigned int before = buffer_active;
+   grow_buffers(BUFFER_GROW_STEP);
+   if(buffer_active != before){
+    fprintf(stderr, "Frames lost with %u capture buffers, now %u\n", before, buffer_active);
+   }
+   buffer_last_change = now;
+   return;
+  }
+  if(now - buffer_last_change < BUFFER_SHRINK_AFTER){
+   return;
+  }
+  buffer_last_change = now;
+  std::lock_guard<std::mutex> lock(buffer_lock);
+  if((buffer_target == buffer_active) && (buffer_active > buffer_count)){
+   buffer_target = buffer_active - 1; // The next requeued buffer is parked
+  }
+}
+
+// Bytes of image data in a dequeued buffer, over all planes of a multi-planar one
+static unsigned int capture_bytesused(const struct v4l2_buffer *buf){
+  if(!V4L2_TYPE_IS_MULTIPLANAR(buf->type)){
+   return buf->bytesused;
+  }
+  unsigned int bytesused = 0;
+  for(unsigned int p = 0; p < buf->length; ++p){
+   bytesused += buf->m.planes[p].bytesused - buf->m.planes[p].data_offset;
+  }
+  return bytesused;
+}
+
+// Dequeue a capture buffer, nullptr when none is ready. starved is set
+// when frames were lost because the driver ran dry.
+std::unique_ptr<v4l2_buffer> capture_device::dequeue_capture(bool &starved){
+  auto buf = std::make_unique<v4l2_buffer>();
+  struct v4l2_plane planes[VIDEO_MAX_PLANES];
+  const bool mplane = V4L2_TYPE_IS_MULTIPLANAR(capture_type);
+  //CLEAR(buf);
+  buf->type = capture_type;
+  buf->memory = io_memory();
+  if(mplane){
+   CLEAR(planes);
+   buf->m.planes = planes;
+   buf->length = VIDEO_MAX_PLANES;
+  }
+  if (-1 == xioctl(fd, VIDIOC_DQBUF, buf.get())) { //dequeue the buffer - dumps data into the previously set mmap
+   switch (errno){
+    case EAGAIN:
+     return nullptr;
+    case EIO:
+     /* Could ignore EIO, see spec. */
+     /* fall through */
+    default:
+     errno_exit("VIDIOC_DQBUF");
+   }
+  }
+  assert(buf->index < n_buffers);
+  starved |= buffer_dequeued(buf.get());
+  struct buffer &b = buffers[buf->index];
+  b.dequeued = monotonic_ns();
+  b.captured = 0;
+  if((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC){ // Our clock, so the time the frame waited is known
+   b.captured = (int64_t)buf->timestamp.tv_sec * 1000000000 + (int64_t)buf->timestamp.tv_usec * 1000;
+   dequeue_latency.Add((b.dequeued - b.captured) / 1000);
+   last_frame_time = b.captured / 1e9;
+  }
+  if(mplane){ // The plane descriptors stay with the buffer, it may go on to the image thread
+   memcpy(buffers[buf->index].planes, planes, sizeof(planes));
+   buf->m.planes = buffers[buf->index].planes;
+  }
+  dmabuf_sync_planes(buffers[buf->index], DMA_BUF_SYNC_START);
+  if(signal_monitor){
+   signal_monitor->FrameArrived(monotonic_seconds());
+  }
+  return buf;
+}
+
+// Send a dequeued buffer on its way: to local consumers, then to NDI directly, asynchronously or through the image thread
+void capture_device::process_capture(std::unique_ptr<v4l2_buffer> buf){
+  const unsigned int bytesused = capture_bytesused(buf.get());
+  if(dmabuf_publisher){ // Local consumers map the same buffer
+   zs::DmabufFrame info;
+   info.index = buf->index;
+   info.width = m_width;
+   info.height = m_height;
+   info.stride = m_stride ? m_stride : m_width * 2;
+   info.fourcc = m_format;
+   info.bytesused = bytesused;
+   info.sequence = buf->sequence;
+   info.timestamp = (int64_t)buf->timestamp.tv_sec * 1000000000 + (int64_t)buf->timestamp.tv_usec * 1000;
+   dmabuf_publisher->Publish(buffers[buf->index].dmabuf, info);
+  }
+  void *data = capture_data(buf->index);
+  if((io == IO_METHOD_USERPTR) && (ndi_async == 1)){ // The filled buffer goes with the frame, the slot gets a fresh one
+   userptr_dequeued = std::move(userptr_slots[buf->index]);
+   userptr_slots[buf->index] = frame_pool.Acquire(buffers[buf->index].length);
+   if(!userptr_slots[buf->index]){
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+   }
+   buffers[buf->index].start = buffers[buf->index].plane_start[0] = userptr_slots[buf->index].get();
+  }
+
+  if(has_receivers()){ //wait for a NDI receiver to be present before continuing - no need to encode without a client connected
+   printf("%x", buf->index & 0x0F);
+   fflush(stdout);
+   if(ndi_async == 1){
+    process_image_async(data, bytesused, buf->field, buf->index); //send the capture buffer off to be processed
+   }else{
+    if(image_threaded == 1){
+      queue_push(std::move(buf));
+    }else{
+     process_image(data, bytesused, buf->field, buf->index); //send the mmap frame buffer off to be processed
+    }
+   }
+  }
+
+  if(buf){ // Not handed to the image thread
+    requeue_capture(buf->index);
+  }
+}
+
+// Dequeue everything that is ready in one wakeup, so a backlog never builds up one syscall pair at a time.
+// In latest-only mode all but the newest buffer go straight back to the driver.
+int capture_device::read_frame(void){ //this function reads the frames from the video capture device
+  std::unique_ptr<v4l2_buffer> batch[VIDEO_MAX_FRAME];
+  unsigned int count = 0;
+  bool starved = false;
+  while(count < VIDEO_MAX_FRAME){
+   batch[count] = dequeue_capture(starved);
+   if(!batch[count]){
+    break;
+   }
+   count++;
+  }
+  if(count == 0){
+   return 0;
+  }
+  unsigned int first = 0;
+  if(latest_only == 1){
+   for(; first + 1 < count; ++first){
+    requeue_capture(batch[first]->index);
+   }
+   latest_dropped += first;
+  }
+  for(unsigned int i = first; i < count; ++i){
+   process_capture(std::move(batch[i]));
+  }
+  tune_buffers(starved);
+  return count;
+}
+
+// Ask the driver to report signal changes of DV (HDMI, SDI) receivers
+void capture_device::subscribe_signal_events(void){
+  struct v4l2_event_subscription sub;
+  CLEAR(sub);
+  sub.type = V4L2_EVENT_SOURCE_CHANGE;
+  if(-1 == xioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub)){
+   fprintf(stderr, "%s has no source change events, signal loss is detected from the frames\n", device.c_str());
+  }
+  CLEAR(sub);
+  sub.type = V4L2_EVENT_CTRL;
+  sub.id = V4L2_CID_DV_RX_POWER_PRESENT;
+  sub.flags = V4L2_EVENT_SUB_FL_SEND_INITIAL;
+  xioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub); // Optional, only some receivers detect +5V
+}
+
+void capture_device::dequeue_signal_events(void){
+  struct v4l2_event ev;
+  CLEAR(ev);
+  while(0 == xioctl(fd, VIDIOC_DQEVENT, &ev)){
+   if(ev.type == V4L2_EVENT_SOURCE_CHANGE){
+    struct v4l2_dv_timings timings;
+    CLEAR(timings);
+    bool lost = false;
+    if(-1 == xioctl(fd, VIDIOC_QUERY_DV_TIMINGS, &timings)){
+     lost = (errno == ENOLINK) || (errno == ENOLCK) || (errno == ERANGE);
+    }
+    signal_monitor->SetNoSignal(lost);
+    if(!lost && (ev.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION)){ // Handled by the capture loop, outside the event loop
+     reconfigure_pending = true;
+    }
+   }else if((ev.type == V4L2_EVENT_CTRL) && (ev.id == V4L2_CID_DV_RX_POWER_PRESENT)){
+    signal_monitor->SetNoSignal(ev.u.ctrl.value == 0);
+   }
+  }
+}
+
+// Fill the slate: the --slate image (raw RGB24 of the sent size) or 75% color
+// bars, converted to UYVY once and re-sent as is while the input is lost
+void capture_device::init_slate(void){
+  int w = sw_crop ? crop_rect.width : m_width;
+  int h = sw_crop ? crop_rect.height : m_height;
+  if((w == 0) || (h == 0)){
+   w = 1920;
+   h = 1080;
+  }
+  if((sw_rotation == 90) || (sw_rotation == 270)){
+   std::swap(w, h);
+  }
+
+  zs::Frame rgb(w, h, (uint32_t)zs::ValidFourccCodes::RGB24);
+  bool loaded = false;
+  if(slate_file != NULL){
+   FILE *f = fopen(slate_file, "rb");
+   if(f != NULL){
+    loaded = fread(rgb.data, 1, rgb.size, f) == rgb.size;
+    fclose(f);
+   }
+   if(!loaded){
+    fprintf(stderr, "Cannot read slate %s (raw RGB24, %dx%d), sending color bars\n", slate_file, w, h);
+   }
+  }
+  if(!loaded){
+   static const uint8_t bars[7][3] = {
+    { 191, 191, 191 }, { 191, 191, 0 }, { 0, 191, 191 }, { 0, 191, 0 },
+    { 191, 0, 191 }, { 191, 0, 0 }, { 0, 0, 191 } };
+   for(int y = 0; y < h * 3 / 4; y++){
+    uint8_t *row = rgb.data + y * w * 3;
+    for(int x = 0; x < w; x++){
+     memcpy(row + x * 3, bars[x * 7 / w], 3);
+    }
+   }
+  }
+
+  slate_frame = zs::Frame(w, h, (uint32_t)zs::ValidFourccCodes::UYVY);
+  if(!converter.Convert(rgb, slate_frame)){
+   fprintf(stderr, "Slate conversion failed\n");
+  }
+  NDI_slate_frame.xres = w;
+  NDI_slate_frame.yres = h;
+  NDI_slate_frame.FourCC = NDIlib_FourCC_type_UYVY;
+  NDI_slate_frame.frame_rate_N = (int)(slate_fps * 1000);
+  NDI_slate_frame.frame_rate_D = 1000;
+  NDI_slate_frame.line_stride_in_bytes = w * 2;
+  NDI_slate_frame.p_data = slate_frame.data;
+}
+
+// Report changes of the input and keep the NDI source alive with the slate while the input
+// has no usable picture, or held - while another input the frames need has none (key/fill)
+zs::SignalState capture_device::service_signal(bool held){
+  const double now = monotonic_seconds();
+  const zs::SignalState state = signal_monitor->Check(now, 1.0);
+  if(state != reported){
+   static const char *names[] = { "live", "lost", "black", "frozen" };
+   fprintf(stderr, "\n%s: input %s\n", ndi_name.c_str(), names[(int)state]);
+   reported = state;
+  }
+  if(((state == zs::SignalState::Live) && !held) || !pNDI_full_send || (now - last_slate < 1.0 / slate_fps)){
+   return state;
+  }
+  last_slate = now;
+  output_frame(&NDI_slate_frame, true);
+  return state;
+}
+
+// Size the conversion storage and the NDI frames for the current capture
+void capture_device::init_frames(void){
+  yuy2Frame.fourcc = MAKE_FOURCC_CODE('Y','U','Y','2'); //describes the capture being converted, its data is borrowed for the call
+  yuy2Frame.width = m_width;
+  yuy2Frame.height = m_height;
+  yuy2Frame.size = m_width * m_height * 2;
+  uyvyFrame.fourcc = MAKE_FOURCC_CODE('U','Y','V','Y'); //initialize conversion frame storage - UYVY
+  if(yuyv){ // Allocated up front, so convert_capture() can spread the conversion over the workers
+   uyvyFrame = zs::Frame(sw_crop ? crop_rect.width : m_width, sw_crop ? crop_rect.height : m_height, MAKE_FOURCC_CODE('U','Y','V','Y'));
+  }
+  NDI_video_frame1.xres = m_width;
+  NDI_video_frame1.yres = m_height;
+  NDI_video_frame1.frame_rate_N = fps_N;
+  NDI_video_frame1.frame_rate_D = fps_D;
+  set_frame_format(&NDI_video_frame1); //set NDI to receive the type of frame that is going to be given to it - UYVY, or NV12/I420 from a 4:2:0 capture
+  
+  if(ndi_async == 1){ //initialize frame2 for async
+   NDI_video_frame2.xres = m_width; 
+   NDI_video_frame2.yres = m_height;
+   NDI_video_frame2.frame_rate_N = fps_N;
+   NDI_video_frame2.frame_rate_D = fps_D;
+   set_frame_format(&NDI_video_frame2);
+  }
+}
+
+// Settings of the stages that follow the capture format, at start and after the source changed
+void capture_device::init_format_stages(void){
+  if(lens){ // The intrinsics are in pixels of the first capture, scale them to the current one
+   const int w = sw_crop ? crop_rect.width : m_width;
+   const int h = sw_crop ? crop_rect.height : m_height;
+   if(lens_width == 0){
+    lens_width = w;
+    lens_height = h;
+   }
+   zs::LensParameters scaled = lens_parameters;
+   scaled.fx *= (float)w / lens_width;
+   scaled.cx *= (float)w / lens_width;
+   scaled.fy *= (float)h / lens_height;
+   scaled.cy *= (float)h / lens_height;
+   lens->SetParameters(scaled);
+   if((w != lens_width) || (h != lens_height)){
+    fprintf(stderr, "Lens intrinsics given for %dx%d scaled to %dx%d\n", lens_width, lens_height, w, h);
+   }
+  }
+  if(lut){ // SD sources are BT.601, HD ones BT.709
+   const int frame_height = m_height ? m_height : height;
+   const bool bt601 = (lut_matrix == 601) || ((lut_matrix == 0) && (frame_height > 0) && (frame_height < 720));
+   lut->SetMatrix(bt601 ? zs::ColorMatrix::BT601 : zs::ColorMatrix::BT709);
+  }
+
+  // A 4:2:0 capture goes to NDI as it is unless a stage needs UYVY, then its planes are converted
+  planar_direct = capture_planar && (m_planes == 1) && !lut && !region_blur && !denoiser && !deinterlacer
+                  && (field_mode == FIELDS_OFF) && !rotator && !lens && (proxy == 0);
+  if(capture_planar){
+   fprintf(stderr, "Capturing %s, %s\n", fourcc(m_format).c_str(), planar_direct ? "sent to NDI without conversion" : "converted to UYVY from its planes");
+  }
+}
+
+// The source changed its resolution or rate: stop the capture, reallocate the buffers for the
+// new geometry and start again. The NDI senders stay, so receivers only miss a few frames.
+void capture_device::reconfigure_capture(void){
+  reconfigure_pending = false;
+  const double start = monotonic_seconds();
+  if(image_threaded == 1){ // It may be reading a capture buffer
+   queue_push(std::make_unique<v4l2_buffer>()); // Zeroed, the signal to exit
+   image_thread.join();
+  }
+  {
+   std::lock_guard<std::mutex> lock(send_lock);
+   NDIlib_send_send_video_async_v2(pNDI_full_send, NULL); // NDI lets go of the last frame
+  }
+  stop_capturing();
+  uninit_device();
+  struct v4l2_requestbuffers req;
+  CLEAR(req);
+  req.type = capture_type;
+  req.memory = io_memory();
+  if(-1 == xioctl(fd, VIDIOC_REQBUFS, &req)){ // Free the driver's buffers, the format cannot change while they exist
+   errno_exit("VIDIOC_REQBUFS");
+  }
+
+  float dv_N, dv_D;
+  if(init_dv_timings(device.c_str(), fd, dv_N, dv_D) && !fps_requested){
+   fps_N = dv_N;
+   fps_D = dv_D;
+  }
+  init_capture_format();
+  if((crop == 1) && !init_crop()){ // Better the whole picture than no picture
+   reset_device_crop();
+   fprintf(stderr, "Sending the uncropped %dx%d capture\n", m_width, m_height);
+   crop = 0;
+   sw_crop = 0;
+  }
+  init_frame_rate(device.c_str(), fd, capture_type, fps_N, fps_D, fps_requested, false);
+  init_capture_buffers();
+  {
+   std::lock_guard<std::mutex> lock(buffer_lock);
+   buffer_have_sequence = false;
+  }
+  frame_pool.Trim(); // Buffers of the old size would never be handed out again
+  if(denoiser){
+   denoiser->Reset();
+  }
+  if(cadence){
+   cadence->Reset();
+  }
+  if(motion_meter){
+   motion_meter->Reset();
+  }
+  init_format_stages(); // planar_direct decides the format of the frames
+  init_frames();
+  init_slate();
+
+  start_capturing();
+  buffer_in_driver = buffer_in_driver_last = n_buffers;
+  buffer_last_change = monotonic_seconds();
+  last_frame_time = 0;
+  if(image_threaded == 1){
+   image_thread = std::thread(&capture_device::process_image_thread, this);
+  }
+  fprintf(stderr, "\nReconfigured for %dx%d at %.2f fps in %.0f ms\n", m_width, m_height, fps_N / fps_D, (monotonic_seconds() - start) * 1000);
+}
+
+// Run the calling thread on one core only
+static void pin_thread(int cpu){
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if(err != 0){
+   fprintf(stderr, "Cannot pin the capture thread to CPU %d: %s\n", cpu, strerror(err));
+  }
+}
+
+// Sleep until a monotonic time (seconds), returns at once when it has passed
+static void sleep_until(double when){
+  struct timespec ts;
+  ts.tv_sec = (time_t)when;
+  ts.tv_nsec = (long)((when - ts.tv_sec) * 1e9);
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR){
+  }
+}
+
+#define BUSY_POLL_MARGIN 0.002  // Seconds before the expected frame the polling starts
+#define BUSY_POLL_IDLE   1.0    // Seconds without frames after which the loop waits in poll() again
+
+// Capture loop of the busy-poll mode: sleep until just before the next frame is due by the
+// driver's timestamps, then spin on VIDIOC_DQBUF from the pinned core until it arrives
+void capture_device::busy_poll_loop(void){
+  pin_thread(busy_poll_cpu);
+  while(!stop_requested){
+   const double period = fps_N > 0 ? fps_D / fps_N : 0; // The rate changes with the source
+   const double now = monotonic_seconds();
+   if((last_frame_time == 0) || (period == 0) || (now - last_frame_time > BUSY_POLL_IDLE)){ // No cadence to follow, wait like the select loop
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN | POLLPRI;
+    const int r = poll(&pfd, 1, 100);
+    if((r == -1) && (errno != EINTR)){
+     errno_exit("poll");
+    }
+    wakeup((r > 0) && (pfd.revents & POLLIN), (r > 0) && (pfd.revents & POLLPRI));
+    service_signal();
+    continue;
+   }
+
+   // Next frame due after the newest one dequeued, skipping any that were missed
+   double due = last_frame_time + period;
+   while(due < now){
+    due += period;
+   }
+   sleep_until(due - BUSY_POLL_MARGIN);
+   const double give_up = due + period;
+   while(read_frame() == 0){
+    if(monotonic_seconds() > give_up){
+     break;
+    }
+   }
+
+   struct pollfd pfd; // Signal events are not worth a spin, just look for them
+   pfd.fd = fd;
+   pfd.events = POLLPRI;
+   if((poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLPRI)){
+    dequeue_signal_events();
+   }
+   if(reconfigure_pending){
+    reconfigure_capture();
+   }
+   service_signal();
+  }
+}
+
+// Open the device and set up its capture: format, rate, crop, orientation and buffers.
+// An input of multiview or key/fill is used whole and unrotated, the canvas places it.
+void capture_device::open_capture(bool input){
+  open_device(device.c_str(), fd);
+  probe_capture_type();
+  float dv_N, dv_D;
+  const bool dv = init_dv_timings(device.c_str(), fd, dv_N, dv_D);
+  init_capture_format();
+  if(dv && !fps_requested){
+   fps_N = dv_N;
+   fps_D = dv_D;
+  }
+  init_frame_rate(device.c_str(), fd, capture_type, fps_N, fps_D, fps_requested, !dv); // A receiver's rate comes from its timings
+  if((m_planes > 1) && ((io == IO_METHOD_USERPTR) || (dmabuf_socket != NULL))){
+   fprintf(stderr, "--userptr and --dmabuf-socket need a single memory plane, %s has %u\n", fourcc(m_format).c_str(), m_planes);
+   exit(EXIT_FAILURE);
+  }
+  if(!input){
+   if((crop == 1) && !init_crop()){
+    exit(EXIT_FAILURE);
+   }
+   init_orientation();
+  }
+  init_capture_buffers();
+}
+
+// Create the processing stages the options ask for, all on the shared workers
+void capture_device::init_stages(void){
+  if(dmabuf_socket != NULL){
+   dmabuf_publisher.reset(new zs::DmabufPublisher());
+   if(!dmabuf_publisher->Open(dmabuf_socket)){
+    fprintf(stderr, "Cannot listen on %s: %s\n", dmabuf_socket, strerror(errno));
+    exit(EXIT_FAILURE);
+   }
+  }
+  if(lut_file != NULL){
+   lut.reset(new zs::Lut3D(*workers));
+   if(!lut->LoadCube(lut_file)){
+    fprintf(stderr, "Cannot load LUT %s: %s\n", lut_file, lut->GetError().c_str());
+    exit(EXIT_FAILURE);
+   }
+  }
+  if(deinterlace == 1){
+   deinterlacer.reset(new zs::Deinterlacer(*workers));
+  }
+  if(denoise_strength > 0){
+   denoiser.reset(new zs::TemporalDenoiser(*workers, frame_pool));
+   denoiser->SetParameters(denoise_strength, denoise_threshold);
+  }
+  signal_monitor.reset(new zs::SignalMonitor());
+  signal_monitor->SetThresholds(black_after, frozen_after);
+  subscribe_signal_events();
+  if(dedupe == 1){
+   cadence.reset(new zs::CadenceDetector());
+  }
+  if(idle_fps > 0){
+   motion_meter.reset(new zs::MotionMeter());
+  }
+  if(!blur_regions.empty()){
+   region_blur.reset(new zs::RegionBlur(*workers));
+   if(!region_blur->SetRegions(blur_regions, blur_radius)){
+    fprintf(stderr, "Blur radius must be 1-127\n");
+    exit(EXIT_FAILURE);
+   }
+  }
+  if(lens_correct == 1){
+   lens.reset(new zs::LensCorrector(*workers));
+  }
+  if((sw_rotation != 0) || (sw_hflip == 1)){
+   rotator.reset(new zs::FrameRotator(*workers));
+  }
+  init_format_stages();
+}
+
+// Create the full and proxy NDI senders. A thread that serves other devices too is paced
+// by the captures, it must never block in a send or wait for a receiver.
+void capture_device::open_senders(bool shared_thread){
+  NDIlib_send_create_t desc = NDI_send_create_desc;
+  desc.p_ndi_name = ndi_name.c_str();
+  if(shared_thread){
+   desc.clock_video = false;
+   receiver_wait = 0;
+  }
+  pNDI_full_send = NDIlib_send_create(&desc);
+  if (!pNDI_full_send){
+   fprintf(stderr, "Failed to create NDI Full Send");
+   exit(1);
+  }
+  if(proxy == 1){ //Proxy NDI, paced by the capture so NDI does not clock it
+   // --proxy-name is one name, the proxies of --streams are named after their streams
+   const std::string name = (proxy_name.empty() || (streams_file != NULL)) ? ndi_name + " Proxy" : proxy_name;
+   NDIlib_send_create_t proxy_desc;
+   proxy_desc.p_ndi_name = name.c_str();
+   proxy_desc.clock_video = false;
+   pNDI_proxy_send = NDIlib_send_create(&proxy_desc);
+   if (!pNDI_proxy_send){
+    fprintf(stderr, "Failed to create NDI Proxy Send");
+    exit(1);
+   }
+   proxy_scaler.reset(new zs::FrameScaler(*workers, proxy_filter));
+   proxy_thread = std::thread(&capture_device::proxy_send_thread, this);
+  }
+}
+
+// Start capturing into the pipeline
+void capture_device::start(void){
+  init_frames();
+  init_slate();
+  if (image_threaded == 1){
+    image_thread = std::thread(&capture_device::process_image_thread, this);
+  }
+  start_capturing();
+  buffer_in_driver = buffer_in_driver_last = n_buffers;
+  buffer_last_change = monotonic_seconds();
+}
+
+// Stop capturing, wind down the threads of the device and release it
+void capture_device::stop(void){
+  stop_capturing();
+
+  if (image_thread.joinable()){
+    // Signal the image thread to exit by sending an empty message
+    auto nullmsg = std::make_unique<v4l2_buffer>();
+    queue_push(std::move(nullmsg));
+    image_thread.join();
+  }
+
+  if(proxy_thread.joinable()){
+    {
+      std::lock_guard<std::mutex> lock(proxy_lock);
+      proxy_exit = true;
+    }
+    proxy_condvar.notify_one();
+    proxy_thread.join();
+  }
+
+  if(pNDI_full_send){
+    {
+      std::lock_guard<std::mutex> lock(send_lock);
+      NDIlib_send_send_video_async_v2(pNDI_full_send, NULL); // NDI lets go of the last frame before the buffers go
+    }
+    NDIlib_send_destroy(pNDI_full_send);
+    pNDI_full_send = nullptr;
+  }
+  if(pNDI_proxy_send){
+    NDIlib_send_destroy(pNDI_proxy_send);
+    pNDI_proxy_send = nullptr;
+  }
+
+  uninit_device();
+  close_device();
+  fprintf(stderr, "\n%s: over the whole run\n", ndi_name.c_str());
+  report_latency(true);
+  fprintf(stderr, "\n");
+}
+
+// The device is readable or has an event: take in signal changes, set the capture up
+// again when the source changed, otherwise dequeue and send what is ready
+void capture_device::wakeup(bool readable, bool event){
+  if(event){
+   dequeue_signal_events();
+  }
+  if(reconfigure_pending){
+   reconfigure_capture();
+   return;
+  }
+  if(readable){
+   read_frame();
+  }
+}
+
+static void request_stop(int){
+  stop_requested = 1;
+}
+
+static int mainloop(capture_device &dev){
+  apply_policy(rt_send, "send"); // NDI's threads inherit the scheduling of the thread that starts them
+  if (!NDIlib_initialize()){	// Cannot run NDI. Most likely because the CPU is not sufficient (see SDK documentation).
+   fprintf(stderr, "CPU cannot run NDI");
+   return 0;
+  } 
+  dev.open_senders(false);
+  dev.start();
+  apply_policy(rt_capture, "capture");
+  if(busy_poll_cpu >= 0){
+   dev.busy_poll_loop();
+   dev.stop();
+   return 0;
+  }
+  while(!stop_requested){ //while loop for querying for new data from video capture device and reading new frames
+    struct timeval tv;
+    fd_set fds, events;
+    int r;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000; // Often enough to pace the slate, no frames for a while is not fatal
+    FD_ZERO(&fds);
+    FD_SET(dev.fd, &fds);
+    FD_ZERO(&events);
+    FD_SET(dev.fd, &events);
+    r = select(dev.fd + 1, &fds, NULL, &events, &tv); //see when v4l2 video capture is ready
+    if (-1 == r) {
+     if (EINTR == errno){
+      continue;
+     }
+     errno_exit("select");
+    }
+    dev.wakeup((r > 0) && FD_ISSET(dev.fd, &fds), (r > 0) && FD_ISSET(dev.fd, &events));
+    dev.service_signal();
+    /* EAGAIN - continue select loop. */
+  }
+  dev.stop();
+  return 0;
+}
+
+// An input of the multi-device modes (multiview, key and fill) and the frames it holds
+struct capture_input {
+  capture_device dev;
+  std::mutex lock;
+  int latest = -1;                      // Newest dequeued buffer, held until a newer one arrives
+  int reading = -1;                     // Buffer the compositor is drawing from
+  bool requeue_reading = false;         // Requeue 'reading' once the compositor is done with it
+  double timestamp = 0;                 // Capture time of 'latest'
+  bool paired = false;                  // 'latest' was already combined with the other input
+  bool lost = false;                    // No usable picture: its multiview tile shows the slate, a fill is not paired
+};
+
+std::vector<std::unique_ptr<capture_input>> mv_inputs;
+NDIlib_send_instance_t multiview_send = nullptr;
+std::unique_ptr<zs::Compositor> compositor;
+std::unique_ptr<zs::AlphaPacker> alpha_packer;
+
+// Open, configure and map a device of the multi-device modes, reported under name
+static std::unique_ptr<capture_input> open_input(const std::string &device, const std::string &name){
+  std::unique_ptr<capture_input> in(new capture_input());
+  in->dev.device = device;
+  in->dev.ndi_name = name;
+  in->dev.open_capture(true); // With -n/-e no faster than the output, the frames in between would only be dropped
+  if(!in->dev.yuyv && (in->dev.m_format != V4L2_PIX_FMT_UYVY)){
+   fprintf(stderr, "%s captures %s, multiview and key/fill take YUYV or UYVY\n", device.c_str(), fourcc(in->dev.m_format).c_str());
+   exit(EXIT_FAILURE);
+  }
+  in->dev.signal_monitor.reset(new zs::SignalMonitor());
+  in->dev.signal_monitor->SetThresholds(black_after, frozen_after);
+  in->dev.subscribe_signal_events();
+  in->dev.init_slate();
+  return in;
+}
+
+// Dequeue a frame of one input, it replaces the frame the compositor draws
+static void multiview_dequeue(capture_input &in){
+  bool starved = false;
+  std::unique_ptr<v4l2_buffer> buf = in.dev.dequeue_capture(starved);
+  if(!buf){
+    return;
+  }
+  uint8_t *data = in.dev.capture_data(buf->index);
+
+  if(in.dev.yuyv){ // Convert to UYVY in place, so the buffer serves the canvas and the separate stream
+    zs::Frame src, dst;
+    src.fourcc = (uint32_t)zs::ValidFourccCodes::YUY2;
+    src.width = in.dev.m_width;
+    src.height = in.dev.m_height;
+    src.size = buf->bytesused;
+    src.data = data;
+    dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+    dst.size = buf->bytesused;
+    dst.data = data;
+    if(!converter.Convert(src, dst)){
+      fprintf(stderr, "Convert failed\n");
+    }
+    // Zero the data elements or zs::~Frame will try to free the memory!
+    src.data = dst.data = nullptr;
+  }
+  const int stride = in.dev.m_stride ? in.dev.m_stride : in.dev.m_width * 2;
+  if(in.dev.signal_monitor->Update(data, in.dev.m_width, in.dev.m_height, stride, 1, monotonic_seconds()) != zs::SignalState::Live){
+    in.dev.requeue_capture(buf->index); // The slate stands in for it
+    return;
+  }
+
+  if(in.dev.pNDI_full_send){
+    in.dev.NDI_video_frame1.p_data = data;
+    NDIlib_send_send_video_async_v2(in.dev.pNDI_full_send, &in.dev.NDI_video_frame1);
+    in.dev.frames_sent++;
+  }
+
+  std::lock_guard<std::mutex> guard(in.lock);
+  const int old = in.latest;
+  in.latest = buf->index;
+  if(old < 0){
+    return;
+  }
+  if(old == in.reading){
+    in.requeue_reading = true;
+  }else{
+    in.dev.requeue_capture(old);
+  }
+}
+
+// Wait on all inputs at once; an input that stalls keeps its last frame until it counts as lost
+static void multiview_capture_thread(void){
+  apply_policy(rt_capture, "capture");
+  while(!stop_requested){
+    fd_set fdset, events;
+    int max_fd = -1;
+    FD_ZERO(&fdset);
+    FD_ZERO(&events);
+    for(auto &in : mv_inputs){
+      FD_SET(in->dev.fd, &fdset);
+      FD_SET(in->dev.fd, &events);
+      max_fd = std::max(max_fd, in->dev.fd);
+    }
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000; // Often enough to pace the slate, no frames for a while is not fatal
+    int r = select(max_fd + 1, &fdset, NULL, &events, &tv);
+    if(-1 == r){
+      if(EINTR == errno){
+        continue;
+      }
+      errno_exit("select");
+    }
+    for(auto &in : mv_inputs){
+      if((r > 0) && FD_ISSET(in->dev.fd, &events)){
+        in->dev.dequeue_signal_events(); // A new format is not followed, the tile scales what comes
+      }
+      if((r > 0) && FD_ISSET(in->dev.fd, &fdset)){
+        multiview_dequeue(*in);
+      }
+      const bool lost = in->dev.service_signal() != zs::SignalState::Live;
+      std::lock_guard<std::mutex> guard(in->lock);
+      in->lost = lost;
+    }
+  }
+}
+
+// Draw the newest frame of every input and send the canvas at a fixed cadence
+static void multiview_loop(void){
+  const double period = fps_D / fps_N;
+  const size_t canvas_size = (size_t)multiview_width * multiview_height * 2;
+  std::shared_ptr<uint8_t> shown;       // Canvas the NDI stack may still be reading
+  double next = monotonic_seconds();
+
+  NDIlib_video_frame_v2_t frame;
+  frame.xres = multiview_width;
+  frame.yres = multiview_height;
+  frame.frame_rate_N = fps_N;
+  frame.frame_rate_D = fps_D;
+  frame.FourCC = NDIlib_FourCC_type_UYVY;
+
+  while(!stop_requested){
+    // Never wait for an input, only for the next output tick
+    next += period;
+    const double now = monotonic_seconds();
+    if(next < now - period){
+      next = now;
+    }
+    struct timespec ts;
+    ts.tv_sec = (time_t)next;
+    ts.tv_nsec = (long)((next - (double)ts.tv_sec) * 1e9);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR){
+    }
 
-      // Create a new frame we can pass to the NDI stack
-      frame = std::make_unique<NDIlib_video_frame_v2_t>();
-      frame->xres = m_width;
-      frame->yres = m_height;
-      frame->frame_rate_N = fps_N;
-      frame->frame_rate_D = fps_D;
-      frame->FourCC = NDIlib_FourCC_type_UYVY;
-      frame->p_data = (uint8_t*)buffers[buf->index].start;
+    if(!NDIlib_send_get_no_connections(multiview_send, 0)){
+      continue;
+    }
 
-      // We're now done with the previous v4l2 buffer, so requeue it
-      if (last_buf){
-        if(-1 == xioctl(fd, VIDIOC_QBUF, last_buf)){
-          errno_exit("VIDIOC_QBUF");
+    std::shared_ptr<uint8_t> canvas = frame_pool.Acquire(canvas_size);
+    if(!canvas){
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    compositor->ClearBorders(canvas.get());
+    for(size_t i = 0; i < mv_inputs.size(); i++){
+      capture_input &in = *mv_inputs[i];
+      int index;
+      bool lost;
+      {
+        std::lock_guard<std::mutex> guard(in.lock);
+        index = in.reading = in.latest;
+        lost = in.lost;
+      }
+      if(lost){
+        const zs::Frame &slate = in.dev.slate_frame;
+        if(!compositor->Draw(i, slate.data, slate.width, slate.height, slate.width * 2, canvas.get())){
+          fprintf(stderr, "Multiview draw failed for %s\n", in.dev.device.c_str());
         }
+      }else if(index < 0){
+        compositor->Clear(i, canvas.get());
+      }else if(!compositor->Draw(i, in.dev.capture_data(index), in.dev.m_width, in.dev.m_height, in.dev.m_stride, canvas.get())){
+        fprintf(stderr, "Multiview draw failed for %s\n", in.dev.device.c_str());
       }
+      std::lock_guard<std::mutex> guard(in.lock);
+      if(in.requeue_reading){
+        in.dev.requeue_capture(index);
+        in.requeue_reading = false;
+      }
+      in.reading = -1;
+    }
 
-      // Pass the frame to the NDI stack
-      NDIlib_send_send_video_async_v2(pNDI_full_send, frame.get());
-
-      // Keep references to what we passed to the NDI stack until we queue the
-      // next frame, or the memory could disappear out from under us!
-      last_buf = buf.release();
-      last_frame = std::move(frame);
+    frame.p_data = canvas.get();
+    NDIlib_send_send_video_async_v2(multiview_send, &frame);
+    // The send above released the previous canvas back to the NDI stack, and so to the pool
+    shown = std::move(canvas);
+    for(auto &in : mv_inputs){
+      in->dev.report_stats();
     }
   }
+  NDIlib_send_send_video_async_v2(multiview_send, NULL); // NDI lets go of the last canvas
 }
 
-static void process_image_async(const void *p, int size){
- frame_buffer = 1 - frame_buffer; 
- //std::cout << "Frame size: " << size << std::endl; 
- if(frame_buffer == 0){
-  p_frame1 = (uint8_t*)malloc(size);
-  memcpy(p_frame1, (uint8_t*)p, size);
-  if(force_yuyv == 1){ //if this is enabled - convert from YUY2 to UYVY for NDI
-   yuy2Frame.data = p_frame1;
-   if(!converter.Convert(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
-    fprintf(stderr, "Convert failed\n");       
-   }
-   NDI_video_frame1.p_data = uyvyFrame.data; //link the UYVY frame data to the NDI frame
-  }else{
-   NDI_video_frame1.p_data = p_frame1; //link the UYVY frame data to the NDI frame 
+static int run_multiview(void){
+  apply_policy(rt_send, "send"); // NDI's threads inherit the scheduling of the thread that starts them
+  if (!NDIlib_initialize()){	// Cannot run NDI. Most likely because the CPU is not sufficient (see SDK documentation).
+   fprintf(stderr, "CPU cannot run NDI");
+   return 0;
   }
-  NDIlib_send_send_video_async_v2(pNDI_full_send, &NDI_video_frame1); //send the data out to NDI
-  free(p_frame2);
- }
- if(frame_buffer == 1){
-  p_frame2 = (uint8_t*)malloc(size);
-  memcpy(p_frame2, (uint8_t*)p, size);
-  if(force_yuyv == 1){ //if this is enabled - convert from YUY2 to UYVY for NDI
-   yuy2Frame.data = p_frame2;
-   if(!converter.Convert(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
-    fprintf(stderr, "Convert failed\n");       
-   }
-   NDI_video_frame2.p_data = uyvyFrame.data; //link the UYVY frame data to the NDI frame
-  }else{
-   NDI_video_frame2.p_data = p_frame2; //link the UYVY frame data to the NDI frame 
+  // The canvas is paced by multiview_loop, not by NDI
+  NDI_send_create_desc.p_ndi_name = ndi_name;
+  NDI_send_create_desc.clock_video = false;
+  multiview_send = NDIlib_send_create(&NDI_send_create_desc);
+  if (!multiview_send){
+   fprintf(stderr, "Failed to create NDI Full Send");
+   exit(1);
   }
-  NDIlib_send_send_video_async_v2(pNDI_full_send, &NDI_video_frame2); //send the data out to NDI
-  free(p_frame1);
- }
-}
 
-static void process_image(const void *p, int size){
- if(force_yuyv == 1){ //if this is enabled - convert from YUY2 to UYVY for NDI
-  yuy2Frame.data = (uint8_t*)p;
-  if(!converter.Convert(yuy2Frame,uyvyFrame)){ //convert the YUY2 frame into a UYVY frame - NDI doesn't accept a YUY2 frame
-   fprintf(stderr, "Convert failed\n");       
+  compositor.reset(new zs::Compositor(*workers));
+  if(!compositor->SetLayout(multiview_width, multiview_height, multiview_devices.size())){
+   fprintf(stderr, "Cannot lay out %zu inputs on a %dx%d canvas\n", multiview_devices.size(), multiview_width, multiview_height);
+   exit(EXIT_FAILURE);
   }
-  NDI_video_frame1.p_data = uyvyFrame.data; //link the UYVY frame data to the NDI frame
- }else{
-  NDI_video_frame1.p_data = (uint8_t*)p; //link the UYVY frame data to the NDI frame 
- }
- NDIlib_send_send_video_v2(pNDI_full_send, &NDI_video_frame1); //send the data out to NDI
-}
 
-static int read_frame(int &fd, enum v4l2_buf_type type, struct buffer *bufs, unsigned int n_buffs){ //this function reads the frame from the video capture device
-  auto buf = std::make_unique<v4l2_buffer>();
-  //CLEAR(buf);
-  buf->type = type;
-  buf->memory = V4L2_MEMORY_MMAP;
-  if (-1 == xioctl(fd, VIDIOC_DQBUF, buf.get())) { //dequeue the buffer - dumps data into the previously set mmap
-   switch (errno){
-    case EAGAIN:
-     return 0;
-    case EIO:
-     /* Could ignore EIO, see spec. */
-     /* fall through */
-    default:
-     errno_exit("VIDIOC_DQBUF");
-   }
-  }
-  assert(buf->index < n_buffs);
-  
-  if(NDIlib_send_get_no_connections(pNDI_full_send, 10000)){ //wait for a NDI receiver to be present before continuing - no need to encode without a client connected
-   printf("%x", buf->index & 0x0F);
-   fflush(stdout);
-   if(ndi_async == 1){
-    process_image_async(bufs[buf->index].start, buf->bytesused); //send the mmap frame buffer off to be processed
-   }else{
-    if(image_threaded == 1){
-      queue_push(std::move(buf));
-    }else{
-     process_image(bufs[buf->index].start, buf->bytesused); //send the mmap frame buffer off to be processed
+  for(size_t i = 0; i < multiview_devices.size(); i++){
+   std::unique_ptr<capture_input> in = open_input(multiview_devices[i], std::string(ndi_name) + " " + std::to_string(i + 1));
+
+   if(multiview_separate == 1){
+    NDIlib_send_create_t desc;
+    desc.p_ndi_name = in->dev.ndi_name.c_str();
+    in->dev.pNDI_full_send = NDIlib_send_create(&desc);
+    if (!in->dev.pNDI_full_send){
+     fprintf(stderr, "Failed to create NDI Send for %s", in->dev.device.c_str());
+     exit(1);
     }
+    NDIlib_video_frame_v2_t &frame = in->dev.NDI_video_frame1;
+    frame.xres = in->dev.m_width;
+    frame.yres = in->dev.m_height;
+    frame.line_stride_in_bytes = in->dev.m_stride;
+    frame.frame_rate_N = fps_N;
+    frame.frame_rate_D = fps_D;
+    frame.FourCC = NDIlib_FourCC_type_UYVY;
    }
+
+   in->dev.start_capturing();
+   mv_inputs.push_back(std::move(in));
+  }
+  signal(SIGINT, request_stop);
+  signal(SIGTERM, request_stop);
+
+  std::thread capture_thread(&multiview_capture_thread);
+  multiview_loop();
+  capture_thread.join();
+  NDIlib_send_destroy(multiview_send);
+  for(auto &in : mv_inputs){
+   in->dev.stop();
   }
+  return 0;
+}
 
-  if(image_threaded == 0){
-    if(-1 == xioctl(fd, VIDIOC_QBUF, buf.get())){
-   errno_exit("VIDIOC_QBUF");
+// Key and fill: combine the frames of two devices captured at the same time into UYVA
+static void keyfill_dequeue(capture_input &in, capture_input &other, capture_input &fill, capture_input &key){
+  bool starved = false;
+  std::unique_ptr<v4l2_buffer> buf = in.dev.dequeue_capture(starved);
+  if(!buf){
+    return;
+  }
+
+  // Frames are only combined right after they arrive, an older one is no longer needed
+  if(in.latest >= 0){
+    in.dev.requeue_capture(in.latest);
+  }
+  in.latest = buf->index;
+  in.timestamp = buf->timestamp.tv_sec + buf->timestamp.tv_usec / 1e6;
+  in.paired = false;
+  if(&in == &fill){ // A key is black or still whenever nothing is keyed, only the fill is judged by its picture
+    const int stride = fill.dev.m_stride ? fill.dev.m_stride : fill.dev.m_width * 2;
+    in.lost = fill.dev.signal_monitor->Update(fill.dev.capture_data(in.latest), fill.dev.m_width, fill.dev.m_height, stride,
+                                              fill.dev.yuyv ? 0 : 1, monotonic_seconds()) != zs::SignalState::Live;
+  }
+
+  // Pair with the other input if it captured within half a frame
+  const double tolerance = 0.5 * fps_D / fps_N;
+  if((other.latest < 0) || other.paired || fill.lost || (fabs(in.timestamp - other.timestamp) > tolerance)){
+    return;
   }
+  in.paired = other.paired = true;
+
+  if(!NDIlib_send_get_no_connections(fill.dev.pNDI_full_send, 0)){
+    return;
+  }
+
+  static std::shared_ptr<uint8_t> shown;       // Frame the NDI stack may still be reading
+  std::shared_ptr<uint8_t> uyva = frame_pool.Acquire((size_t)fill.dev.m_width * fill.dev.m_height * 3);
+  if(!uyva){
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
   }
-  return 1;
+  if(!alpha_packer->Pack(fill.dev.capture_data(fill.latest), fill.dev.m_stride, fill.dev.yuyv,
+                         key.dev.capture_data(key.latest), key.dev.m_stride, key.dev.yuyv,
+                         fill.dev.m_width, fill.dev.m_height, uyva.get())){
+    fprintf(stderr, "Key and fill combine failed\n");
+    return;
+  }
+
+  NDIlib_video_frame_v2_t frame;
+  frame.xres = fill.dev.m_width;
+  frame.yres = fill.dev.m_height;
+  frame.frame_rate_N = fps_N;
+  frame.frame_rate_D = fps_D;
+  frame.FourCC = NDIlib_FourCC_type_UYVA;
+  frame.line_stride_in_bytes = fill.dev.m_width * 2;
+  frame.p_data = uyva.get();
+  NDIlib_send_send_video_async_v2(fill.dev.pNDI_full_send, &frame);
+  // The send above released the previous frame back to the NDI stack, and so to the pool
+  shown = std::move(uyva);
+  fill.dev.frames_sent++;
+  fill.dev.report_stats();
+  key.dev.report_stats();
 }
 
-static int mainloop(void){
+static int run_keyfill(void){
+  apply_policy(rt_send, "send"); // NDI's threads inherit the scheduling of the thread that starts them
   if (!NDIlib_initialize()){	// Cannot run NDI. Most likely because the CPU is not sufficient (see SDK documentation).
    fprintf(stderr, "CPU cannot run NDI");
    return 0;
-  } 
-  //Full NDI     
+  }
+
+  alpha_packer.reset(new zs::AlphaPacker(*workers));
+  alpha_packer->SetLimitedRange(key_full_range == 0);
+
+  std::unique_ptr<capture_input> fill = open_input(dev_name, ndi_name);
+  std::unique_ptr<capture_input> key = open_input(key_dev_name, std::string(ndi_name) + " key");
+  if((fill->dev.m_width != key->dev.m_width) || (fill->dev.m_height != key->dev.m_height)){
+   fprintf(stderr, "Fill is %dx%d but key is %dx%d\n", fill->dev.m_width, fill->dev.m_height, key->dev.m_width, key->dev.m_height);
+   exit(EXIT_FAILURE);
+  }
+  // The fill device sends the combined frames
   NDI_send_create_desc.p_ndi_name = ndi_name;
-  pNDI_full_send = NDIlib_send_create(&NDI_send_create_desc); 
-  if (!pNDI_full_send){
+  fill->dev.pNDI_full_send = NDIlib_send_create(&NDI_send_create_desc);
+  if (!fill->dev.pNDI_full_send){
    fprintf(stderr, "Failed to create NDI Full Send");
    exit(1);
   }
-  yuy2Frame = zs::Frame(m_width,m_height, MAKE_FOURCC_CODE('Y','U','Y','2')); //initialize conversion frame storage - YUY2
-  uyvyFrame.fourcc = MAKE_FOURCC_CODE('U','Y','V','Y'); //initialize conversion frame storage - UYVY
-  NDI_video_frame1.xres = m_width;
-  NDI_video_frame1.yres = m_height;
-  NDI_video_frame1.frame_rate_N = fps_N;
-  NDI_video_frame1.frame_rate_D = fps_D;
-  NDI_video_frame1.FourCC = NDIlib_FourCC_type_UYVY; //set NDI to receive the type of frame that is going to be given to it - in this case UYVY
-  
-  if(ndi_async == 1){ //initialize frame2 for async
-   NDI_video_frame2.xres = m_width; 
-   NDI_video_frame2.yres = m_height;
-   NDI_video_frame2.frame_rate_N = fps_N;
-   NDI_video_frame2.frame_rate_D = fps_D;
-   NDI_video_frame2.FourCC = NDIlib_FourCC_type_UYVY; //set NDI to receive the type of frame that is going to be given to it - in this case UYVY
+  fill->dev.start_capturing();
+  key->dev.start_capturing();
+  signal(SIGINT, request_stop);
+  signal(SIGTERM, request_stop);
+  apply_policy(rt_capture, "capture");
+
+  while(!stop_requested){
+    fd_set fdset, events;
+    FD_ZERO(&fdset);
+    FD_SET(fill->dev.fd, &fdset);
+    FD_SET(key->dev.fd, &fdset);
+    FD_ZERO(&events);
+    FD_SET(fill->dev.fd, &events);
+    FD_SET(key->dev.fd, &events);
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000; // Often enough to pace the slate, no frames for a while is not fatal
+    int r = select(std::max(fill->dev.fd, key->dev.fd) + 1, &fdset, NULL, &events, &tv);
+    if(-1 == r){
+      if(EINTR == errno){
+        continue;
+      }
+      errno_exit("select");
+    }
+    if(r > 0){
+      if(FD_ISSET(fill->dev.fd, &events)){
+        fill->dev.dequeue_signal_events();
+      }
+      if(FD_ISSET(key->dev.fd, &events)){
+        key->dev.dequeue_signal_events();
+      }
+      if(FD_ISSET(fill->dev.fd, &fdset)){
+        keyfill_dequeue(*fill, *key, *fill, *key);
+      }
+      if(FD_ISSET(key->dev.fd, &fdset)){
+        keyfill_dequeue(*key, *fill, *fill, *key);
+      }
+    }
+    // Frames are only sent while both inputs are live, otherwise the fill's source carries the slate
+    const bool key_live = key->dev.service_signal() == zs::SignalState::Live;
+    fill->dev.service_signal(!key_live);
   }
+  fill->dev.stop();
+  key->dev.stop();
+  return 0;
+}
 
-  while(1){ //while loop for querying for new data from video capture device and reading new frames
-   for(;;){
-    struct timeval tv;
-    int r;
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-    r = is_readable(fd, &tv); //see when v4l2 video capture is ready
-    if (-1 == r) {
-     if (EINTR == errno){
-      continue;
-     }
-     errno_exit("select");
+// Devices of the streams mode (--streams), each captured into its own NDI sender
+std::vector<std::unique_ptr<capture_device>> streams;
+
+// Split a line of the streams file into words, "quoted words" may hold spaces, # starts a comment
+static std::vector<std::string> split_words(const char *line){
+  std::vector<std::string> words;
+  const char *p = line;
+  while(*p){
+   while(isspace((unsigned char)*p)){
+    p++;
+   }
+   if(!*p || (*p == '#')){
+    break;
+   }
+   std::string word;
+   if(*p == '"'){
+    for(p++; *p && (*p != '"'); p++){
+     word += *p;
     }
-    if(0 == r){
-     fprintf(stderr, "select timeout\n");
-     exit(EXIT_FAILURE);
+    if(*p == '"'){
+     p++;
+    }
+   }else{
+    for(; *p && !isspace((unsigned char)*p); p++){
+     word += *p;
     }
+   }
+   words.push_back(word);
+  }
+  return words;
+}
 
-    if(r == 1){
-     read_frame(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, buffers, n_buffers); //read new frame 
+// Read the streams file: per line a device, its NDI name and key=value options, e.g.
+//   /dev/video0 "Camera 1" format=yuyv width=1920 height=1080 fps=30000/1001
+// Options left out come from the command line.
+static void load_streams(const char *path){
+  FILE *file = fopen(path, "r");
+  if(!file){
+   fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+   exit(EXIT_FAILURE);
+  }
+  char line[1024];
+  int number = 0;
+  while(fgets(line, sizeof(line), file)){
+   number++;
+   std::vector<std::string> words = split_words(line);
+   if(words.empty()){
+    continue;
+   }
+   std::unique_ptr<capture_device> s(new capture_device());
+   s->device = words[0];
+   s->ndi_name = (words.size() > 1) ? words[1] : std::string(ndi_name) + " " + std::to_string(streams.size() + 1);
+   for(size_t i = 2; i < words.size(); i++){
+    const std::string &w = words[i];
+    const size_t eq = w.find('=');
+    const std::string key = w.substr(0, eq);
+    const char *value = (eq == std::string::npos) ? "" : w.c_str() + eq + 1;
+    bool ok = true;
+    if(key == "format"){
+     if(strcmp(value, "yuyv") == 0){
+      s->format = V4L2_PIX_FMT_YUYV;
+     }else if(strcmp(value, "uyvy") == 0){
+      s->format = V4L2_PIX_FMT_UYVY;
+     }else if(strcmp(value, "nv12") == 0){
+      s->format = V4L2_PIX_FMT_NV12;
+     }else if(strcmp(value, "i420") == 0){
+      s->format = V4L2_PIX_FMT_YUV420;
+     }else{
+      ok = false;
+     }
+    }else if(key == "width"){
+     s->width = atoi(value);
+    }else if(key == "height"){
+     s->height = atoi(value);
+    }else if(key == "fps"){
+     ok = (sscanf(value, "%f/%f", &s->fps_N, &s->fps_D) == 2) && (s->fps_N > 0) && (s->fps_D > 0);
+     s->fps_requested = true;
+    }else{
+     ok = false;
     }
-    /* EAGAIN - continue select loop. */
+    if(!ok){
+     fprintf(stderr, "%s:%d: cannot use '%s'\n", path, number, w.c_str());
+     exit(EXIT_FAILURE);
+    }
+   }
+   streams.push_back(std::move(s));
+  }
+  fclose(file);
+  if(streams.empty()){
+   fprintf(stderr, "%s lists no devices\n", path);
+   exit(EXIT_FAILURE);
   }
- }
 }
 
-static void stop_capturing(int fd){
-  enum v4l2_buf_type type;
-  type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  if (-1 == xioctl(fd, VIDIOC_STREAMOFF, &type)){
-   errno_exit("VIDIOC_STREAMOFF");
+// Between reactor waits: keep the slates of lost inputs going and report, skipping a
+// device another reactor thread is serving right now
+static void service_streams(zs::EpollReactor &reactor){
+  for(auto &s : streams){
+   std::unique_lock<std::mutex> lock(s->serving, std::try_to_lock);
+   if(lock.owns_lock()){
+    s->service_signal();
+    s->report_stats();
+   }
+  }
+  if(stop_requested){
+   reactor.Stop();
   }
 }
 
+// Capture every device of the streams file in this process, each through the whole pipeline:
+// one NDI instance, buffer pool and worker pool, and reactor threads that each serve any ready device
+static int run_streams(void){
+  load_streams(streams_file);
+  apply_policy(rt_send, "send"); // NDI's threads inherit the scheduling of the thread that starts them
+  if (!NDIlib_initialize()){	// Cannot run NDI. Most likely because the CPU is not sufficient (see SDK documentation).
+   fprintf(stderr, "CPU cannot run NDI");
+   return 0;
+  }
 
-static void uninit_device(void){
-  unsigned int i;
-  for (i = 0; i < n_buffers; ++i){
-   if (-1 == munmap(buffers[i].start, buffers[i].length)){
-    errno_exit("munmap");
+  zs::EpollReactor reactor;
+  if(!reactor.Open()){
+   errno_exit("epoll_create1");
+  }
+  for(auto &s : streams){
+   capture_device *device = s.get();
+   device->open_capture(false);
+   device->init_stages();
+   device->open_senders(true); // Paced by the capture, so a sender never blocks the reactor thread it is called on
+   device->start();
+   fprintf(stderr, "%s: %dx%d %s as \"%s\"\n", device->device.c_str(), device->m_width, device->m_height, fourcc(device->m_format).c_str(), device->ndi_name.c_str());
+   if(!reactor.Add(device->fd, EPOLLIN | EPOLLPRI, [device](uint32_t events){
+     std::lock_guard<std::mutex> lock(device->serving);
+     device->wakeup(events & EPOLLIN, events & EPOLLPRI);
+   })){
+    errno_exit("epoll_ctl");
    }
   }
-  free(buffers);
+  signal(SIGINT, request_stop);
+  signal(SIGTERM, request_stop);
+
+  std::vector<std::thread> threads;
+  for(int i = 1; i < reactor_threads; i++){
+   threads.push_back(std::thread([&reactor](){
+    apply_policy(rt_capture, "capture");
+    reactor.Run();
+   }));
+  }
+  apply_policy(rt_capture, "capture");
+  reactor.Run(100, [&reactor](){ service_streams(reactor); }); // Often enough to pace the slates
+  for(auto &t : threads){
+   t.join();
+  }
+  for(auto &s : streams){
+   s->stop();
+  }
+  return 0;
 }
 
-
-static void close_device(void){
+void capture_device::close_device(void){
   if(-1 == close(fd)){
    errno_exit("close");
   }
@@ -606,19 +3552,126 @@ static void usage(FILE *fp, int argc, char **argv){
                  "-h | --help          Print this message\n"
                  "-f | --yuyv          Force pixel format to YUYV\n"
                  "-u | --uyvy          Force pixel format to UYVY\n"
+                 "--nv12               Force pixel format to NV12 (4:2:0, sent to NDI as it is when nothing processes it)\n"
+                 "--i420               Force pixel format to YUV420 (I420)\n"
                  "-x | --width         Width of Stream (in pixels)\n"
                  "-y | --height        Height of Stream (in pixels)\n"
-                 "-n | --numerator     Set FPS (Frames-per-second) Numerator (default is 30000)\n"
-                 "-e | --denominator   Set FPS (Frames-per-second) Denominator (default is 1001)\n"
+                 "-n | --numerator     Set FPS (Frames-per-second) Numerator, asked of the device (default is its current rate, or 30000)\n"
+                 "-e | --denominator   Set FPS (Frames-per-second) Denominator (default is its current rate, or 1001)\n"
                  "-i | --threaded      Set threading to be enabled for image processing\n"
                  "-a | --async         Set async to be enabled for NDI stream (default is disabled)\n"
                  "-v | --video name    Set name of NDI stream (default is Stream)\n"
+                 "--dmabuf             Capture into application owned udmabuf buffers (V4L2_MEMORY_DMABUF)\n"
+                 "--userptr            Capture into application owned, cached buffers (V4L2_MEMORY_USERPTR)\n"
+                 "--dmabuf-export      Export the capture buffers as DMABUF (VIDIOC_EXPBUF)\n"
+                 "--dmabuf-socket path Hand every capture buffer to local processes on this Unix socket\n"
+                 "--buffers n          Capture buffers to start with (default 8), more are added when frames are lost\n"
+                 "--buffer-budget MB   Memory the capture buffers may use (default is no limit)\n"
+                 "--streams file       Capture every device listed in file, each into its own NDI source\n"
+                 "--reactor-threads n  Threads serving the devices of --streams (default 1)\n"
+                 "--latest             Send only the newest of the frames ready at a wakeup\n"
+                 "--busy-poll cpu      Poll the capture from this core instead of waiting in select\n"
+                 "--rt-capture spec    SCHED_FIFO priority and cores of the capture threads as prio[@cpus],\n"
+                 "                     prio 0 keeps normal scheduling, e.g. 80@2 or 0@2-3\n"
+                 "--rt-convert spec    Same for the image thread and the conversion workers\n"
+                 "--rt-send spec       Same for the NDI send threads\n"
+                 "                     Stages without @cpus are placed on isolcpus/nohz_full cores if there are any\n"
+                 "--mlock              Lock the process in memory and prefault the capture buffers\n"
+                 "--threads count      Threads used by processing stages (default is one per CPU)\n"
+                 "--deinterlace mode   Deinterlace interlaced captures: bob, blend or motion\n"
+                 "                     (bob sends one frame per field at twice the frame rate)\n"
+                 "--denoise strength   Temporal noise reduction, weight of the previous frame in 1/16 (1-15)\n"
+                 "--denoise-threshold  Difference treated as motion by the denoiser (default is 10)\n"
+                 "--dedupe             Skip frames that repeat the previous one (pulldown, frozen sources)\n"
+                 "--idle-fps rate      Lower the rate of static scenes to this (e.g. 5)\n"
+                 "--idle-after seconds Time without motion before the rate drops (default is 2)\n"
+                 "--idle-threshold n   Mean luma change treated as motion (default is 1)\n"
+                 "--slate file         Raw RGB24 image of the sent size shown without signal (default is bars)\n"
+                 "--slate-fps rate     Rate the slate is sent at (default is 5)\n"
+                 "--black-after sec    Treat a black input as lost after this time (default is never)\n"
+                 "--frozen-after sec   Treat an unchanging input as lost after this time (default is never)\n"
+                 "--stats seconds      Interval of statistics reports, 0 disables them (default is 10)\n"
+                 "--crop WxH+X+Y       Send only this rectangle of the capture\n"
+                 "--lut file.cube      Apply a 3D LUT (tetrahedral interpolation)\n"
+                 "--lut-matrix 601|709 YCbCr matrix of the capture (default is 709 from 720 lines up)\n"
+                 "--blur WxH+X+Y       Blur this rectangle (privacy mask), may be repeated\n"
+                 "--blur-radius pixels Radius of the blur (1-127, default is 24)\n"
+                 "--rotate degrees     Rotate clockwise by 90, 180 or 270 degrees\n"
+                 "--lens fx,fy,cx,cy,k1,k2[,p1,p2[,k3]]\n"
+                 "                     Correct lens distortion (OpenCV calibration, in pixels of the sent frame)\n"
+                 "--lens-zoom factor   Magnify the corrected picture to hide the borders (default is 1)\n"
+                 "--key device         Capture the key from this device and send -d (the fill) with alpha\n"
+                 "--key-range range    Key luma range: limited (16-235, default) or full\n"
+                 "--multiview devices  Composite a comma separated list of devices into one grid stream\n"
+                 "--multiview-size WxH Size of the multiview canvas (default is 1920x1080)\n"
+                 "--multiview-separate Also send every multiview input as its own stream\n"
+                 "--proxy WxH          Also send a low resolution proxy stream (e.g. 640x360)\n"
+                 "--proxy-fps rate     Frame rate of the proxy (default is the full rate)\n"
+                 "--proxy-filter name  Proxy scaling filter: box or bilinear (default is box)\n"
+                 "--proxy-name name    Name of the proxy NDI stream (default is \"<name> Proxy\")\n"
+                 "--hflip              Mirror horizontally (before rotating)\n"
+                 "--vflip              Flip vertically (before rotating)\n"
+                 "--fields mode        Send interlaced captures as NDI fields without deinterlacing:\n"
+                 "                     interleaved (one fielded frame) or separate (one frame per field)\n"
                  "",
                  argv[0], dev_name);
 }
 
 static const char short_options[] = "d:hfux:y:n:e:iav:";
 
+// Options without a short form
+enum long_only_options {
+        OPT_THREADS = 256,
+        OPT_DEINTERLACE,
+        OPT_FIELDS,
+        OPT_DENOISE,
+        OPT_DENOISE_THRESHOLD,
+        OPT_STATS,
+        OPT_ROTATE,
+        OPT_HFLIP,
+        OPT_VFLIP,
+        OPT_CROP,
+        OPT_PROXY,
+        OPT_PROXY_FPS,
+        OPT_PROXY_FILTER,
+        OPT_PROXY_NAME,
+        OPT_MULTIVIEW,
+        OPT_MULTIVIEW_SIZE,
+        OPT_MULTIVIEW_SEPARATE,
+        OPT_KEY,
+        OPT_KEY_RANGE,
+        OPT_LUT,
+        OPT_LUT_MATRIX,
+        OPT_LENS,
+        OPT_LENS_ZOOM,
+        OPT_DEDUPE,
+        OPT_IDLE_FPS,
+        OPT_IDLE_AFTER,
+        OPT_IDLE_THRESHOLD,
+        OPT_SLATE,
+        OPT_BLUR,
+        OPT_DMABUF,
+        OPT_DMABUF_EXPORT,
+        OPT_USERPTR,
+        OPT_DMABUF_SOCKET,
+        OPT_BLUR_RADIUS,
+        OPT_SLATE_FPS,
+        OPT_BLACK_AFTER,
+        OPT_FROZEN_AFTER,
+        OPT_BUFFERS,
+        OPT_BUFFER_BUDGET,
+        OPT_NV12,
+        OPT_I420,
+        OPT_STREAMS,
+        OPT_REACTOR_THREADS,
+        OPT_LATEST,
+        OPT_BUSY_POLL,
+        OPT_RT_CAPTURE,
+        OPT_RT_CONVERT,
+        OPT_RT_SEND,
+        OPT_MLOCK,
+};
+
 static const struct option
 long_options[] = {
         { "device", required_argument, NULL, 'd' },
@@ -632,12 +3685,62 @@ long_options[] = {
         { "threaded", no_argument,       NULL, 'i' },
         { "async", no_argument,       NULL, 'a' },
         { "video", required_argument,  NULL, 'v' },
+        { "threads", required_argument,  NULL, OPT_THREADS },
+        { "deinterlace", required_argument,  NULL, OPT_DEINTERLACE },
+        { "fields", required_argument,  NULL, OPT_FIELDS },
+        { "denoise", required_argument,  NULL, OPT_DENOISE },
+        { "denoise-threshold", required_argument,  NULL, OPT_DENOISE_THRESHOLD },
+        { "stats", required_argument,  NULL, OPT_STATS },
+        { "rotate", required_argument,  NULL, OPT_ROTATE },
+        { "hflip", no_argument,  NULL, OPT_HFLIP },
+        { "vflip", no_argument,  NULL, OPT_VFLIP },
+        { "crop", required_argument,  NULL, OPT_CROP },
+        { "proxy", required_argument,  NULL, OPT_PROXY },
+        { "proxy-fps", required_argument,  NULL, OPT_PROXY_FPS },
+        { "proxy-filter", required_argument,  NULL, OPT_PROXY_FILTER },
+        { "proxy-name", required_argument,  NULL, OPT_PROXY_NAME },
+        { "multiview", required_argument,  NULL, OPT_MULTIVIEW },
+        { "multiview-size", required_argument,  NULL, OPT_MULTIVIEW_SIZE },
+        { "multiview-separate", no_argument,  NULL, OPT_MULTIVIEW_SEPARATE },
+        { "key", required_argument,  NULL, OPT_KEY },
+        { "key-range", required_argument,  NULL, OPT_KEY_RANGE },
+        { "lut", required_argument,  NULL, OPT_LUT },
+        { "lut-matrix", required_argument,  NULL, OPT_LUT_MATRIX },
+        { "lens", required_argument,  NULL, OPT_LENS },
+        { "lens-zoom", required_argument,  NULL, OPT_LENS_ZOOM },
+        { "dedupe", no_argument,  NULL, OPT_DEDUPE },
+        { "idle-fps", required_argument,  NULL, OPT_IDLE_FPS },
+        { "idle-after", required_argument,  NULL, OPT_IDLE_AFTER },
+        { "idle-threshold", required_argument,  NULL, OPT_IDLE_THRESHOLD },
+        { "slate", required_argument,  NULL, OPT_SLATE },
+        { "blur", required_argument,  NULL, OPT_BLUR },
+        { "dmabuf", no_argument,  NULL, OPT_DMABUF },
+        { "dmabuf-export", no_argument,  NULL, OPT_DMABUF_EXPORT },
+        { "userptr", no_argument,  NULL, OPT_USERPTR },
+        { "dmabuf-socket", required_argument,  NULL, OPT_DMABUF_SOCKET },
+        { "blur-radius", required_argument,  NULL, OPT_BLUR_RADIUS },
+        { "slate-fps", required_argument,  NULL, OPT_SLATE_FPS },
+        { "black-after", required_argument,  NULL, OPT_BLACK_AFTER },
+        { "frozen-after", required_argument,  NULL, OPT_FROZEN_AFTER },
+        { "buffers", required_argument,  NULL, OPT_BUFFERS },
+        { "buffer-budget", required_argument,  NULL, OPT_BUFFER_BUDGET },
+        { "nv12", no_argument,  NULL, OPT_NV12 },
+        { "i420", no_argument,  NULL, OPT_I420 },
+        { "streams", required_argument,  NULL, OPT_STREAMS },
+        { "reactor-threads", required_argument,  NULL, OPT_REACTOR_THREADS },
+        { "latest",          no_argument,        NULL, OPT_LATEST },
+        { "busy-poll",       required_argument,  NULL, OPT_BUSY_POLL },
+        { "rt-capture",      required_argument,  NULL, OPT_RT_CAPTURE },
+        { "rt-convert",      required_argument,  NULL, OPT_RT_CONVERT },
+        { "rt-send",         required_argument,  NULL, OPT_RT_SEND },
+        { "mlock",           no_argument,        NULL, OPT_MLOCK },
         { 0, 0, 0, 0 }
 };
 
 int main(int argc, char **argv){
   dev_name = (char*)"/dev/video0"; //default v4l2 device path
   ndi_name = (char*)"Stream"; //default NDI stream name
+  sched_getaffinity(0, sizeof(startup_cpus), &startup_cpus);
   for (;;) {
    int idx;
    int c;
@@ -666,9 +3769,11 @@ int main(int argc, char **argv){
      break; 
     case 'n':
      fps_N = atof(optarg);
+     fps_requested = true;
      break;
     case 'e':
      fps_D = atof(optarg);
+     fps_requested = true;
      break;   
     case 'i':
      image_threaded = 1;
@@ -679,37 +3784,302 @@ int main(int argc, char **argv){
     case 'v':
      ndi_name = optarg;
      break;              
+    case OPT_THREADS:
+     worker_threads = atoi(optarg);
+     break;
+    case OPT_DEINTERLACE:
+     deinterlace = 1;
+     if(strcmp(optarg, "bob") == 0){
+      deinterlace_mode = zs::DeinterlaceMode::Bob;
+     }else if(strcmp(optarg, "blend") == 0){
+      deinterlace_mode = zs::DeinterlaceMode::Blend;
+     }else if(strcmp(optarg, "motion") == 0){
+      deinterlace_mode = zs::DeinterlaceMode::MotionAdaptive;
+     }else{
+      fprintf(stderr, "Unknown deinterlace mode: %s\n", optarg);
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_FIELDS:
+     if(strcmp(optarg, "interleaved") == 0){
+      field_mode = FIELDS_INTERLEAVED;
+     }else if(strcmp(optarg, "separate") == 0){
+      field_mode = FIELDS_SEPARATE;
+     }else{
+      fprintf(stderr, "Unknown field mode: %s\n", optarg);
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_DENOISE:
+     denoise_strength = atoi(optarg);
+     if((denoise_strength < 1) || (denoise_strength > 15)){
+      fprintf(stderr, "Denoise strength must be 1-15\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_DENOISE_THRESHOLD:
+     denoise_threshold = atoi(optarg);
+     if((denoise_threshold < 0) || (denoise_threshold > 255)){
+      fprintf(stderr, "Denoise threshold must be 0-255\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_STATS:
+     stats_interval = atoi(optarg);
+     break;
+    case OPT_ROTATE:
+     rotation = atoi(optarg);
+     if((rotation != 0) && (rotation != 90) && (rotation != 180) && (rotation != 270)){
+      fprintf(stderr, "Rotation must be 0, 90, 180 or 270\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_HFLIP:
+     hflip = 1;
+     break;
+    case OPT_VFLIP:
+     vflip = 1;
+     break;
+    case OPT_CROP:
+     CLEAR(crop_rect);
+     if((sscanf(optarg, "%ux%u+%d+%d", &crop_rect.width, &crop_rect.height, &crop_rect.left, &crop_rect.top) != 4)
+        || (crop_rect.left < 0) || (crop_rect.top < 0)){
+      fprintf(stderr, "Crop must be given as WxH+X+Y, with X and Y not negative\n");
+      exit(EXIT_FAILURE);
+     }
+     crop = 1;
+     break;
+    case OPT_PROXY:
+     if((sscanf(optarg, "%dx%d", &proxy_width, &proxy_height) != 2) || (proxy_width < 4) || (proxy_height < 4)){
+      fprintf(stderr, "Proxy size must be given as WxH\n");
+      exit(EXIT_FAILURE);
+     }
+     proxy = 1;
+     break;
+    case OPT_PROXY_FPS:
+     proxy_fps = atof(optarg);
+     break;
+    case OPT_PROXY_FILTER:
+     if(strcmp(optarg, "box") == 0){
+      proxy_filter = zs::ScaleFilter::Box;
+     }else if(strcmp(optarg, "bilinear") == 0){
+      proxy_filter = zs::ScaleFilter::Bilinear;
+     }else{
+      fprintf(stderr, "Unknown proxy filter: %s\n", optarg);
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_PROXY_NAME:
+     proxy_name = optarg;
+     break;
+    case OPT_MULTIVIEW:
+     for(char *dev = strtok(optarg, ","); dev != NULL; dev = strtok(NULL, ",")){
+      multiview_devices.push_back(dev);
+     }
+     break;
+    case OPT_MULTIVIEW_SIZE:
+     if(sscanf(optarg, "%dx%d", &multiview_width, &multiview_height) != 2){
+      fprintf(stderr, "Multiview size must be given as WxH\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_MULTIVIEW_SEPARATE:
+     multiview_separate = 1;
+     break;
+    case OPT_KEY:
+     key_dev_name = optarg;
+     break;
+    case OPT_LUT:
+     lut_file = optarg;
+     break;
+    case OPT_LUT_MATRIX:
+     lut_matrix = atoi(optarg);
+     if((lut_matrix != 601) && (lut_matrix != 709)){
+      fprintf(stderr, "LUT matrix must be 601 or 709\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_LENS:{
+     zs::LensParameters &p = lens_parameters;
+     const int n = sscanf(optarg, "%f,%f,%f,%f,%f,%f,%f,%f,%f", &p.fx, &p.fy, &p.cx, &p.cy, &p.k1, &p.k2, &p.p1, &p.p2, &p.k3);
+     if((n < 6) || (p.fx <= 0) || (p.fy <= 0)){
+      fprintf(stderr, "Lens must be given as fx,fy,cx,cy,k1,k2[,p1,p2[,k3]]\n");
+      exit(EXIT_FAILURE);
+     }
+     lens_correct = 1;
+     break;
+    }
+    case OPT_LENS_ZOOM:
+     lens_parameters.zoom = atof(optarg);
+     break;
+    case OPT_DEDUPE:
+     dedupe = 1;
+     break;
+    case OPT_IDLE_FPS:
+     idle_fps = atof(optarg);
+     break;
+    case OPT_IDLE_AFTER:
+     idle_after = atof(optarg);
+     break;
+    case OPT_IDLE_THRESHOLD:
+     idle_threshold = atof(optarg);
+     break;
+    case OPT_DMABUF:
+     io = IO_METHOD_DMABUF;
+     break;
+    case OPT_USERPTR:
+     io = IO_METHOD_USERPTR;
+     break;
+    case OPT_DMABUF_EXPORT:
+     dmabuf_export = 1;
+     break;
+    case OPT_DMABUF_SOCKET:
+     dmabuf_socket = optarg;
+     break;
+    case OPT_BLUR:{
+     zs::BlurRegion region;
+     if(sscanf(optarg, "%ux%u+%u+%u", &region.width, &region.height, &region.x, &region.y) != 4){
+      fprintf(stderr, "Blur region must be given as WxH+X+Y\n");
+      exit(EXIT_FAILURE);
+     }
+     blur_regions.push_back(region);
+     break;
+    }
+    case OPT_BLUR_RADIUS:
+     blur_radius = atoi(optarg);
+     break;
+    case OPT_SLATE:
+     slate_file = optarg;
+     break;
+    case OPT_SLATE_FPS:
+     slate_fps = atof(optarg);
+     if(slate_fps <= 0){
+      fprintf(stderr, "Slate rate must be positive\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_BLACK_AFTER:
+     black_after = atof(optarg);
+     break;
+    case OPT_FROZEN_AFTER:
+     frozen_after = atof(optarg);
+     break;
+    case OPT_BUFFERS:
+     buffer_count = atoi(optarg);
+     if((buffer_count < 2) || (buffer_count > VIDEO_MAX_FRAME)){
+      fprintf(stderr, "Buffer count must be 2 to %d\n", VIDEO_MAX_FRAME);
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_BUFFER_BUDGET:
+     buffer_budget = atoi(optarg);
+     break;
+    case OPT_NV12:
+     force_nv12 = 1;
+     break;
+    case OPT_I420:
+     force_i420 = 1;
+     break;
+    case OPT_STREAMS:
+     streams_file = optarg;
+     break;
+    case OPT_REACTOR_THREADS:
+     reactor_threads = atoi(optarg);
+     if(reactor_threads < 1){
+      fprintf(stderr, "Reactor threads must be at least 1\n");
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_LATEST:
+     latest_only = 1;
+     m_max_depth = 1; // The image thread keeps only the newest frame too
+     break;
+    case OPT_BUSY_POLL:
+     busy_poll_cpu = atoi(optarg);
+     if((busy_poll_cpu < 0) || (busy_poll_cpu >= CPU_SETSIZE)){
+      fprintf(stderr, "Busy-poll CPU must be between 0 and %d\n", CPU_SETSIZE - 1);
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_RT_CAPTURE:
+    case OPT_RT_CONVERT:
+    case OPT_RT_SEND:
+     if(!parse_policy(optarg, c == OPT_RT_CAPTURE ? rt_capture : c == OPT_RT_CONVERT ? rt_convert : rt_send)){
+      fprintf(stderr, "Bad thread policy %s, expected priority[@cpus] with a priority from 0 to %d\n", optarg, sched_get_priority_max(SCHED_FIFO));
+      exit(EXIT_FAILURE);
+     }
+     break;
+    case OPT_MLOCK:
+     memory_lock = 1;
+     break;
+    case OPT_KEY_RANGE:
+     if(strcmp(optarg, "limited") == 0){
+      key_full_range = 0;
+     }else if(strcmp(optarg, "full") == 0){
+      key_full_range = 1;
+     }else{
+      fprintf(stderr, "Unknown key range: %s\n", optarg);
+      exit(EXIT_FAILURE);
+     }
+     break;
     default:
      usage(stderr, argc, argv);
      exit(EXIT_FAILURE);
    }
   }
-  open_device(dev_name, fd); //open v4l2 device
-  if(force_uyvy == 1){
-   init_device(dev_name, fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, V4L2_PIX_FMT_UYVY, width, height); //init v4l2 device
+  if((deinterlace == 1) && (field_mode != FIELDS_OFF)){
+   fprintf(stderr, "--deinterlace and --fields cannot be used together\n");
+   exit(EXIT_FAILURE);
   }
-  if(force_yuyv == 1){
-   init_device(dev_name, fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, V4L2_PIX_FMT_YUYV, width, height); //init v4l2 device 
+  if((io != IO_METHOD_MMAP) && (!multiview_devices.empty() || (key_dev_name != NULL))){
+   fprintf(stderr, "Multiview and key/fill capture use MMAP buffers only\n");
+   exit(EXIT_FAILURE);
   }
-  init_mmap(dev_name,fd,V4L2_BUF_TYPE_VIDEO_CAPTURE,&buffers,&n_buffers);
-
-  if (image_threaded == 1){
-    image_thread = std::thread(&process_image_thread);
+  if((streams_file != NULL) && (!multiview_devices.empty() || (key_dev_name != NULL))){
+   fprintf(stderr, "--streams cannot be combined with multiview or key/fill\n");
+   exit(EXIT_FAILURE);
   }
-
-  start_capturing(dev_name, fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, n_buffers);
-  mainloop();
-  stop_capturing(fd);
-
-  if (image_threaded == 1){
-    // Signal the image thread to exit by sending an empty message
-    auto nullmsg = std::make_unique<v4l2_buffer>();
-    queue_push(std::move(nullmsg));
-    image_thread.join();
+  if(((streams_file != NULL) || !multiview_devices.empty() || (key_dev_name != NULL)) && ((dmabuf_socket != NULL) || (busy_poll_cpu >= 0))){ // One socket and one polling core serve one device
+   fprintf(stderr, "--dmabuf-socket and --busy-poll serve a single device, they cannot be combined with --streams, multiview or key/fill\n");
+   exit(EXIT_FAILURE);
   }
-
-  uninit_device();
-  close_device();
-  fprintf(stderr, "\n");
-  return 0;
-}
\ No newline at end of file
+  if(force_yuyv + force_uyvy + force_nv12 + force_i420 > 1){ // The converters assume the one format that was asked for
+   fprintf(stderr, "Only one of -f, -u, --nv12 and --i420 can be given\n");
+   exit(EXIT_FAILURE);
+  }
+  if((io == IO_METHOD_USERPTR) && ((dmabuf_export == 1) || (dmabuf_socket != NULL))){ // User pointers have no DMABUF to hand out
+   fprintf(stderr, "--dmabuf-export and --dmabuf-socket cannot be combined with --userptr\n");
+   exit(EXIT_FAILURE);
+  }
+  if((dmabuf_socket != NULL) && ((force_yuyv == 1) || (lut_file != NULL) || !blur_regions.empty() || (denoise_strength > 0))){ // These rewrite the capture buffer in place
+   fprintf(stderr, "--dmabuf-socket shares the unprocessed capture, it cannot be combined with -f, --lut, --blur or --denoise\n");
+   exit(EXIT_FAILURE);
+  }
+  if(rt_capture.set || rt_convert.set || rt_send.set){
+   place_stages();
+  }
+  if(rt_convert.pinned && (worker_threads == 0)){ // A thread per conversion core rather than per CPU of the box
+   worker_threads = CPU_COUNT(&rt_convert.cpus);
+  }
+  if(memory_lock == 1){
+   lock_memory();
+  }
+  workers.reset(new zs::StripeWorkers(worker_threads, &convert_thread_start)); // Every stage of every device shares them
+  if(streams_file != NULL){
+   return run_streams();
+  }
+  if(!multiview_devices.empty()){
+   return run_multiview();
+  }
+  if(key_dev_name != NULL){
+   return run_keyfill();
+  }
+  std::unique_ptr<capture_device> dev(new capture_device());
+  dev->device = dev_name;
+  dev->ndi_name = ndi_name;
+  dev->open_capture(false); //open v4l2 device
+  dev->init_stages();
+  signal(SIGINT, request_stop);
+  signal(SIGTERM, request_stop);
+  return mainloop(*dev);
+}
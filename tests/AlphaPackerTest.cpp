@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <vector>
+#include "TestCheck.h"
+#include "AlphaPacker.h"
+
+
+// 20 pixels per row: one 16 pixel vector step and a scalar tail of 4
+#define WIDTH 20
+#define HEIGHT 2
+#define ROW_BYTES (WIDTH * 2)
+
+
+// Key luma cycles through these, with the limited range alpha worked out by hand:
+// black and below clamp to 0, 235 and above to 255, (126 - 16) * 255 / 219 rounds to 128
+static const uint8_t KEY_LUMA[] = { 0, 16, 17, 126, 235, 240 };
+static const uint8_t LIMITED_ALPHA[] = { 0, 0, 1, 128, 255, 255 };
+#define KEY_STEPS (sizeof(KEY_LUMA) / sizeof(KEY_LUMA[0]))
+
+
+/// Fill frame numbering its bytes
+static std::vector<uint8_t> FillFrame(uint32_t stride) {
+
+	std::vector<uint8_t> fill(stride * HEIGHT, 0);
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t i = 0; i < ROW_BYTES; i++)
+			fill[y * stride + i] = (uint8_t)(y * ROW_BYTES + i);
+	return fill;
+
+}
+
+
+/// Key frame with chroma 99 and the key luma cycle, in UYVY or YUY2 byte order
+static std::vector<uint8_t> KeyFrame(bool yuy2) {
+
+	std::vector<uint8_t> key(ROW_BYTES * HEIGHT, 99);
+	for (uint32_t p = 0; p < WIDTH * HEIGHT; p++)
+		key[p * 2 + (yuy2 ? 0 : 1)] = KEY_LUMA[p % KEY_STEPS];
+	return key;
+
+}
+
+
+static void TestUYVY(zs::AlphaPacker& packer) {
+
+	std::vector<uint8_t> fill = FillFrame(ROW_BYTES), key = KeyFrame(false);
+	std::vector<uint8_t> dst(WIDTH * HEIGHT * 3);
+
+	// The UYVY plane is the fill, the alpha plane follows it
+	packer.SetLimitedRange(true);
+	CHECK(packer.Pack(fill.data(), 0, false, key.data(), 0, false, WIDTH, HEIGHT, dst.data()));
+	CHECK(std::equal(fill.begin(), fill.end(), dst.begin()));
+	for (uint32_t p = 0; p < WIDTH * HEIGHT; p++)
+		CHECK(dst[ROW_BYTES * HEIGHT + p] == LIMITED_ALPHA[p % KEY_STEPS]);
+
+	// Full range passes the key luma through
+	packer.SetLimitedRange(false);
+	CHECK(packer.Pack(fill.data(), 0, false, key.data(), 0, false, WIDTH, HEIGHT, dst.data()));
+	for (uint32_t p = 0; p < WIDTH * HEIGHT; p++)
+		CHECK(dst[ROW_BYTES * HEIGHT + p] == KEY_LUMA[p % KEY_STEPS]);
+
+}
+
+
+static void TestYUY2(zs::AlphaPacker& packer) {
+
+	// A padded YUY2 fill is swapped to UYVY byte order, a YUY2 key gives the same alpha
+	const uint32_t stride = ROW_BYTES + 8;
+	std::vector<uint8_t> fill = FillFrame(stride), key = KeyFrame(true);
+	std::vector<uint8_t> dst(WIDTH * HEIGHT * 3);
+
+	packer.SetLimitedRange(true);
+	CHECK(packer.Pack(fill.data(), stride, true, key.data(), 0, true, WIDTH, HEIGHT, dst.data()));
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t i = 0; i < ROW_BYTES; i++)
+			CHECK(dst[y * ROW_BYTES + i] == fill[y * stride + (i ^ 1)]);
+	for (uint32_t p = 0; p < WIDTH * HEIGHT; p++)
+		CHECK(dst[ROW_BYTES * HEIGHT + p] == LIMITED_ALPHA[p % KEY_STEPS]);
+
+}
+
+
+static void TestInvalid(zs::AlphaPacker& packer) {
+
+	std::vector<uint8_t> fill = FillFrame(ROW_BYTES), key = KeyFrame(false);
+	std::vector<uint8_t> dst(WIDTH * HEIGHT * 3);
+	CHECK(!packer.Pack(fill.data(), 0, false, key.data(), 0, false, WIDTH - 1, HEIGHT, dst.data()));
+	CHECK(!packer.Pack(fill.data(), 0, false, nullptr, 0, false, WIDTH, HEIGHT, dst.data()));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::AlphaPacker packer(workers);
+
+	TestUYVY(packer);
+	TestYUY2(packer);
+	TestInvalid(packer);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,141 @@
+#include <cstring>
+#include <string>
+#include <vector>
+#include "TestCheck.h"
+#include "CadenceDetector.h"
+
+
+// 40 bytes per row: one 32 byte vector step and 8 bytes of tail, padded to a stride of 48
+#define ROW_BYTES 40
+#define STRIDE 48
+#define HEIGHT 16
+
+
+/// Frame of one picture, every byte set to the picture number
+static std::vector<uint8_t> Picture(uint8_t number) {
+
+	return std::vector<uint8_t>(STRIDE * HEIGHT, number);
+
+}
+
+
+/// Feed pictures shown repeat[i % count] times each, return the repeat flags as a string
+static std::string Feed(zs::CadenceDetector& detector, const uint32_t* repeat, uint32_t count, uint32_t frames,
+	std::vector<zs::Cadence>* cadences = nullptr) {
+
+	std::string flags;
+	uint8_t number = 0;
+	uint32_t left = 0, group = 0;
+	for (uint32_t i = 0; i < frames; i++) {
+		if (left == 0) {
+			number++;
+			left = repeat[group++ % count];
+		}
+		left--;
+		std::vector<uint8_t> frame = Picture(number);
+		flags += detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE) ? 'R' : 'N';
+		if (cadences != nullptr)
+			cadences->push_back(detector.GetCadence());
+	}
+	return flags;
+
+}
+
+
+static void TestPulldown32(zs::CadenceDetector& detector) {
+
+	// 24p in 60p: pictures shown 2, 3, 2, 3 times
+	const uint32_t repeat[] = { 2, 3 };
+	std::vector<zs::Cadence> cadences;
+	CHECK(Feed(detector, repeat, 2, 20, &cadences) == "NRNRRNRNRRNRNRRNRNRR");
+
+	// Two full periods are needed to lock, then every phase of the pattern keeps it
+	for (uint32_t i = 0; i < 9; i++)
+		CHECK(cadences[i] == zs::Cadence::None);
+	for (uint32_t i = 9; i < 20; i++)
+		CHECK(cadences[i] == zs::Cadence::Pulldown32);
+	CHECK(detector.GetRepeatCount() == 12);
+
+	// A picture shown once breaks the pattern
+	std::vector<uint8_t> frame = Picture(200);
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+	frame = Picture(201);
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+	CHECK(detector.GetCadence() == zs::Cadence::None);
+
+}
+
+
+static void TestOtherCadences(zs::CadenceDetector& detector) {
+
+	// 30p in 60p
+	detector.Reset();
+	const uint32_t twice[] = { 2 };
+	std::vector<zs::Cadence> cadences;
+	CHECK(Feed(detector, twice, 1, 12, &cadences) == "NRNRNRNRNRNR");
+	CHECK(cadences[8] == zs::Cadence::None);
+	CHECK(cadences[9] == zs::Cadence::Pulldown22 && cadences[10] == zs::Cadence::Pulldown22);
+
+	// A new picture every frame has no cadence
+	detector.Reset();
+	const uint32_t once[] = { 1 };
+	CHECK(Feed(detector, once, 1, 12) == "NNNNNNNNNNNN");
+	CHECK(detector.GetCadence() == zs::Cadence::None);
+	CHECK(detector.GetRepeatCount() == 0);
+
+	// Pictures shown 4 times each (15p in 60p) are neither
+	detector.Reset();
+	const uint32_t fourTimes[] = { 4 };
+	cadences.clear();
+	CHECK(Feed(detector, fourTimes, 1, 24, &cadences) == "NRRRNRRRNRRRNRRRNRRRNRRR");
+	for (zs::Cadence cadence : cadences)
+		CHECK(cadence == zs::Cadence::None);
+
+}
+
+
+static void TestSampledRows(zs::CadenceDetector& detector) {
+
+	// Rows 4 and 12 are hashed with the default step of 8, including their tail bytes
+	detector.Reset();
+	std::vector<uint8_t> frame = Picture(7);
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+	CHECK(detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+
+	frame[5 * STRIDE + 3] ^= 1;
+	CHECK(detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+	frame[4 * STRIDE + 3] ^= 1;
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+	frame[12 * STRIDE + ROW_BYTES - 1] ^= 1;
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+
+	// Padding past the row bytes is ignored
+	frame[12 * STRIDE + ROW_BYTES] ^= 1;
+	CHECK(detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+
+	// Swapped rows are a different picture
+	std::vector<uint8_t> swapped(STRIDE * HEIGHT, 0);
+	memset(swapped.data() + 4 * STRIDE, 1, STRIDE);
+	const uint64_t before = zs::CadenceDetector::Signature(swapped.data(), ROW_BYTES, HEIGHT, STRIDE, 8);
+	memset(swapped.data() + 4 * STRIDE, 0, STRIDE);
+	memset(swapped.data() + 12 * STRIDE, 1, STRIDE);
+	CHECK(zs::CadenceDetector::Signature(swapped.data(), ROW_BYTES, HEIGHT, STRIDE, 8) != before);
+
+	// After a reset the first frame cannot be a repeat
+	detector.Reset();
+	CHECK(!detector.IsRepeat(frame.data(), ROW_BYTES, HEIGHT, STRIDE));
+
+}
+
+
+int main() {
+
+	zs::CadenceDetector detector;
+
+	TestPulldown32(detector);
+	TestOtherCadences(detector);
+	TestSampledRows(detector);
+
+	return TEST_RESULT();
+
+}
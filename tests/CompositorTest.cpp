@@ -0,0 +1,116 @@
+#include <vector>
+#include "TestCheck.h"
+#include "Compositor.h"
+
+
+/// Colour of a flat UYVY pixel pair
+struct Colour {
+	uint8_t u, y, v;
+};
+
+
+static const Colour BLACK = { 128, 16, 128 };
+static const Colour UNTOUCHED = { 0xEE, 0xEE, 0xEE };
+
+
+/// Packed UYVY frame of one colour
+static std::vector<uint8_t> FlatFrame(uint32_t width, uint32_t height, Colour colour) {
+
+	std::vector<uint8_t> frame(width * height * 2);
+	for (uint32_t i = 0; i < width * height; i += 2) {
+		frame[i * 2] = colour.u;
+		frame[i * 2 + 1] = colour.y;
+		frame[i * 2 + 2] = colour.v;
+		frame[i * 2 + 3] = colour.y;
+	}
+	return frame;
+
+}
+
+
+/// TRUE if every pixel of the rectangle has the colour
+static bool RectIs(const std::vector<uint8_t>& canvas, uint32_t canvasWidth,
+	uint32_t x, uint32_t y, uint32_t w, uint32_t h, Colour colour) {
+
+	for (uint32_t row = y; row < y + h; row++)
+		for (uint32_t col = x; col < x + w; col += 2) {
+			const uint8_t* p = &canvas[(row * canvasWidth + col) * 2];
+			if (p[0] != colour.u || p[1] != colour.y || p[2] != colour.v || p[3] != colour.y)
+				return false;
+		}
+	return true;
+
+}
+
+
+static void TestIncompleteGrid(zs::StripeWorkers& workers) {
+
+	// Three tiles make a 2x2 grid of 8x4 tiles with the bottom right cell empty
+	zs::Compositor compositor(workers);
+	CHECK(compositor.SetLayout(16, 8, 3));
+	std::vector<uint8_t> canvas = FlatFrame(16, 8, UNTOUCHED);
+
+	const Colour red = { 90, 80, 240 }, green = { 50, 150, 40 };
+	std::vector<uint8_t> src0 = FlatFrame(32, 16, red), src1 = FlatFrame(4, 2, green);
+	CHECK(compositor.Draw(0, src0.data(), 32, 16, 0, canvas.data()));
+	CHECK(compositor.Draw(1, src1.data(), 4, 2, 0, canvas.data()));
+	CHECK(RectIs(canvas, 16, 0, 0, 8, 4, red));
+	CHECK(RectIs(canvas, 16, 8, 0, 8, 4, green));
+	CHECK(RectIs(canvas, 16, 0, 4, 16, 4, UNTOUCHED));
+
+	compositor.Clear(2, canvas.data());
+	CHECK(RectIs(canvas, 16, 0, 4, 8, 4, BLACK));
+	CHECK(RectIs(canvas, 16, 8, 4, 8, 4, UNTOUCHED));
+
+	compositor.ClearBorders(canvas.data());
+	CHECK(RectIs(canvas, 16, 8, 4, 8, 4, BLACK));
+	CHECK(RectIs(canvas, 16, 0, 0, 8, 4, red) && RectIs(canvas, 16, 8, 0, 8, 4, green));
+
+	// Tiles past the layout are rejected
+	CHECK(!compositor.Draw(3, src1.data(), 4, 2, 0, canvas.data()));
+
+}
+
+
+static void TestRemainders(zs::StripeWorkers& workers) {
+
+	// 18x9 in a 2x2 grid leaves a column of 2 pixels at the right and one row at the bottom
+	zs::Compositor compositor(workers);
+	CHECK(compositor.SetLayout(18, 9, 4));
+	std::vector<uint8_t> canvas = FlatFrame(18, 9, UNTOUCHED);
+	const Colour grey = { 128, 120, 128 };
+	std::vector<uint8_t> src = FlatFrame(8, 4, grey);
+	for (uint32_t tile = 0; tile < 4; tile++)
+		CHECK(compositor.Draw(tile, src.data(), 8, 4, 0, canvas.data()));
+	compositor.ClearBorders(canvas.data());
+
+	CHECK(RectIs(canvas, 18, 0, 0, 16, 8, grey));
+	CHECK(RectIs(canvas, 18, 16, 0, 2, 9, BLACK));
+	CHECK(RectIs(canvas, 18, 0, 8, 18, 1, BLACK));
+
+}
+
+
+static void TestInvalidLayout(zs::StripeWorkers& workers) {
+
+	zs::Compositor compositor(workers);
+	CHECK(!compositor.SetLayout(16, 8, 0));
+	CHECK(!compositor.SetLayout(15, 8, 1));
+	CHECK(compositor.SetLayout(16, 8, 16));
+	// Five columns would make tiles narrower than 4 pixels
+	CHECK(!compositor.SetLayout(16, 8, 25));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+
+	TestIncompleteGrid(workers);
+	TestRemainders(workers);
+	TestInvalidLayout(workers);
+
+	return TEST_RESULT();
+
+}
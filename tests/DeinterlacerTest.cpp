@@ -0,0 +1,110 @@
+#include <cstring>
+#include "TestCheck.h"
+#include "Deinterlacer.h"
+
+
+// Rows hold one value each, so the expected output rows follow from the kernels by hand.
+// 16 pixels are 32 bytes per row, enough for the vector path and its scalar tail.
+#define WIDTH 16
+
+
+static void TestBob(zs::Deinterlacer& deinterlacer) {
+
+	// Top field keeps the even lines and averages its neighbours into the odd ones, the last
+	// line repeats the field line above it
+	const uint8_t rows[] = { 10, 99, 30, 99 };
+	zs::Frame src = RowFrame(WIDTH, rows, 4), dst;
+	CHECK(deinterlacer.Bob(src, 0, false, dst));
+	CHECK(dst.width == WIDTH && dst.height == 4);
+	CHECK(RowIs(dst, 0, 10) && RowIs(dst, 1, 20) && RowIs(dst, 2, 30) && RowIs(dst, 3, 30));
+
+	// Bottom field keeps the odd lines, the first line repeats the one below it
+	const uint8_t bottom[] = { 99, 20, 99, 40 };
+	zs::Frame src2 = RowFrame(WIDTH, bottom, 4);
+	CHECK(deinterlacer.Bob(src2, 0, true, dst));
+	CHECK(RowIs(dst, 0, 20) && RowIs(dst, 1, 20) && RowIs(dst, 2, 30) && RowIs(dst, 3, 40));
+
+	// An odd number of lines has no field pairs
+	zs::Frame odd = RowFrame(WIDTH, rows, 3);
+	CHECK(!deinterlacer.Bob(odd, 0, false, dst));
+
+}
+
+
+static void TestBobField(zs::Deinterlacer& deinterlacer) {
+
+	// A field of two lines becomes a frame of four
+	const uint8_t field[] = { 10, 30 };
+	zs::Frame src = RowFrame(WIDTH, field, 2), dst;
+	CHECK(deinterlacer.BobField(src, 0, false, dst));
+	CHECK(dst.height == 4);
+	CHECK(RowIs(dst, 0, 10) && RowIs(dst, 1, 20) && RowIs(dst, 2, 30) && RowIs(dst, 3, 30));
+
+	CHECK(deinterlacer.BobField(src, 0, true, dst));
+	CHECK(RowIs(dst, 0, 10) && RowIs(dst, 1, 10) && RowIs(dst, 2, 20) && RowIs(dst, 3, 30));
+
+}
+
+
+static void TestBlend(zs::Deinterlacer& deinterlacer) {
+
+	// [1 2 1] / 4 of alternating lines flattens them, edges mirror
+	const uint8_t rows[] = { 0, 100, 0, 100 };
+	zs::Frame src = RowFrame(WIDTH, rows, 4), dst;
+	CHECK(deinterlacer.Blend(src, 0, dst));
+	for (uint32_t y = 0; y < 4; y++)
+		CHECK(RowIs(dst, y, 50));
+
+	// A padded source stride gives the same result
+	const uint32_t stride = WIDTH * 2 + 8;
+	zs::Frame padded;
+	padded.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+	padded.width = WIDTH;
+	padded.height = 4;
+	padded.size = stride * 4;
+	padded.data = new uint8_t[padded.size];
+	for (uint32_t y = 0; y < 4; y++)
+		memset(padded.data + y * stride, rows[y], stride);
+	CHECK(deinterlacer.Blend(padded, stride, dst));
+	for (uint32_t y = 0; y < 4; y++)
+		CHECK(RowIs(dst, y, 50));
+
+}
+
+
+static void TestMotionAdaptive(zs::Deinterlacer& deinterlacer) {
+
+	const uint8_t rows[] = { 10, 200, 30, 200, 50, 200 };
+	zs::Frame src = RowFrame(WIDTH, rows, 6), dst;
+
+	// Without history every pixel counts as moving: the older (top) field is interpolated
+	CHECK(deinterlacer.MotionAdaptive(src, 0, false, dst));
+	CHECK(RowIs(dst, 0, 200) && RowIs(dst, 1, 200) && RowIs(dst, 2, 200) && RowIs(dst, 5, 200));
+
+	// The same picture again is static and woven back unchanged
+	CHECK(deinterlacer.MotionAdaptive(src, 0, false, dst));
+	for (uint32_t y = 0; y < 6; y++)
+		CHECK(RowIs(dst, y, rows[y]));
+
+	// A change above the threshold is interpolated again
+	const uint8_t moved[] = { 90, 200, 90, 200, 90, 200 };
+	zs::Frame src2 = RowFrame(WIDTH, moved, 6);
+	CHECK(deinterlacer.MotionAdaptive(src2, 0, false, dst));
+	CHECK(RowIs(dst, 0, 200) && RowIs(dst, 2, 200) && RowIs(dst, 4, 200));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::Deinterlacer deinterlacer(workers);
+
+	TestBob(deinterlacer);
+	TestBobField(deinterlacer);
+	TestBlend(deinterlacer);
+	TestMotionAdaptive(deinterlacer);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,107 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "TestCheck.h"
+#include "DmabufPublisher.h"
+
+
+// Written next to the test binary, run_tests.sh runs from the repository root
+#define SOCKET_PATH "build/tests/DmabufPublisherTest.sock"
+#define BUFFER_PATH "build/tests/DmabufPublisherTest.buf"
+
+
+/// Connect a client to the publisher socket
+static int Connect() {
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, SOCKET_PATH);
+	if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+
+}
+
+
+/// Receive one frame description and its descriptor, -1 if there is none
+static int Receive(int client, zs::DmabufFrame& frame) {
+
+	struct iovec iov;
+	iov.iov_base = &frame;
+	iov.iov_len = sizeof(frame);
+	union {
+		char buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	if (recvmsg(client, &msg, MSG_DONTWAIT) != (ssize_t)sizeof(frame))
+		return -1;
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS)
+		return -1;
+	int fd;
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+	return fd;
+
+}
+
+
+/// TRUE if both descriptors refer to the same file
+static bool SameFile(int a, int b) {
+
+	struct stat sa, sb;
+	return fstat(a, &sa) == 0 && fstat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+
+}
+
+
+int main() {
+
+	zs::DmabufPublisher publisher;
+	CHECK(publisher.Open(SOCKET_PATH));
+	// Any descriptor stands in for the DMABUF of a capture buffer
+	int buffer = open(BUFFER_PATH, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	CHECK(buffer >= 0);
+
+	// Clients are picked up by the next publish and get the description with the descriptor
+	int client = Connect();
+	CHECK(client >= 0);
+	const zs::DmabufFrame sent = { 3, 1920, 1080, 3840, 0x56595559, 3840 * 1080, 42, 123456789 };
+	publisher.Publish(buffer, sent);
+	CHECK(publisher.GetClientCount() == 1);
+	zs::DmabufFrame received;
+	memset(&received, 0, sizeof(received));
+	int fd = Receive(client, received);
+	CHECK(fd >= 0 && SameFile(fd, buffer));
+	CHECK(memcmp(&sent, &received, sizeof(sent)) == 0);
+	if (fd >= 0)
+		close(fd);
+
+	// A client that does not read misses frames, the publisher never blocks on it
+	for (int i = 0; i < 300; i++)
+		publisher.Publish(buffer, sent);
+	CHECK(publisher.GetClientCount() == 1);
+
+	// A client that went away is dropped with the next frame
+	close(client);
+	publisher.Publish(buffer, sent);
+	CHECK(publisher.GetClientCount() == 0);
+
+	close(buffer);
+	unlink(BUFFER_PATH);
+	return TEST_RESULT();
+
+}
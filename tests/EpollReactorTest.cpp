@@ -0,0 +1,102 @@
+#include <atomic>
+#include <cerrno>
+#include <thread>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "TestCheck.h"
+#include "EpollReactor.h"
+
+
+static void TestDispatch() {
+
+	zs::EpollReactor reactor;
+	int fds[2];
+	CHECK(!reactor.Add(0, EPOLLIN, zs::EpollReactor::Handler()) && errno == EBADF);
+	CHECK(reactor.Open());
+	CHECK(pipe(fds) == 0);
+
+	// A descriptor that is still readable after its handler returns is dispatched again
+	uint32_t calls = 0, mask = 0;
+	CHECK(reactor.Add(fds[0], EPOLLIN, [&](uint32_t events) {
+		char byte;
+		CHECK(read(fds[0], &byte, 1) == 1);
+		mask |= events;
+		if (++calls == 3)
+			reactor.Stop();
+	}));
+	CHECK(write(fds[1], "abc", 3) == 3);
+	reactor.Run();
+	CHECK(calls == 3);
+	CHECK((mask & EPOLLIN) != 0);
+
+	close(fds[0]);
+	close(fds[1]);
+
+}
+
+
+static void TestIdle() {
+
+	// Idle runs after every wait that timed out, until it stops the reactor
+	zs::EpollReactor reactor;
+	CHECK(reactor.Open());
+	uint32_t idle = 0;
+	reactor.Run(1, [&]() {
+		if (++idle == 3)
+			reactor.Stop();
+	});
+	CHECK(idle == 3);
+
+}
+
+
+static void TestThreads() {
+
+	// With three threads in Run() a one-shot descriptor is still handled by one at a time,
+	// and one Stop() ends all of them
+	zs::EpollReactor reactor;
+	int fds[2];
+	CHECK(reactor.Open());
+	CHECK(pipe(fds) == 0);
+
+	const int BYTES = 200;
+	std::atomic<int> handled(0), running(0), overlap(0);
+	CHECK(reactor.Add(fds[0], EPOLLIN, [&](uint32_t) {
+		if (++running > 1)
+			overlap++;
+		char byte;
+		if (read(fds[0], &byte, 1) == 1 && ++handled == BYTES)
+			reactor.Stop();
+		usleep(50);
+		running--;
+	}));
+
+	std::thread writer([&]() {
+		for (int i = 0; i < BYTES; i++)
+			if (write(fds[1], "x", 1) != 1)
+				break;
+	});
+	std::thread second([&]() { reactor.Run(); }), third([&]() { reactor.Run(); });
+	reactor.Run();
+	second.join();
+	third.join();
+	writer.join();
+
+	CHECK(handled == BYTES);
+	CHECK(overlap == 0);
+
+	close(fds[0]);
+	close(fds[1]);
+
+}
+
+
+int main() {
+
+	TestDispatch();
+	TestIdle();
+	TestThreads();
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,119 @@
+#include "TestCheck.h"
+#include "FrameRotator.h"
+
+
+/// UYVY frame with luma numbering the pixels row by row and neutral chroma
+static zs::Frame NumberedFrame(uint32_t width, uint32_t height) {
+
+	zs::Frame frame(width, height, (uint32_t)zs::ValidFourccCodes::UYVY);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++) {
+			frame.data[(y * width + x) * 2] = 128;
+			frame.data[(y * width + x) * 2 + 1] = (uint8_t)(y * width + x);
+		}
+	return frame;
+
+}
+
+
+/// Source pixel shown at output pixel (ox, oy) of a clockwise rotation after an optional mirror
+static uint8_t SourceLuma(uint32_t width, uint32_t height, uint32_t rotation, bool hflip, uint32_t ox, uint32_t oy) {
+
+	uint32_t x, y;
+	switch (rotation) {
+	case 90: x = oy; y = height - 1 - ox; break;
+	case 180: x = width - 1 - ox; y = height - 1 - oy; break;
+	case 270: x = width - 1 - oy; y = ox; break;
+	default: x = ox; y = oy; break;
+	}
+	if (hflip)
+		x = width - 1 - x;
+	return (uint8_t)(y * width + x);
+
+}
+
+
+/// TRUE if every output pixel shows the expected source pixel and chroma stays neutral
+static bool Matches(const zs::Frame& dst, uint32_t width, uint32_t height, uint32_t rotation, bool hflip) {
+
+	for (uint32_t oy = 0; oy < dst.height; oy++)
+		for (uint32_t ox = 0; ox < dst.width; ox++) {
+			const uint8_t* p = dst.data + (oy * dst.width + ox) * 2;
+			if (p[0] != 128 || p[1] != SourceLuma(width, height, rotation, hflip, ox, oy))
+				return false;
+		}
+	return true;
+
+}
+
+
+static void TestRotations(zs::FrameRotator& rotator) {
+
+	// 16x8 runs through the 8x8 block transpose, 6x4 only through the edge pixels
+	const uint32_t sizes[][2] = { { 16, 8 }, { 6, 4 } };
+	for (auto& size : sizes) {
+		zs::Frame src = NumberedFrame(size[0], size[1]);
+		for (uint32_t rotation = 0; rotation < 360; rotation += 90)
+			for (int hflip = 0; hflip < 2; hflip++) {
+				zs::Frame dst;
+				CHECK(rotator.Transform(src, 0, rotation, hflip != 0, dst));
+				const bool quarter = rotation == 90 || rotation == 270;
+				CHECK(dst.width == (quarter ? size[1] : size[0]) && dst.height == (quarter ? size[0] : size[1]));
+				CHECK(Matches(dst, size[0], size[1], rotation, hflip != 0));
+			}
+	}
+
+	// A quarter turn of a 4x4 frame by hand: the left column read bottom up becomes the top row
+	zs::Frame small = NumberedFrame(4, 4), dst;
+	CHECK(rotator.Transform(small, 0, 90, false, dst));
+	const uint8_t clockwise[] = { 12, 8, 4, 0, 13, 9, 5, 1, 14, 10, 6, 2, 15, 11, 7, 3 };
+	for (uint32_t i = 0; i < 16; i++)
+		CHECK(dst.data[i * 2 + 1] == clockwise[i]);
+
+}
+
+
+static void TestChroma(zs::FrameRotator& rotator) {
+
+	// Mirroring keeps every pixel pair together, so its chroma is unchanged
+	zs::Frame src = NumberedFrame(8, 4), dst;
+	for (uint32_t i = 0; i < 8; i += 2)
+		src.data[i * 2] = (uint8_t)(10 * i);
+	CHECK(rotator.Transform(src, 0, 0, true, dst));
+	for (uint32_t i = 0; i < 8; i += 2)
+		CHECK(dst.data[i * 2] == (uint8_t)(10 * (6 - i)));
+
+	// A quarter turn pairs pixels of neighbouring source rows: U of even rows is 40, of odd
+	// rows 80, so every output pair gets (40 + 80 + 1) / 2
+	zs::Frame rows = NumberedFrame(4, 4);
+	for (uint32_t i = 0; i < 16; i += 2)
+		rows.data[i * 2] = (i / 4) % 2 == 0 ? 40 : 80;
+	CHECK(rotator.Transform(rows, 0, 90, false, dst));
+	for (uint32_t i = 0; i < 16; i += 2)
+		CHECK(dst.data[i * 2] == 60);
+
+}
+
+
+static void TestInvalid(zs::FrameRotator& rotator) {
+
+	zs::Frame src = NumberedFrame(6, 4), dst;
+	CHECK(!rotator.Transform(src, 0, 45, false, dst));
+	zs::Frame odd = NumberedFrame(6, 5);
+	CHECK(!rotator.Transform(odd, 0, 90, false, dst));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::FrameRotator rotator(workers);
+
+	TestRotations(rotator);
+	TestChroma(rotator);
+	TestInvalid(rotator);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,106 @@
+#include <cstring>
+#include <vector>
+#include "TestCheck.h"
+#include "FrameScaler.h"
+
+
+/// Packed UYVY frame with luma 10 * x + 40 * y, U 20 * pair + 40 * y and V 200 - U
+static std::vector<uint8_t> RampFrame(uint32_t width, uint32_t height) {
+
+	std::vector<uint8_t> frame(width * height * 2);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++) {
+			uint8_t* p = &frame[(y * width + x) * 2];
+			const uint8_t u = (uint8_t)(20 * (x / 2) + 40 * y);
+			p[0] = x % 2 == 0 ? u : (uint8_t)(200 - u);
+			p[1] = (uint8_t)(10 * x + 40 * y);
+		}
+	return frame;
+
+}
+
+
+/// Halving both dimensions averages 2x2 blocks of luma and 2x2 blocks of chroma pairs
+static void CheckHalved(zs::FrameScaler& scaler) {
+
+	std::vector<uint8_t> src = RampFrame(8, 4), dst(4 * 2 * 2);
+	CHECK(scaler.Scale(src.data(), 8, 4, 0, dst.data(), 4, 2, 0));
+	for (uint32_t oy = 0; oy < 2; oy++) {
+		for (uint32_t ox = 0; ox < 4; ox++)
+			CHECK(dst[(oy * 4 + ox) * 2 + 1] == 20 * ox + 80 * oy + 25);
+		for (uint32_t op = 0; op < 2; op++) {
+			const uint32_t u = 40 * op + 80 * oy + 30;
+			CHECK(dst[(oy * 4 + op * 2) * 2] == u);
+			CHECK(dst[(oy * 4 + op * 2) * 2 + 2] == 200 - u);
+		}
+	}
+
+}
+
+
+static void TestBox(zs::StripeWorkers& workers) {
+
+	zs::FrameScaler scaler(workers);
+	CheckHalved(scaler);
+
+	// 540 rows per output row are summed in more than one 16-bit pass without overflow
+	std::vector<uint8_t> white(64 * 2 * 2160, 255), dst(16 * 2 * 4, 0);
+	CHECK(scaler.Scale(white.data(), 64, 2160, 0, dst.data(), 16, 4, 0));
+	for (uint8_t v : dst)
+		CHECK(v == 255);
+
+	// Upscaling repeats the nearest source pixel
+	std::vector<uint8_t> src = RampFrame(4, 4), big(8 * 8 * 2);
+	CHECK(scaler.Scale(src.data(), 4, 4, 0, big.data(), 8, 8, 0));
+	for (uint32_t y = 0; y < 8; y++)
+		for (uint32_t x = 0; x < 8; x++)
+			CHECK(big[(y * 8 + x) * 2 + 1] == src[((y / 2) * 4 + x / 2) * 2 + 1]);
+
+	// A padded output stride leaves the padding alone
+	const uint32_t stride = 4 * 2 + 4;
+	std::vector<uint8_t> half = RampFrame(8, 4), padded(stride * 2, 7);
+	CHECK(scaler.Scale(half.data(), 8, 4, 0, padded.data(), 4, 2, stride));
+	CHECK(padded[1] == 25 && padded[stride + 1] == 105);
+	for (uint32_t i = 8; i < stride; i++)
+		CHECK(padded[i] == 7 && padded[stride + i] == 7);
+
+}
+
+
+static void TestBilinear(zs::StripeWorkers& workers) {
+
+	zs::FrameScaler scaler(workers, zs::ScaleFilter::Bilinear);
+
+	// Sample centres of a 2:1 reduction fall half way between source pixels
+	CheckHalved(scaler);
+
+	// At the same size every sample centre is a source pixel
+	std::vector<uint8_t> src = RampFrame(6, 4), dst(6 * 4 * 2);
+	CHECK(scaler.Scale(src.data(), 6, 4, 0, dst.data(), 6, 4, 0));
+	CHECK(dst == src);
+
+}
+
+
+static void TestInvalid(zs::StripeWorkers& workers) {
+
+	zs::FrameScaler scaler(workers);
+	std::vector<uint8_t> src = RampFrame(8, 4), dst(8 * 4 * 2);
+	CHECK(!scaler.Scale(src.data(), 7, 4, 0, dst.data(), 4, 2, 0));
+	CHECK(!scaler.Scale(src.data(), 8, 4, 0, dst.data(), 5, 2, 0));
+	CHECK(!scaler.Scale(nullptr, 8, 4, 0, dst.data(), 4, 2, 0));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+
+	TestBox(workers);
+	TestBilinear(workers);
+	TestInvalid(workers);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,102 @@
+#include "TestCheck.h"
+#include "LatencyHistogram.h"
+
+
+/// Median of a single sample: the middle of the bucket that holds it
+static uint64_t Single(int64_t micros) {
+
+	zs::LatencyHistogram histogram;
+	histogram.Add(micros);
+	return histogram.Percentile(0.5);
+
+}
+
+
+static void TestBuckets() {
+
+	// Below 16 us every microsecond has a bucket of its own
+	CHECK(Single(0) == 0);
+	CHECK(Single(-5) == 0);
+	CHECK(Single(5) == 5);
+	CHECK(Single(15) == 15);
+
+	// 16..31 us in steps of 2: 16 and 17 share [16, 18), 18 starts the next step
+	CHECK(Single(16) == 17);
+	CHECK(Single(17) == 17);
+	CHECK(Single(18) == 19);
+	CHECK(Single(31) == 31);
+
+	// 32..63 us in steps of 4
+	CHECK(Single(32) == 34);
+	CHECK(Single(35) == 34);
+	CHECK(Single(36) == 38);
+
+	// 1000 us is in [960, 1024), 1/8 of the octave from 512 to 1024
+	CHECK(Single(1000) == 992);
+	CHECK(Single(1023) == 992);
+	// 1024 starts the next octave, in steps of 128
+	CHECK(Single(1024) == 1088);
+
+	// Everything from the last step of the last octave up lands in the last bucket
+	CHECK(Single(100000000) == 15ull << 20);
+	CHECK(Single(15ull << 20) == 15ull << 20);
+
+}
+
+
+static void TestPercentiles() {
+
+	zs::LatencyHistogram histogram;
+	CHECK(histogram.Percentile(0.5) == 0);
+	CHECK(histogram.Count() == 0);
+	for (int64_t us = 1; us <= 100; us++)
+		histogram.Add(us);
+	CHECK(histogram.Count() == 100);
+
+	// Rank 1 is the only sample of bucket [1, 2)
+	CHECK(histogram.Percentile(0.0) == 1);
+	// Rank 50 is the third of the 4 samples in [48, 52), spread over the bucket: 48 + 4 * 2.5 / 4
+	CHECK(histogram.Percentile(0.5) == 50);
+	// Rank 99 is the fourth of the 5 samples in [96, 104): 96 + 8 * 3.5 / 5
+	CHECK(histogram.Percentile(0.99) == 101);
+
+	// Merging counts the samples of both, so the same samples twice keep the percentiles
+	zs::LatencyHistogram twice;
+	twice.Merge(histogram);
+	twice.Merge(histogram);
+	CHECK(twice.Count() == 200);
+	CHECK(twice.Percentile(0.5) == 50);
+
+	histogram.Reset();
+	CHECK(histogram.Count() == 0);
+	CHECK(histogram.Percentile(0.99) == 0);
+
+}
+
+
+static void TestFormat() {
+
+	zs::LatencyHistogram histogram;
+	CHECK(histogram.Format().empty());
+
+	// Samples are summed per power of two, from 10 ms up in milliseconds
+	histogram.Add(3);
+	histogram.Add(5);
+	histogram.Add(6);
+	histogram.Add(20);
+	histogram.Add(1000);
+	histogram.Add(20000);
+	CHECK(histogram.Format() == "<4us:1 <8us:2 <32us:1 <1024us:1 <32ms:1");
+
+}
+
+
+int main() {
+
+	TestBuckets();
+	TestPercentiles();
+	TestFormat();
+
+	return TEST_RESULT();
+
+}
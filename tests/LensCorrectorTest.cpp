@@ -0,0 +1,126 @@
+#include "TestCheck.h"
+#include "LensCorrector.h"
+
+
+// Larger than one 64x16 tile in both directions
+#define WIDTH 80
+#define HEIGHT 20
+
+
+/// UYVY frame with luma 2 * x + 4 * y and flat chroma, so bilinear samples land on whole values
+static zs::Frame RampFrame() {
+
+	zs::Frame frame(WIDTH, HEIGHT, (uint32_t)zs::ValidFourccCodes::UYVY);
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			uint8_t* p = frame.data + (y * WIDTH + x) * 2;
+			p[0] = x % 2 == 0 ? 60 : 200;
+			p[1] = (uint8_t)(2 * x + 4 * y);
+		}
+	return frame;
+
+}
+
+
+static uint8_t Luma(const zs::Frame& frame, uint32_t x, uint32_t y) {
+
+	return frame.data[(y * frame.width + x) * 2 + 1];
+
+}
+
+
+static void TestIdentity(zs::LensCorrector& corrector) {
+
+	// Without distortion every pixel maps onto itself; the last column and row sample 1/16
+	// of a pixel inside the frame, so only the rest is exact
+	corrector.SetParameters(zs::LensParameters{ 100.0f, 100.0f, 40.0f, 10.0f, 0, 0, 0, 0, 0, 1.0f });
+	zs::Frame src = RampFrame(), dst;
+	CHECK(corrector.Remap(src, 0, dst));
+	CHECK(dst.width == WIDTH && dst.height == HEIGHT);
+	CHECK(corrector.GetTableBytes() == WIDTH * HEIGHT * 4);
+	bool same = true;
+	for (uint32_t y = 0; y < HEIGHT - 1; y++)
+		for (uint32_t i = 0; i < (WIDTH - 1) * 2; i++)
+			same = same && dst.data[y * WIDTH * 2 + i] == src.data[y * WIDTH * 2 + i];
+	CHECK(same);
+
+}
+
+
+static void TestZoom(zs::LensCorrector& corrector) {
+
+	// Twice the magnification around the top left corner samples the source at (x / 2, y / 2),
+	// half way between pixels for odd coordinates
+	corrector.SetParameters(zs::LensParameters{ 100.0f, 100.0f, 0.0f, 0.0f, 0, 0, 0, 0, 0, 2.0f });
+	zs::Frame src = RampFrame(), dst;
+	CHECK(corrector.Remap(src, 0, dst));
+	bool ramp = true, chroma = true;
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			ramp = ramp && Luma(dst, x, y) == x + 2 * y;
+			chroma = chroma && dst.data[(y * WIDTH + x) * 2] == (x % 2 == 0 ? 60 : 200);
+		}
+	CHECK(ramp);
+	CHECK(chroma);
+
+	// Half the magnification around the centre pushes the corners outside the source
+	corrector.SetParameters(zs::LensParameters{ 100.0f, 100.0f, 40.0f, 10.0f, 0, 0, 0, 0, 0, 0.5f });
+	CHECK(corrector.Remap(src, 0, dst));
+	CHECK(Luma(dst, 0, 0) == 16 && dst.data[0] == 128 && dst.data[2] == 128);
+	CHECK(Luma(dst, WIDTH - 1, HEIGHT - 1) == 16);
+	CHECK(Luma(dst, 40, 10) == Luma(src, 40, 10));
+
+}
+
+
+static void TestRadial(zs::LensCorrector& corrector) {
+
+	// With k1 = 0.5 and f = 10, pixel x of the top row comes from x * (1 + 0.5 * (x / 10)^2):
+	// x = 10 from 15 and x = 20 from 60
+	corrector.SetParameters(zs::LensParameters{ 10.0f, 10.0f, 0.0f, 0.0f, 0.5f, 0, 0, 0, 0, 1.0f });
+	zs::Frame src = RampFrame(), dst;
+	CHECK(corrector.Remap(src, 0, dst));
+	CHECK(Luma(dst, 0, 0) == 0);
+	CHECK(Luma(dst, 10, 0) == 30);
+	CHECK(Luma(dst, 20, 0) == 120);
+
+	// A padded source stride gives the same picture
+	const uint32_t stride = WIDTH * 2 + 16;
+	zs::Frame padded(stride / 2, HEIGHT, (uint32_t)zs::ValidFourccCodes::UYVY);
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t i = 0; i < WIDTH * 2; i++)
+			padded.data[y * stride + i] = src.data[y * WIDTH * 2 + i];
+	padded.width = WIDTH;
+	zs::Frame dst2;
+	CHECK(corrector.Remap(padded, stride, dst2));
+	bool same = true;
+	for (uint32_t i = 0; i < dst.size; i++)
+		same = same && dst.data[i] == dst2.data[i];
+	CHECK(same);
+
+}
+
+
+static void TestInvalid(zs::LensCorrector& corrector) {
+
+	zs::Frame odd(WIDTH - 1, HEIGHT, (uint32_t)zs::ValidFourccCodes::UYVY), dst;
+	CHECK(!corrector.Remap(odd, 0, dst));
+	zs::Frame wide(4098, 2, (uint32_t)zs::ValidFourccCodes::UYVY);
+	CHECK(!corrector.Remap(wide, 0, dst));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::LensCorrector corrector(workers);
+
+	TestIdentity(corrector);
+	TestZoom(corrector);
+	TestRadial(corrector);
+	TestInvalid(corrector);
+
+	return TEST_RESULT();
+
+}
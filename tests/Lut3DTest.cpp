@@ -0,0 +1,169 @@
+#include <cstring>
+#include <string>
+#include "TestCheck.h"
+#include "Lut3D.h"
+
+
+// Written next to the test binary, run_tests.sh runs from the repository root
+#define CUBE_PATH "build/tests/Lut3DTest.cube"
+
+
+/// Write a .cube file with the given body
+static void WriteCube(const std::string& body) {
+
+	FILE* f = fopen(CUBE_PATH, "w");
+	if (f == nullptr)
+		return;
+	fputs(body.c_str(), f);
+	fclose(f);
+
+}
+
+
+/// .cube of size n where every node maps through map(r, g, b, out), red changing fastest
+template <typename Map>
+static std::string Cube(uint32_t n, Map map) {
+
+	std::string body = "TITLE \"test\"\nLUT_3D_SIZE " + std::to_string(n) + "\n";
+	char line[64];
+	for (uint32_t b = 0; b < n; b++)
+		for (uint32_t g = 0; g < n; g++)
+			for (uint32_t r = 0; r < n; r++) {
+				float out[3];
+				map(r / (float)(n - 1), g / (float)(n - 1), b / (float)(n - 1), out);
+				snprintf(line, sizeof(line), "%f %f %f\n", out[0], out[1], out[2]);
+				body += line;
+			}
+	return body;
+
+}
+
+
+/// Packed UYVY frame of one colour
+static zs::Frame Flat(uint32_t width, uint32_t height, uint8_t u, uint8_t y, uint8_t v) {
+
+	zs::Frame frame(width, height, (uint32_t)zs::ValidFourccCodes::UYVY);
+	for (uint32_t i = 0; i < width * height * 2; i += 4) {
+		frame.data[i] = u;
+		frame.data[i + 1] = y;
+		frame.data[i + 2] = v;
+		frame.data[i + 3] = y;
+	}
+	return frame;
+
+}
+
+
+/// TRUE if every pixel pair of a packed frame is within 1 of the colour
+static bool FlatIs(const zs::Frame& frame, uint8_t u, uint8_t y, uint8_t v) {
+
+	for (uint32_t i = 0; i < frame.width * frame.height * 2; i += 4)
+		if (abs(frame.data[i] - u) > 1 || abs(frame.data[i + 1] - y) > 1 ||
+			abs(frame.data[i + 2] - v) > 1 || abs(frame.data[i + 3] - y) > 1)
+			return false;
+	return true;
+
+}
+
+
+static void TestIdentity(zs::Lut3D& lut) {
+
+	// A 3x3x3 identity keeps every grey level, in both cells of the grey axis
+	WriteCube(Cube(3, [](float r, float g, float b, float* out) { out[0] = r; out[1] = g; out[2] = b; }));
+	CHECK(lut.LoadCube(CUBE_PATH));
+	CHECK(lut.GetSize() == 3);
+	for (uint32_t level = 16; level <= 235; level++) {
+		zs::Frame frame = Flat(4, 2, 128, (uint8_t)level, 128);
+		CHECK(lut.Process(frame.data, 4, 2, 8));
+		CHECK(FlatIs(frame, 128, (uint8_t)level, 128));
+	}
+
+}
+
+
+static void TestTetrahedral(zs::Lut3D& lut) {
+
+	// Only the white corner is white. On the grey diagonal the tetrahedra interpolate between
+	// the black and white corners alone, so mid grey stays mid grey; trilinear interpolation
+	// would mix in the six black corners and give (110 / 219)^3 of the range, Y = 44
+	WriteCube(Cube(2, [](float r, float g, float b, float* out) {
+		out[0] = out[1] = out[2] = r > 0.5f && g > 0.5f && b > 0.5f ? 1.0f : 0.0f;
+	}));
+	CHECK(lut.LoadCube(CUBE_PATH));
+	zs::Frame grey = Flat(4, 2, 128, 126, 128), dst;
+	CHECK(lut.Apply(grey, 0, dst));
+	CHECK(FlatIs(dst, 128, 126, 128));
+
+	// Swapping red and blue is linear, which tetrahedral interpolation reproduces exactly:
+	// BT.709 red (Y 63, Cb 102, Cr 240) becomes blue (Y 32, Cb 240, Cr 118)
+	WriteCube(Cube(2, [](float r, float g, float b, float* out) { out[0] = b; out[1] = g; out[2] = r; }));
+	CHECK(lut.LoadCube(CUBE_PATH));
+	lut.SetMatrix(zs::ColorMatrix::BT709);
+	zs::Frame red = Flat(4, 2, 102, 63, 240);
+	CHECK(lut.Apply(red, 0, dst));
+	CHECK(FlatIs(dst, 240, 32, 118));
+
+	// The same from YUY2 with a padded stride
+	const uint32_t stride = 4 * 2 + 8;
+	zs::Frame yuy2;
+	yuy2.fourcc = (uint32_t)zs::ValidFourccCodes::YUY2;
+	yuy2.width = 4;
+	yuy2.height = 2;
+	yuy2.size = stride * 2;
+	yuy2.data = new uint8_t[yuy2.size];
+	for (uint32_t y = 0; y < 2; y++)
+		for (uint32_t i = 0; i < 8; i += 4)
+			memcpy(yuy2.data + y * stride + i, "\x3f\x66\x3f\xf0", 4);
+	zs::Frame out;
+	CHECK(lut.Apply(yuy2, stride, out));
+	CHECK(FlatIs(out, 240, 32, 118));
+
+	// In place is allowed for packed data only
+	zs::Frame alias;
+	alias.data = yuy2.data;
+	alias.size = 4 * 2 * 2;
+	CHECK(!lut.Apply(yuy2, stride, alias));
+	alias.data = nullptr;
+	alias = red;
+	CHECK(lut.Apply(alias, 0, alias));
+	CHECK(FlatIs(alias, 240, 32, 118));
+
+}
+
+
+static void TestErrors(zs::Lut3D& lut) {
+
+	CHECK(!lut.LoadCube("build/tests/missing.cube"));
+	CHECK(!lut.GetError().empty());
+
+	WriteCube("LUT_3D_SIZE 2\n0 0 0\n1 1 1\n");
+	CHECK(!lut.LoadCube(CUBE_PATH));
+	CHECK(lut.GetError() == "expected 8 entries, found 2");
+
+	WriteCube("LUT_1D_SIZE 2\n0 0 0\n1 1 1\n");
+	CHECK(!lut.LoadCube(CUBE_PATH));
+	CHECK(lut.GetError() == "1D LUTs are not supported");
+
+	// A failed load keeps the LUT that was loaded before
+	CHECK(lut.GetSize() == 2);
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::Lut3D lut(workers);
+
+	// Nothing to apply before a LUT is loaded
+	zs::Frame frame = Flat(4, 2, 128, 126, 128);
+	CHECK(!lut.Process(frame.data, 4, 2, 8));
+
+	TestIdentity(lut);
+	TestTetrahedral(lut);
+	TestErrors(lut);
+
+	remove(CUBE_PATH);
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,82 @@
+#include <vector>
+#include "TestCheck.h"
+#include "MotionMeter.h"
+
+
+// 20 pixels per row: one 16 pixel vector step and a tail of 4; rows 0 and 4 are measured
+#define WIDTH 20
+#define HEIGHT 8
+#define STRIDE (WIDTH * 2)
+
+
+/// Packed 4:2:2 frame of one luma level, chroma at the other byte of each sample
+static std::vector<uint8_t> Flat(uint8_t luma, uint32_t lumaOffset, uint8_t chroma = 128) {
+
+	std::vector<uint8_t> frame(STRIDE * HEIGHT);
+	for (uint32_t i = 0; i < frame.size(); i += 2) {
+		frame[i + lumaOffset] = luma;
+		frame[i + 1 - lumaOffset] = chroma;
+	}
+	return frame;
+
+}
+
+
+static void TestDifference(zs::MotionMeter& meter, uint32_t lumaOffset) {
+
+	meter.Reset();
+	std::vector<uint8_t> frame = Flat(100, lumaOffset);
+	CHECK(meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, lumaOffset) == -1.0f);
+	CHECK(meter.GetPeakLuma() == 100);
+
+	// Every measured sample 10 brighter
+	frame = Flat(110, lumaOffset);
+	CHECK(meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, lumaOffset) == 10.0f);
+
+	// Chroma and rows between the measured ones do not count
+	frame = Flat(110, lumaOffset, 20);
+	for (uint32_t i = 0; i < STRIDE; i += 2)
+		frame[STRIDE + i + lumaOffset] = 0;
+	CHECK(meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, lumaOffset) == 0.0f);
+
+	// Half the samples of one measured row 40 darker: 10 * 40 over 2 rows of 20 samples
+	for (uint32_t x = 0; x < WIDTH; x += 2)
+		frame[4 * STRIDE + x * 2 + lumaOffset] = 70;
+	CHECK(meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, lumaOffset) == 10.0f);
+
+	// The brightest sample is found in the scalar tail too
+	frame[4 * STRIDE + (WIDTH - 1) * 2 + lumaOffset] = 250;
+	meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, lumaOffset);
+	CHECK(meter.GetPeakLuma() == 250);
+
+}
+
+
+static void TestRestart(zs::MotionMeter& meter) {
+
+	meter.Reset();
+	std::vector<uint8_t> frame = Flat(50, 1);
+	meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, 1);
+	CHECK(meter.Measure(frame.data(), WIDTH, HEIGHT, STRIDE, 1) == 0.0f);
+
+	// A new size or a reset starts over
+	CHECK(meter.Measure(frame.data(), WIDTH - 2, HEIGHT, STRIDE, 1) == -1.0f);
+	CHECK(meter.Measure(frame.data(), WIDTH - 2, HEIGHT, STRIDE, 1) == 0.0f);
+	meter.Reset();
+	CHECK(meter.Measure(frame.data(), WIDTH - 2, HEIGHT, STRIDE, 1) == -1.0f);
+	CHECK(meter.Measure(nullptr, WIDTH, HEIGHT, STRIDE, 1) == -1.0f);
+
+}
+
+
+int main() {
+
+	zs::MotionMeter meter;
+
+	TestDifference(meter, 0);
+	TestDifference(meter, 1);
+	TestRestart(meter);
+
+	return TEST_RESULT();
+
+}
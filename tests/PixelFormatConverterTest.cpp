@@ -0,0 +1,144 @@
+#include <cstring>
+#include "TestCheck.h"
+#include "PixelFormatConverter.h"
+
+
+#define WIDTH 12
+#define HEIGHT 6
+
+
+/// Packed 4:2:2 frame numbering its bytes, rows stride bytes apart
+static zs::Frame Numbered(zs::ValidFourccCodes fourcc, uint32_t stride) {
+
+	zs::Frame frame;
+	frame.fourcc = (uint32_t)fourcc;
+	frame.width = WIDTH;
+	frame.height = HEIGHT;
+	frame.size = stride * HEIGHT;
+	frame.data = new uint8_t[frame.size];
+	for (uint32_t i = 0; i < frame.size; i++)
+		frame.data[i] = (uint8_t)i;
+	return frame;
+
+}
+
+
+/// TRUE if dst holds the rectangle at (x, y) of the numbered source, bytes swapped in pairs if swap
+static bool IsRegion(const zs::Frame& dst, uint32_t stride, uint32_t x, uint32_t y, bool swap) {
+
+	for (uint32_t row = 0; row < dst.height; row++)
+		for (uint32_t i = 0; i < dst.width * 2; i++)
+			if (dst.data[row * dst.width * 2 + i] != (uint8_t)((y + row) * stride + x * 2 + (swap ? i ^ 1 : i)))
+				return false;
+	return true;
+
+}
+
+
+static void TestRegion(zs::PixelFormatConverter& converter) {
+
+	// A 6x4 rectangle at (2, 1), kept in the source byte order
+	zs::Frame src = Numbered(zs::ValidFourccCodes::UYVY, WIDTH * 2), dst;
+	dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+	CHECK(converter.ConvertRegion(src, 0, 2, 1, 6, 4, dst));
+	CHECK(dst.width == 6 && dst.height == 4 && dst.size == 6 * 4 * 2);
+	CHECK(IsRegion(dst, WIDTH * 2, 2, 1, false));
+
+	// To the other 4:2:2 order, from a padded stride
+	const uint32_t stride = WIDTH * 2 + 8;
+	zs::Frame padded = Numbered(zs::ValidFourccCodes::YUY2, stride);
+	CHECK(converter.ConvertRegion(padded, stride, 4, 2, 8, 4, dst));
+	CHECK(IsRegion(dst, stride, 4, 2, true));
+
+	// In place into the start of the source buffer gives the same rectangle
+	zs::Frame inPlace;
+	inPlace.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+	inPlace.data = padded.data;
+	inPlace.size = 8 * 4 * 2;
+	CHECK(converter.ConvertRegion(padded, stride, 4, 2, 8, 4, inPlace));
+	CHECK(inPlace.data == padded.data);
+	CHECK(memcmp(inPlace.data, dst.data, dst.size) == 0);
+	inPlace.data = nullptr;
+
+}
+
+
+static void TestRegionLimits(zs::PixelFormatConverter& converter) {
+
+	zs::Frame src = Numbered(zs::ValidFourccCodes::UYVY, WIDTH * 2), dst;
+	dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+
+	// Odd left edge or width would split pixel pairs
+	CHECK(!converter.ConvertRegion(src, 0, 1, 0, 6, 4, dst));
+	CHECK(!converter.ConvertRegion(src, 0, 0, 0, 5, 4, dst));
+	// The rectangle must lie inside the frame, and the buffer must hold it
+	CHECK(!converter.ConvertRegion(src, 0, 8, 0, 6, 4, dst));
+	CHECK(!converter.ConvertRegion(src, 0, 0, 3, 6, 4, dst));
+	CHECK(!converter.ConvertRegion(src, WIDTH * 2 + 8, 0, 0, 6, HEIGHT, dst));
+	// The whole frame is a valid rectangle
+	CHECK(converter.ConvertRegion(src, 0, 0, 0, WIDTH, HEIGHT, dst));
+	CHECK(IsRegion(dst, WIDTH * 2, 0, 0, false));
+
+}
+
+
+static void TestPlanar(zs::PixelFormatConverter& converter) {
+
+	// 8x4 with luma numbering the pixels and chroma numbering the 4x2 chroma samples,
+	// U from 100 and V from 200, planes padded past their rows
+	const uint32_t width = 8, height = 4;
+	uint8_t y[16 * height], u[8 * height / 2], v[8 * height / 2], uv[16 * height / 2];
+	for (uint32_t row = 0; row < height; row++)
+		for (uint32_t col = 0; col < width; col++)
+			y[row * 16 + col] = (uint8_t)(row * width + col);
+	for (uint32_t row = 0; row < height / 2; row++)
+		for (uint32_t col = 0; col < width / 2; col++) {
+			u[row * 8 + col] = uv[row * 16 + col * 2] = (uint8_t)(100 + row * 4 + col);
+			v[row * 8 + col] = uv[row * 16 + col * 2 + 1] = (uint8_t)(200 + row * 4 + col);
+		}
+
+	// Every chroma row serves the two luma rows it covers
+	const uint8_t* planes[3] = { y, u, v };
+	const uint32_t strides[3] = { 16, 8, 8 };
+	zs::Frame dst;
+	dst.fourcc = (uint32_t)zs::ValidFourccCodes::UYVY;
+	CHECK(converter.ConvertPlanar(planes, strides, width, height, dst));
+	CHECK(dst.width == width && dst.height == height && dst.size == width * height * 2);
+	bool uyvy = true;
+	for (uint32_t row = 0; row < height; row++)
+		for (uint32_t pair = 0; pair < width / 2; pair++) {
+			const uint8_t* p = dst.data + (row * width + pair * 2) * 2;
+			const uint8_t chroma = (uint8_t)((row / 2) * 4 + pair);
+			uyvy = uyvy && p[0] == 100 + chroma && p[1] == row * width + pair * 2 &&
+				p[2] == 200 + chroma && p[3] == row * width + pair * 2 + 1;
+		}
+	CHECK(uyvy);
+
+	// NV12 interleaves U and V in one plane, YUY2 puts luma first
+	const uint8_t* nv12[3] = { y, uv, nullptr };
+	const uint32_t nv12Strides[3] = { 16, 16, 0 };
+	zs::Frame yuy2;
+	yuy2.fourcc = (uint32_t)zs::ValidFourccCodes::YUY2;
+	CHECK(converter.ConvertPlanar(nv12, nv12Strides, width, height, yuy2));
+	bool swapped = true;
+	for (uint32_t i = 0; i < dst.size; i++)
+		swapped = swapped && yuy2.data[i] == dst.data[i ^ 1];
+	CHECK(swapped);
+
+	// 4:2:0 needs an even number of rows
+	CHECK(!converter.ConvertPlanar(planes, strides, width, height - 1, dst));
+
+}
+
+
+int main() {
+
+	zs::PixelFormatConverter converter;
+
+	TestRegion(converter);
+	TestRegionLimits(converter);
+	TestPlanar(converter);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include "TestCheck.h"
+#include "RegionBlur.h"
+
+
+#define WIDTH 24
+#define HEIGHT 10
+#define STRIDE (WIDTH * 2)
+
+
+/// UYVY frame with neutral chroma and luma from luma(x, y)
+template <typename Luma>
+static std::vector<uint8_t> LumaFrame(Luma luma) {
+
+	std::vector<uint8_t> frame(STRIDE * HEIGHT, 128);
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t x = 0; x < WIDTH; x++)
+			frame[y * STRIDE + x * 2 + 1] = luma(x, y);
+	return frame;
+
+}
+
+
+static uint8_t Luma(const std::vector<uint8_t>& frame, uint32_t x, uint32_t y) {
+
+	return frame[y * STRIDE + x * 2 + 1];
+
+}
+
+
+static void TestHorizontal(zs::RegionBlur& blur) {
+
+	// A bright column spreads over its neighbours, a third each with radius 1; the rows are
+	// all alike, so the vertical pass keeps them
+	CHECK(blur.SetRegions({ { 4, 0, 10, HEIGHT } }, 1));
+	std::vector<uint8_t> frame = LumaFrame([](uint32_t x, uint32_t) { return x == 8 ? 90 : 0; });
+	CHECK(blur.Process(frame.data(), WIDTH, HEIGHT, STRIDE));
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t x = 0; x < WIDTH; x++)
+			CHECK(Luma(frame, x, y) == (x >= 7 && x <= 9 ? 30 : 0));
+	for (uint32_t i = 0; i < frame.size(); i += 2)
+		CHECK(frame[i] == 128);
+
+	// Outside the frame the edge column repeats: (90 + 90 + 0) / 3 at the edge
+	CHECK(blur.SetRegions({ { 0, 0, 4, HEIGHT } }, 1));
+	frame = LumaFrame([](uint32_t x, uint32_t) { return x == 0 ? 90 : 0; });
+	CHECK(blur.Process(frame.data(), WIDTH, HEIGHT, STRIDE));
+	CHECK(Luma(frame, 0, 0) == 60 && Luma(frame, 1, 0) == 30 && Luma(frame, 2, 0) == 0);
+
+}
+
+
+static void TestVertical(zs::RegionBlur& blur) {
+
+	// A bright row spreads over the rows next to it
+	CHECK(blur.SetRegions({ { 0, 0, WIDTH, HEIGHT } }, 1));
+	std::vector<uint8_t> frame = LumaFrame([](uint32_t, uint32_t y) { return y == 4 ? 90 : 0; });
+	CHECK(blur.Process(frame.data(), WIDTH, HEIGHT, STRIDE));
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		CHECK(Luma(frame, 0, y) == (y >= 3 && y <= 5 ? 30 : 0) && Luma(frame, WIDTH - 1, y) == Luma(frame, 0, y));
+
+	// A flat picture stays flat for any radius
+	CHECK(blur.SetRegions({ { 0, 0, WIDTH, HEIGHT } }, 127));
+	frame = LumaFrame([](uint32_t, uint32_t) { return 201; });
+	CHECK(blur.Process(frame.data(), WIDTH, HEIGHT, STRIDE));
+	for (uint32_t i = 1; i < frame.size(); i += 2)
+		CHECK(frame[i] == 201);
+
+}
+
+
+static void TestRegions(zs::RegionBlur& blur) {
+
+	// Only the clipped region changes, the rest of the frame is left as it was
+	CHECK(blur.SetRegions({ { 17, 6, 100, 100 } }, 4));
+	std::vector<uint8_t> frame = LumaFrame([](uint32_t x, uint32_t y) { return (x * 37 + y * 11) & 255; });
+	const std::vector<uint8_t> before = frame;
+	CHECK(blur.Process(frame.data(), WIDTH, HEIGHT, STRIDE));
+	bool outside = true, inside = false;
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		for (uint32_t i = 0; i < STRIDE; i++) {
+			const bool masked = y >= 6 && i >= 16 * 2;
+			if (!masked)
+				outside = outside && frame[y * STRIDE + i] == before[y * STRIDE + i];
+			else
+				inside = inside || frame[y * STRIDE + i] != before[y * STRIDE + i];
+		}
+	CHECK(outside);
+	CHECK(inside);
+
+	CHECK(!blur.SetRegions({ { 0, 0, 4, 4 } }, 0));
+	CHECK(!blur.SetRegions({ { 0, 0, 4, 4 } }, 128));
+	CHECK(!blur.Process(frame.data(), WIDTH - 1, HEIGHT, STRIDE));
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::RegionBlur blur(workers);
+
+	TestHorizontal(blur);
+	TestVertical(blur);
+	TestRegions(blur);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,114 @@
+#include <vector>
+#include "TestCheck.h"
+#include "SignalMonitor.h"
+
+
+#define WIDTH 16
+#define HEIGHT 8
+#define STRIDE (WIDTH * 2)
+
+
+/// UYVY frame of one luma level
+static std::vector<uint8_t> Flat(uint8_t luma) {
+
+	std::vector<uint8_t> frame(STRIDE * HEIGHT, 128);
+	for (uint32_t i = 1; i < frame.size(); i += 2)
+		frame[i] = luma;
+	return frame;
+
+}
+
+
+static zs::SignalState Feed(zs::SignalMonitor& monitor, const std::vector<uint8_t>& frame, double now) {
+
+	return monitor.Update(frame.data(), WIDTH, HEIGHT, STRIDE, 1, now);
+
+}
+
+
+static void TestTimeout() {
+
+	zs::SignalMonitor monitor;
+	CHECK(monitor.Check(100.0, 1.0) == zs::SignalState::NoSignal);
+
+	monitor.FrameArrived(100.0);
+	CHECK(monitor.Check(101.0, 1.0) == zs::SignalState::Live);
+	CHECK(monitor.Check(101.5, 1.0) == zs::SignalState::NoSignal);
+
+	// The driver's report wins over arriving frames
+	monitor.SetNoSignal(true);
+	CHECK(Feed(monitor, Flat(100), 102.0) == zs::SignalState::NoSignal);
+	CHECK(monitor.Check(102.0, 1.0) == zs::SignalState::NoSignal);
+	monitor.SetNoSignal(false);
+	CHECK(monitor.Check(102.0, 1.0) == zs::SignalState::Live);
+
+}
+
+
+static void TestBlack() {
+
+	zs::SignalMonitor monitor;
+	monitor.SetThresholds(2.0f, 0.0f);
+
+	// Peak luma of 32 is still black, it must last 2 seconds
+	std::vector<uint8_t> black = Flat(16), bright = Flat(100);
+	black[5] = 32;
+	CHECK(Feed(monitor, black, 100.0) == zs::SignalState::Live);
+	CHECK(Feed(monitor, black, 101.5) == zs::SignalState::Live);
+	CHECK(Feed(monitor, black, 102.0) == zs::SignalState::Black);
+	CHECK(monitor.Check(102.1, 1.0) == zs::SignalState::Black);
+
+	// One brighter sample ends the run and restarts the clock
+	black[5] = 33;
+	CHECK(Feed(monitor, black, 102.5) == zs::SignalState::Live);
+	black[5] = 16;
+	CHECK(Feed(monitor, black, 103.0) == zs::SignalState::Live);
+	CHECK(Feed(monitor, black, 104.5) == zs::SignalState::Live);
+	CHECK(Feed(monitor, black, 105.0) == zs::SignalState::Black);
+	CHECK(Feed(monitor, bright, 105.5) == zs::SignalState::Live);
+
+}
+
+
+static void TestFrozen() {
+
+	zs::SignalMonitor monitor;
+	monitor.SetThresholds(0.0f, 1.0f);
+
+	// The first frame has nothing to compare with, the run starts with the second
+	std::vector<uint8_t> still = Flat(100);
+	CHECK(Feed(monitor, still, 100.0) == zs::SignalState::Live);
+	CHECK(Feed(monitor, still, 100.5) == zs::SignalState::Live);
+	CHECK(Feed(monitor, still, 101.0) == zs::SignalState::Live);
+	CHECK(Feed(monitor, still, 101.5) == zs::SignalState::Frozen);
+
+	// Any change of the measured luma above 0.05 on average is motion
+	std::vector<uint8_t> moved = Flat(101);
+	CHECK(Feed(monitor, moved, 102.0) == zs::SignalState::Live);
+
+	// Black is reported before frozen, and ignored when not enabled
+	zs::SignalMonitor both;
+	both.SetThresholds(1.0f, 1.0f);
+	std::vector<uint8_t> black = Flat(16);
+	Feed(both, black, 100.0);
+	Feed(both, black, 100.5);
+	CHECK(Feed(both, black, 101.5) == zs::SignalState::Black);
+	CHECK(Feed(monitor, black, 102.5) == zs::SignalState::Live);
+
+	// Without thresholds only the timeout and the driver count
+	zs::SignalMonitor plain;
+	for (int i = 0; i < 10; i++)
+		CHECK(Feed(plain, black, 100.0 + i) == zs::SignalState::Live);
+
+}
+
+
+int main() {
+
+	TestTimeout();
+	TestBlack();
+	TestFrozen();
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TestCheck.h"
+#include "StripeWorkers.h"
+
+
+/// TRUE if one Run() over rows covers every row exactly once in stripes aligned to rowAlign
+static bool CoversOnce(zs::StripeWorkers& workers, uint32_t rows, uint32_t rowAlign) {
+
+	std::vector<std::atomic<uint32_t>> hits(rows);
+	for (auto& hit : hits)
+		hit = 0;
+	std::atomic<bool> aligned(true);
+	workers.Run(rows, [&](uint32_t first, uint32_t last) {
+		if (first % rowAlign != 0)
+			aligned = false;
+		for (uint32_t y = first; y < last; y++)
+			hits[y]++;
+	}, rowAlign);
+
+	for (auto& hit : hits)
+		if (hit != 1)
+			return false;
+	return aligned;
+
+}
+
+
+static void TestStripes() {
+
+	const uint32_t threadCounts[] = { 1, 3, 4 };
+	const uint32_t rowCounts[] = { 0, 1, 5, 7, 100, 1081 };
+	for (uint32_t threads : threadCounts) {
+		zs::StripeWorkers workers(threads);
+		CHECK(workers.GetThreadCount() == threads);
+		for (uint32_t rows : rowCounts)
+			for (uint32_t rowAlign = 1; rowAlign <= 2; rowAlign++)
+				CHECK(CoversOnce(workers, rows, rowAlign));
+	}
+
+	// 10 rows on 4 threads in field pairs: stripes of ceil(10 / 4) rounded up to 2 rows
+	zs::StripeWorkers workers(4);
+	std::mutex lock;
+	std::set<std::pair<uint32_t, uint32_t>> stripes;
+	workers.Run(10, [&](uint32_t first, uint32_t last) {
+		std::lock_guard<std::mutex> guard(lock);
+		stripes.insert(std::make_pair(first, last));
+	}, 2);
+	const std::set<std::pair<uint32_t, uint32_t>> expected = { { 0, 4 }, { 4, 8 }, { 8, 10 } };
+	CHECK(stripes == expected);
+
+}
+
+
+static void TestConcurrentCallers() {
+
+	// Callers on several threads share the workers, each gets all of its own rows back
+	zs::StripeWorkers workers(4);
+	std::atomic<uint32_t> failed(0);
+	std::vector<std::thread> callers;
+	for (uint32_t c = 0; c < 4; c++)
+		callers.emplace_back([&, c]() {
+			for (uint32_t i = 0; i < 200; i++)
+				if (!CoversOnce(workers, 64 + c * 7 + i % 5, 1 + i % 2))
+					failed++;
+		});
+	for (auto& caller : callers)
+		caller.join();
+	CHECK(failed == 0);
+
+}
+
+
+static void TestOnStart() {
+
+	// Every worker runs onStart on its own thread, the caller never does
+	std::mutex lock;
+	std::set<std::thread::id> started;
+	{
+		zs::StripeWorkers workers(4, [&]() {
+			std::lock_guard<std::mutex> guard(lock);
+			started.insert(std::this_thread::get_id());
+		});
+		CHECK(CoversOnce(workers, 100, 1));
+	}
+	CHECK(started.size() == 3);
+	CHECK(started.count(std::this_thread::get_id()) == 0);
+
+}
+
+
+int main() {
+
+	TestStripes();
+	TestConcurrentCallers();
+	TestOnStart();
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,109 @@
+#include <cstring>
+#include "TestCheck.h"
+#include "TemporalDenoiser.h"
+
+
+// 18 pixels are 36 bytes per row: two vector blocks and a scalar tail of 4 bytes
+#define WIDTH 18
+#define HEIGHT 4
+#define ROW_BYTES (WIDTH * 2)
+
+
+/// TRUE if every byte of the buffer is value
+static bool BufferIs(const uint8_t* data, size_t size, uint8_t value) {
+
+	for (size_t i = 0; i < size; i++)
+		if (data[i] != value)
+			return false;
+	return true;
+
+}
+
+
+static void TestDenoiser(zs::StripeWorkers& workers, zs::FramePool& pool) {
+
+	zs::TemporalDenoiser denoiser(workers, pool);
+	denoiser.SetParameters(8, 10);
+	uint8_t frame[ROW_BYTES * HEIGHT];
+
+	// The first frame seeds the reference and passes unchanged
+	memset(frame, 100, sizeof(frame));
+	CHECK(denoiser.Process(frame, WIDTH, HEIGHT, ROW_BYTES));
+	CHECK(BufferIs(frame, sizeof(frame), 100));
+
+	// A change within the threshold is blended half way: (106 * 8 + 100 * 8 + 8) >> 4
+	memset(frame, 106, sizeof(frame));
+	CHECK(denoiser.Process(frame, WIDTH, HEIGHT, ROW_BYTES));
+	CHECK(BufferIs(frame, sizeof(frame), 103));
+
+	// A change above the threshold is motion and passes through
+	memset(frame, 150, sizeof(frame));
+	CHECK(denoiser.Process(frame, WIDTH, HEIGHT, ROW_BYTES));
+	CHECK(BufferIs(frame, sizeof(frame), 150));
+
+	// The reference followed the output, so the next small change blends toward 150
+	memset(frame, 142, sizeof(frame));
+	CHECK(denoiser.Process(frame, WIDTH, HEIGHT, ROW_BYTES));
+	CHECK(BufferIs(frame, sizeof(frame), 146));
+
+	// After a reset the next frame seeds again
+	denoiser.Reset();
+	memset(frame, 20, sizeof(frame));
+	CHECK(denoiser.Process(frame, WIDTH, HEIGHT, ROW_BYTES));
+	CHECK(BufferIs(frame, sizeof(frame), 20));
+
+	// A padded stride leaves the padding alone
+	const uint32_t stride = ROW_BYTES + 8;
+	uint8_t padded[stride * HEIGHT];
+	memset(padded, 24, sizeof(padded));
+	CHECK(denoiser.Process(padded, WIDTH, HEIGHT, stride));
+	CHECK(BufferIs(padded, ROW_BYTES, 22) && BufferIs(padded + ROW_BYTES, 8, 24));
+
+	// Frames too small to filter are rejected
+	CHECK(!denoiser.Process(frame, 2, HEIGHT, 4));
+	CHECK(!denoiser.Process(nullptr, WIDTH, HEIGHT, ROW_BYTES));
+
+}
+
+
+static void TestPool(zs::FramePool& pool) {
+
+	pool.Trim();
+	CHECK(pool.GetAllocatedCount() == 0);
+
+	// A released buffer goes back to the pool and is handed out again for the same size
+	uint8_t* first;
+	{
+		std::shared_ptr<uint8_t> buffer = pool.Acquire(4096);
+		CHECK(buffer);
+		first = buffer.get();
+		CHECK(pool.GetAllocatedCount() == 1 && pool.GetAllocatedBytes() == 4096);
+	}
+	std::shared_ptr<uint8_t> again = pool.Acquire(4096);
+	CHECK(again.get() == first);
+	CHECK(pool.GetAllocatedCount() == 1);
+
+	// Another size gets a buffer of its own
+	std::shared_ptr<uint8_t> other = pool.Acquire(8192);
+	CHECK(other && other.get() != first);
+	CHECK(pool.GetAllocatedCount() == 2 && pool.GetAllocatedBytes() == 4096 + 8192);
+
+	// Trim frees only idle buffers
+	other.reset();
+	pool.Trim();
+	CHECK(pool.GetAllocatedCount() == 1 && pool.GetAllocatedBytes() == 4096);
+
+}
+
+
+int main() {
+
+	zs::StripeWorkers workers(3);
+	zs::FramePool pool;
+
+	TestDenoiser(workers, pool);
+	TestPool(pool);
+
+	return TEST_RESULT();
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+// VERSION: 1.0
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <VideoDataStructures.h>
+
+
+/// Failed checks of the running test program
+static int failures = 0;
+
+/// Report a failed condition and carry on, so one run lists every failure
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			failures++; \
+		} \
+	} while (0)
+
+/// Exit status of the test program
+#define TEST_RESULT() (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+
+/// Packed UYVY frame with every byte of row y set to rows[y]
+inline zs::Frame RowFrame(uint32_t width, const uint8_t* rows, uint32_t height) {
+
+	zs::Frame frame(width, height, (uint32_t)zs::ValidFourccCodes::UYVY);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t i = 0; i < width * 2; i++)
+			frame.data[y * width * 2 + i] = rows[y];
+	return frame;
+
+}
+
+
+/// TRUE if every byte of row y of a packed frame is value
+inline bool RowIs(const zs::Frame& frame, uint32_t y, uint8_t value) {
+
+	for (uint32_t i = 0; i < frame.width * 2; i++)
+		if (frame.data[y * frame.width * 2 + i] != value)
+			return false;
+	return true;
+
+}
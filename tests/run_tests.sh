@@ -0,0 +1,25 @@
+#!/usr/bin/env sh
+# Build and run the behavioral checks of the processing stages. They need neither the
+# NDI SDK nor a capture device. Exits non-zero if any check fails.
+
+cd "$(dirname "$0")/.."
+
+if [ ! -d "build/tests" ]; then
+  mkdir -p build/tests
+fi
+
+SOURCES=$(ls *.cpp | grep -v '^main.cpp$')
+status=0
+for test in tests/*Test.cpp; do
+  name=$(basename "$test" .cpp)
+  if ! g++ -std=c++14 -pthread -O2 -Iinclude/ -Itests/ -o build/tests/$name $test $SOURCES; then
+    echo "BUILD FAILED $name"
+    status=1
+  elif build/tests/$name; then
+    echo "PASSED $name"
+  else
+    echo "FAILED $name"
+    status=1
+  fi
+done
+exit $status